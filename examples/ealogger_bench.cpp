@@ -13,55 +13,214 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 
+
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <ealogger/ealogger.h>
 
-int main(void)
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+const char *bench_file = "ealogger_bench.log";
+
+/**
+ * @brief Get how much of \p path is in the page cache in MiB
+ *
+ * @return Cached MiB or a negative value if it can not be determined
+ */
+double cached_mib(const char *path)
 {
-    namespace eal = ealogger;
-    namespace con = ealogger::constants;
+#ifdef __linux__
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    double mib = -1;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            long page = sysconf(_SC_PAGESIZE);
+            std::vector<unsigned char> pages((size + page - 1) / page);
+            if (mincore(data, size, pages.data()) == 0) {
+                std::size_t resident = 0;
+                for (unsigned char p : pages)
+                    resident += p & 1;
+                mib = static_cast<double>(resident) * page / (1024 * 1024);
+            }
+            munmap(data, size);
+        }
+    }
+    close(fd);
+    return mib;
+#else
+    (void)path;
+    return -1;
+#endif
+}
 
-    // init an ealogger object and a file sink
+/**
+ * @brief Log \p count messages to a file sink and print the throughput
+ *
+ * @param name Description of the file sink configuration
+ * @param flush_buffer Write every message immediately
+ * @param buffer_size Size of the file sink buffer
+ * @param count Number of messages
+ * @param io_uring_depth Asynchronous writes in flight, 0 for blocking writes
+ * @param sink EAL_FILE_SIMPLE, EAL_FILE_DIRECT or EAL_FILE_BINARY
+ * @param checksums Checksum every record of the binary file sink
+ */
+void run_file_bench(const std::string &name, bool flush_buffer,
+                    std::size_t buffer_size, int count,
+                    std::size_t io_uring_depth = 0,
+                    con::LOGGER_SINK sink = con::LOGGER_SINK::EAL_FILE_SIMPLE,
+                    bool checksums = false)
+{
+    std::remove(bench_file);
+    // init a synchronous ealogger object and a file sink, so the time is spent
+    // rendering and writing messages and not in the queue
+    std::unique_ptr<eal::Logger> log =
+        std::unique_ptr<eal::Logger>(new eal::Logger(false));
+    eal::SinkFile::Options options;
+    options.flush_buffer = flush_buffer;
+    options.buffer_size = buffer_size;
+    options.io_uring_depth = io_uring_depth;
+    if (sink == con::LOGGER_SINK::EAL_FILE_DIRECT) {
+        log->init_file_direct_sink(true, con::LOG_LEVEL::EAL_DEBUG,
+                                   "%d %s [%f:%l] %m", "%F %T", bench_file,
+                                   options);
+    } else if (sink == con::LOGGER_SINK::EAL_FILE_BINARY) {
+        log->init_file_binary_sink(true, con::LOG_LEVEL::EAL_DEBUG,
+                                   "%d %s [%f:%l] %m", "%F %T", bench_file,
+                                   options, checksums);
+    } else {
+        log->init_file_sink(true, con::LOG_LEVEL::EAL_DEBUG,
+                            "%d %s [%f:%l] %m", "%F %T", bench_file, options);
+    }
+
+    // take the time
+    std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        log->eal_info("Hello Afrika - Tell me how you're doin'! ");
+    }
+    eal::SinkStats stats = log->get_sink_stats(sink);
+    // the destructor flushes all sinks
+    log.reset();
+    std::chrono::steady_clock::time_point tstop_written =
+        std::chrono::steady_clock::now();
+
+    std::ifstream written(bench_file, std::ios::binary | std::ios::ate);
+    double mib = static_cast<double>(written.tellg()) / (1024 * 1024);
+    double sec = std::chrono::duration_cast<std::chrono::microseconds>(
+                     tstop_written - t)
+                     .count() /
+                 1e6;
+
+    // print results.
+    std::cout << name << std::endl;
+    std::cout << "  Time untill all messages were written to the logfile: "
+              << static_cast<long>(sec * 1000) << "ms" << std::endl;
+    std::cout << "  Throughput: " << static_cast<long>(count / sec)
+              << " messages/s, " << mib / sec << " MiB/s" << std::endl;
+    double cached = cached_mib(bench_file);
+    if (cached >= 0) {
+        std::cout << "  Page cache: " << cached << " of " << mib << " MiB"
+                  << std::endl;
+    }
+    if (stats.io_uring) {
+        std::cout << "  io_uring writes: " << stats.writes_submitted
+                  << ", max in flight: " << stats.max_in_flight
+                  << ", latency avg/max: " << stats.latency_avg_us << "/"
+                  << stats.latency_max_us << "us" << std::endl;
+    }
+}
+
+/**
+ * @brief Log \p count messages with an asynchronous Logger and print how long
+ * it took to put them on the queue and to write them to the logfile
+ *
+ * @param count Number of messages
+ */
+void run_queue_bench(int count)
+{
+    std::remove(bench_file);
+    // init an asynchronous ealogger object and a file sink
     std::unique_ptr<eal::Logger> log =
         std::unique_ptr<eal::Logger>(new eal::Logger(true));
-    log->init_file_sink();
+    log->init_file_sink(true, con::LOG_LEVEL::EAL_DEBUG, "%d %s [%f:%l] %m",
+                        "%F %T", bench_file);
 
     // take the time
-    std::chrono::system_clock::time_point t = std::chrono::system_clock::now();
-    // log 1000000 messages
-    for (int i = 0; i < 1000000; i++) {
+    std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
         log->eal_info("Hello Afrika - Tell me how you're doin'! ");
     }
-    // end time. this is to calculate how long it took ealogger to creat LogMessage
-    // objects and push them on a queue
-    std::chrono::system_clock::time_point tstop =
-        std::chrono::system_clock::now();
+    // end time. this is to calculate how long it took ealogger to create
+    // LogMessage objects and push them on a queue
+    std::chrono::steady_clock::time_point tstop =
+        std::chrono::steady_clock::now();
 
-    // wait until all messages are written to the logfile
+    // wait until all messages are taken from the queue, the destructor
+    // flushes the file sink
     while (!log->queue_empty()) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+    log.reset();
+    std::chrono::steady_clock::time_point tstop_written =
+        std::chrono::steady_clock::now();
 
-    // get a timepoint so you know how long it actually took to write the
-    // messages
-    // to the file
-    std::chrono::system_clock::time_point tstop_empty =
-        std::chrono::system_clock::now();
+    double sec = std::chrono::duration_cast<std::chrono::microseconds>(
+                     tstop_written - t)
+                     .count() /
+                 1e6;
 
     // print results.
-    std::cout << "Time in milliseconds to put messages on a queue: "
-              << std::chrono::duration_cast<std::chrono::microseconds>(
-                     tstop -
-                     t).count() /
-                     1000
-              << "ms" << std::endl;
-    std::cout << "Time untill all messages were written to the logfile: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(
-                     tstop_empty - t)
+    std::cout << "Asynchronous logger, file sink" << std::endl;
+    std::cout << "  Time in milliseconds to put messages on a queue: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(tstop -
+                                                                        t)
                      .count()
               << "ms" << std::endl;
+    std::cout << "  Time untill all messages were written to the logfile: "
+              << static_cast<long>(sec * 1000) << "ms" << std::endl;
+    std::cout << "  Throughput: " << static_cast<long>(count / sec)
+              << " messages/s" << std::endl;
+}
+}
+
+int main(void)
+{
+    // log 1000000 messages with different file sink configurations
+    const int count = 1000000;
+    run_queue_bench(count);
+    run_file_bench("File sink, write every message", true, 0, count);
+    run_file_bench("File sink, 4 KiB buffer", false, 4096, count);
+    run_file_bench("File sink, 64 KiB buffer", false, 65536, count);
+    run_file_bench("File sink, 1 MiB buffer", false, 1024 * 1024, count);
+    run_file_bench("File sink, 64 KiB buffer, io_uring depth 8", false, 65536,
+                   count, 8);
+    run_file_bench("O_DIRECT file sink, 1 MiB buffer", false, 1024 * 1024,
+                   count, 0, con::LOGGER_SINK::EAL_FILE_DIRECT);
+    run_file_bench("Binary file sink, 1 MiB buffer", false, 1024 * 1024, count,
+                   0, con::LOGGER_SINK::EAL_FILE_BINARY);
+    run_file_bench("Binary file sink with checksums, 1 MiB buffer", false,
+                   1024 * 1024, count, 0, con::LOGGER_SINK::EAL_FILE_BINARY,
+                   true);
+    std::remove(bench_file);
     return 0;
 }
@@ -0,0 +1,215 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+/**
+ * @file binlog.h
+ * @brief Definition of the binary log format written by SinkFileBinary
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <ealogger/crc32c.h>
+
+namespace ealogger
+{
+/**
+ * @namespace binlog
+ * @brief Constants and helpers for the binary log format
+ *
+ * @details
+ * A binary log file starts with a header of binlog::file_header_size bytes,
+ * binlog::magic followed by the format version as uint32 and the file flags
+ * as uint32. The rest of the file is a sequence of records. Every record
+ * starts with its size as uint32, not counting the size field itself,
+ * followed by one byte binlog::RECORD and the body. Readers skip records with
+ * types they do not know. All integers are little endian.
+ *
+ * If binlog::flag_checksum is set every record ends with the CRC-32C of the
+ * size field, the type and the body. The size includes the checksum. A torn
+ * or overwritten record is detected by the checksum, a reader can find the
+ * next intact record by searching for a valid one.
+ *
+ * Strings that are the same for many messages are written only once per
+ * file in dictionary records, messages refer to them by id:
+ *
+ * RECORD::FORMAT
+ * | uint32 template length | message template | datetime pattern |
+ *
+ * RECORD::CALL_SITE
+ * | uint32 id | int32 line | uint32 file length | file | function |
+ *
+ * RECORD::LOGGER
+ * | uint32 id | name of the ChildLogger |
+ *
+ * RECORD::MESSAGE starts with a header of binlog::message_header_size bytes
+ * | int64 timestamp ns | uint64 sequence | uint64 thread id |
+ * | uint32 call site id | uint32 logger id | uint32 sampling weight |
+ * | uint8 level | uint8 LogMessage::LOGTYPE |
+ * followed by the message text. The elements of a stacktrace are written as
+ * uint32 length and text each. Logger id 0 is the Logger itself.
+ *
+ * A dictionary id is valid from its record to the end of the file or until
+ * it is defined again.
+ */
+namespace binlog
+{
+/** First bytes of every binary log file */
+const char magic[8] = {'E', 'A', 'L', 'B', 'I', 'N', '\r', '\n'};
+/** Version of the format described here */
+const std::uint32_t version = 1;
+/** Size of the file header */
+const std::size_t file_header_size = 16;
+/** Size of the size and type fields in front of every record body */
+const std::size_t record_prefix_size = 5;
+/** Size of the fixed part of a RECORD::MESSAGE body */
+const std::size_t message_header_size = 38;
+/** Size of the checksum at the end of a record */
+const std::size_t checksum_size = 4;
+/** File flag, every record ends with a checksum */
+const std::uint32_t flag_checksum = 1;
+
+/**
+ * @brief Types of records in a binary log file
+ */
+enum class RECORD : std::uint8_t {
+    FORMAT = 1, /**< Message template and datetime pattern */
+    CALL_SITE,  /**< File, line and function of a call site */
+    LOGGER,     /**< Name of a ChildLogger */
+    MESSAGE     /**< A log message */
+};
+
+/**
+ * @brief Store \p v at \p p in little endian byte order
+ */
+template <typename T>
+inline void set(char *p, T v)
+{
+    std::memcpy(p, &v, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::reverse(p, p + sizeof(T));
+#endif
+}
+
+/**
+ * @brief Append \p v to \p out in little endian byte order
+ */
+template <typename T>
+inline void put(std::string &out, T v)
+{
+    char b[sizeof(T)];
+    set<T>(b, v);
+    out.append(b, sizeof(T));
+}
+
+/**
+ * @brief Read a little endian value from \p p
+ */
+template <typename T>
+inline T get(const char *p)
+{
+    char b[sizeof(T)];
+    std::memcpy(b, p, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::reverse(b, b + sizeof(T));
+#endif
+    T v;
+    std::memcpy(&v, b, sizeof(T));
+    return v;
+}
+
+/**
+ * @brief Start a record of type \p type in \p out
+ *
+ * @return Position of the size field for binlog::finish_record
+ */
+inline std::size_t begin_record(std::string &out, RECORD type)
+{
+    std::size_t pos = out.size();
+    put<std::uint32_t>(out, 0);
+    put<std::uint8_t>(out, static_cast<std::uint8_t>(type));
+    return pos;
+}
+
+/**
+ * @brief Write the size of the record that was started at \p pos
+ *
+ * @param out
+ * @param pos
+ * @param checksum Append the checksum, for files with binlog::flag_checksum
+ */
+inline void finish_record(std::string &out, std::size_t pos,
+                          bool checksum = false)
+{
+    std::size_t end = out.size() + (checksum ? checksum_size : 0);
+    set<std::uint32_t>(&out[pos], static_cast<std::uint32_t>(end - pos - 4));
+    if (checksum)
+        put<std::uint32_t>(out, crc32c::value(&out[pos], out.size() - pos));
+}
+
+/**
+ * @brief Verify the checksum of a complete record
+ *
+ * @param rec Start of the record, its size field
+ * @param rec_size Value of the size field
+ */
+inline bool check_record(const char *rec, std::uint32_t rec_size)
+{
+    if (rec_size < 1 + checksum_size)
+        return false;
+    std::size_t len = 4 + rec_size - checksum_size;
+    return crc32c::value(rec, len) == get<std::uint32_t>(rec + len);
+}
+
+/**
+ * @brief Append the file header to \p out
+ *
+ * @param out
+ * @param flags Combination of the file flags like binlog::flag_checksum
+ */
+inline void put_file_header(std::string &out, std::uint32_t flags = 0)
+{
+    out.append(magic, sizeof(magic));
+    put<std::uint32_t>(out, version);
+    put<std::uint32_t>(out, flags);
+}
+
+/**
+ * @brief Get the file flags of a valid file header
+ */
+inline std::uint32_t get_file_flags(const char *data)
+{
+    return get<std::uint32_t>(data + sizeof(magic) + 4);
+}
+
+/**
+ * @brief Check whether \p len bytes at \p data start with a valid file header
+ */
+inline bool is_file_header(const char *data, std::size_t len)
+{
+    return len >= file_header_size &&
+           std::memcmp(data, magic, sizeof(magic)) == 0 &&
+           get<std::uint32_t>(data + sizeof(magic)) == version;
+}
+}
+}
+
+#endif /* BINLOG_H */
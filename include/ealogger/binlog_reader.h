@@ -0,0 +1,233 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef BINLOG_READER_H
+#define BINLOG_READER_H
+
+/**
+ * @file binlog_reader.h
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ealogger/binlog.h>
+#include <ealogger/logmessage.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Reads the messages of a binary log file
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * The file is mapped into memory and decoded record by record into LogMessage
+ * objects, so they can be rendered by any Sink like live messages. The reader
+ * keeps the dictionary records it has seen, file names, functions and logger
+ * names are restored from them.
+ *
+ * A file that is still written can be followed. BinlogReader::next stops at
+ * the end of the mapped data or at an incomplete record,
+ * BinlogReader::refresh maps data that was appended in the meantime. If the
+ * file was replaced, for example by logrotate, refresh continues with the new
+ * file after the old one was read completely. A file that was truncated in
+ * place (logrotate copytruncate) is read again from its beginning, messages
+ * that were not read before the truncate are lost.
+ *
+ * In files with binlog::flag_checksum every record is verified. A damaged
+ * record is skipped together with everything up to the next intact record,
+ * BinlogReader::get_skipped tells how many bytes were lost. Files without
+ * checksums end at the first damaged record.
+ *
+ * With a LogIndex the reader can jump to the blocks of interest with
+ * BinlogReader::seek instead of reading the whole file.
+ */
+class BinlogReader
+{
+public:
+    /**
+     * @brief Open and map a binary log file
+     *
+     * @param path
+     */
+    explicit BinlogReader(std::string path);
+    ~BinlogReader();
+
+    BinlogReader(const BinlogReader &) = delete;
+    BinlogReader &operator=(const BinlogReader &) = delete;
+
+    /**
+     * @brief Check whether the file could be opened and has a valid header
+     *
+     * @return False if the file is missing or no binary log file
+     *
+     * @details
+     * A file that was just created and has no complete header yet is valid.
+     */
+    bool is_valid() const;
+    /**
+     * @brief Map data that was written since the file was mapped
+     *
+     * @return True if there is data that was not read yet
+     */
+    bool refresh();
+    /**
+     * @brief Read the next message
+     *
+     * @param m Set to a new LogMessage
+     *
+     * @return False at the end of the mapped data or at an incomplete record
+     */
+    bool next(std::shared_ptr<LogMessage> &m);
+    /**
+     * @brief Continue reading at \p offset
+     *
+     * @param offset Start of a block of a LogIndex or 0
+     *
+     * @details
+     * The dictionary read so far is forgotten, the blocks of an index define
+     * everything they use. An offset behind the mapped data is treated as the
+     * end of the data.
+     */
+    void seek(std::uint64_t offset);
+    /**
+     * @brief Find the end of the last intact record of the file
+     *
+     * @param end Set to the offset behind the last intact record, 0 if not
+     * even the file header is complete
+     * @param from Start of a record where the check begins, for example the
+     * last block of a LogIndex. Only used for files with checksums, if the
+     * record there is intact.
+     *
+     * @return False if the file is no binary log file
+     *
+     * @details
+     * Used to recover a file after a crash or power loss, everything behind
+     * \p end is a torn record or garbage. Records are checked without decoding
+     * them, the read position does not change.
+     */
+    bool find_valid_end(std::uint64_t &end, std::uint64_t from = 0);
+    /**
+     * @brief Check whether the file has binlog::flag_checksum set
+     *
+     * @details
+     * Valid after the file header was read by BinlogReader::next or
+     * BinlogReader::find_valid_end
+     */
+    bool has_checksums() const;
+    /**
+     * @brief Get the number of bytes skipped because of damaged records
+     */
+    std::uint64_t get_skipped() const;
+    /**
+     * @brief Get the sequence number of the last message
+     */
+    std::uint64_t get_sequence() const;
+    /**
+     * @brief Get the file offset of the next record
+     */
+    std::uint64_t get_offset() const;
+    /**
+     * @brief Get the message template of the last RECORD::FORMAT
+     */
+    const std::string &get_msg_template() const;
+    /**
+     * @brief Get the datetime pattern of the last RECORD::FORMAT
+     */
+    const std::string &get_datetime_pattern() const;
+    /**
+     * @brief Number of RECORD::FORMAT records read so far
+     *
+     * @details
+     * Callers that render the messages with the stored template can compare
+     * this with the last value to notice a new template.
+     */
+    std::size_t get_format_count() const;
+
+private:
+    /**
+     * @brief A call site restored from a dictionary record
+     */
+    struct CallSite {
+        std::string file;
+        std::string func;
+        int line;
+    };
+
+    std::string path;
+    int fd;
+    std::uint64_t dev; /**< Device of the open file */
+    std::uint64_t ino; /**< Inode of the open file */
+    const char *data;  /**< Mapped file content */
+    std::uint64_t size; /**< Mapped bytes */
+#ifdef _WIN32
+    std::string contents; /**< File content, there is no mmap */
+#endif
+    std::uint64_t pos;
+    bool valid;
+    bool checksums; /**< Records end with a checksum */
+    std::uint64_t skipped;
+
+    std::vector<CallSite> call_sites;
+    std::vector<std::string> loggers;
+    std::string msg_template;
+    std::string datetime_pattern;
+    std::size_t format_count;
+    std::uint64_t sequence;
+
+    void open_file();
+    void close_file();
+    /**
+     * @brief Map the first \p len bytes of the open file
+     */
+    void map_file(std::uint64_t len);
+    /**
+     * @brief Check whether a complete record starts at \p offset
+     *
+     * @return 1 if it is intact, 0 if it is incomplete and -1 if it is
+     * damaged
+     */
+    int check_record(std::uint64_t offset) const;
+    /**
+     * @brief Move to the next intact record behind a damaged one
+     *
+     * @return False if there is no intact record in the mapped data yet
+     */
+    bool resync();
+    /**
+     * @brief Decode a dictionary record, returns false for corrupt records
+     */
+    bool read_dictionary(binlog::RECORD type, const char *body,
+                         std::size_t len);
+    /**
+     * @brief Decode a RECORD::MESSAGE body
+     */
+    bool read_message(const char *body, std::size_t len,
+                      std::shared_ptr<LogMessage> &m);
+};
+
+/** @} */
+}
+
+#endif /* BINLOG_READER_H */
@@ -0,0 +1,256 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef CALLSITE_H
+#define CALLSITE_H
+
+/**
+ * @file callsite.h
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <ealogger/global.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief A place in the source code where one of the logging macros is used
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * Every macro creates a CallSite object with static storage duration. The
+ * first time the macro is executed the CallSite registers itself with the
+ * CallSiteRegistry. From then on checking whether it is enabled is a single
+ * relaxed load and a predictable branch.
+ *
+ * The constructor is constexpr so the objects are constant initialized.
+ */
+struct CallSite {
+    /**
+     * @brief States of a CallSite
+     */
+    enum STATE {
+        UNREGISTERED = 0, /**< Not yet known to the CallSiteRegistry */
+        ENABLED,          /**< Messages from this call site are written */
+        DISABLED          /**< Messages from this call site are discarded */
+    };
+
+    /**
+     * @brief CallSite constructor
+     *
+     * @param file Source file (__FILE__)
+     * @param line Line number (__LINE__)
+     * @param level Severity of the macro
+     */
+    constexpr CallSite(const char *file, int line,
+                       ealogger::constants::LOG_LEVEL level)
+        : file(file), line(line), level(level), func(nullptr), id(0), state(0)
+    {
+    }
+
+    /**
+     * @brief Check whether messages from this call site should be written
+     *
+     * @param caller_func Function name (__func__) used for the registration
+     *
+     * @return True if the call site is enabled
+     */
+    bool is_enabled(const char *caller_func)
+    {
+        // pairs with the release store in CallSiteRegistry::register_site,
+        // a site seen as ENABLED has its id and func published
+        int s = this->state.load(std::memory_order_acquire);
+        return s == ENABLED ||
+               (s == UNREGISTERED && this->register_site(caller_func));
+    }
+
+    const char *const file; /**< Source file */
+    const int line;         /**< Line number */
+    const ealogger::constants::LOG_LEVEL level; /**< Severity */
+    const char *func; /**< Function, set on registration */
+    std::uint32_t id; /**< Unique id, set on registration */
+    std::atomic<int> state; /**< CallSite::STATE */
+
+private:
+    bool register_site(const char *caller_func);
+};
+
+/**
+ * @brief Selects call sites in the CallSiteRegistry
+ *
+ * @details
+ * The file and function patterns are globs that support * and ?. A file
+ * pattern matches if it matches the whole path as provided by __FILE__ or a
+ * part of the path that starts after a directory separator. So "src/net*"
+ * matches "/home/me/project/src/net/http.cpp".
+ */
+struct CallSiteQuery {
+    CallSiteQuery()
+        : file_pattern("*"),
+          func_pattern("*"),
+          line(0),
+          match_level(false),
+          level(ealogger::constants::LOG_LEVEL::EAL_DEBUG)
+    {
+    }
+
+    std::string file_pattern; /**< Glob for the source file */
+    std::string func_pattern; /**< Glob for the function name */
+    int line;                 /**< Line number, 0 matches all lines */
+    bool match_level;         /**< Only match CallSiteQuery#level */
+    ealogger::constants::LOG_LEVEL level; /**< Severity to match */
+
+    /**
+     * @brief Check if the query selects a call site
+     *
+     * @param file
+     * @param func
+     * @param site_line
+     * @param site_level
+     *
+     * @return True if the call site is selected
+     */
+    bool matches(const char *file, const char *func, int site_line,
+                 ealogger::constants::LOG_LEVEL site_level) const;
+};
+
+/**
+ * @brief Information about a registered call site
+ */
+struct CallSiteInfo {
+    std::string file;                     /**< Source file */
+    int line;                             /**< Line number */
+    std::string func;                     /**< Function */
+    ealogger::constants::LOG_LEVEL level; /**< Severity */
+    bool enabled;                         /**< Is the call site enabled */
+};
+
+/**
+ * @brief Global table of all call sites
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * Similar to the dynamic debug feature of the Linux kernel every call site of
+ * the logging macros can be switched on or off at runtime.
+ *
+ * @code
+ * namespace con = ealogger::constants;
+ * auto &registry = ealogger::CallSiteRegistry::instance();
+ * // the Logger and its sinks write debug messages, only keep those of src/net
+ * registry.set_enabled("*", con::LOG_LEVEL::EAL_DEBUG, false);
+ * registry.set_enabled("src/net*", con::LOG_LEVEL::EAL_DEBUG, true);
+ * // disable everything in main.cpp
+ * registry.set_enabled("main.cpp", false);
+ * @endcode
+ *
+ * Call sites register themselves when they are executed for the first time.
+ * The registry remembers all changes and applies them to call sites that
+ * register later, the last matching change wins. Call sites are enabled by
+ * default.
+ *
+ * Disabling a call site is independent of log levels and sink severities. An
+ * enabled call site still has to pass those, enabling a call site can not make
+ * a Logger write messages below its minimum severity. Lower the severity of
+ * the Logger and its sinks and disable the call sites you are not interested
+ * in instead.
+ */
+class CallSiteRegistry
+{
+public:
+    /**
+     * @brief Get the process wide registry
+     *
+     * @return CallSiteRegistry reference
+     */
+    static CallSiteRegistry &instance();
+
+    /**
+     * @brief Enable or disable all call sites selected by a query
+     *
+     * @param query
+     * @param enabled
+     *
+     * @return Number of already registered call sites that were selected
+     */
+    std::size_t set_enabled(const CallSiteQuery &query, bool enabled);
+    /**
+     * @brief Enable or disable all call sites in matching files
+     *
+     * @param file_pattern Glob for the source files
+     * @param enabled
+     *
+     * @return Number of already registered call sites that were selected
+     */
+    std::size_t set_enabled(const std::string &file_pattern, bool enabled);
+    /**
+     * @brief Enable or disable all call sites with a severity in matching files
+     *
+     * @param file_pattern Glob for the source files
+     * @param lvl Severity of the call sites
+     * @param enabled
+     *
+     * @return Number of already registered call sites that were selected
+     */
+    std::size_t set_enabled(const std::string &file_pattern,
+                            ealogger::constants::LOG_LEVEL lvl, bool enabled);
+
+    /**
+     * @brief Get a list of all registered call sites
+     *
+     * @return Vector of CallSiteInfo objects
+     */
+    std::vector<CallSiteInfo> get_call_sites();
+
+    /**
+     * @brief Add a CallSite to the registry, used by CallSite::is_enabled
+     *
+     * @param site
+     * @param func Function name of the call site
+     *
+     * @return The CallSite::STATE of the call site
+     */
+    int register_site(CallSite &site, const char *func);
+
+private:
+    CallSiteRegistry();
+
+    /**
+     * @brief A change of the enabled state that is applied to new call sites
+     */
+    struct Rule {
+        CallSiteQuery query;
+        bool enabled;
+    };
+
+    std::mutex mtx_registry;
+    std::vector<CallSite *> sites;
+    std::vector<Rule> rules;
+};
+
+/** @} */
+}
+
+#endif /* CALLSITE_H */
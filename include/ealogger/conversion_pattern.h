@@ -50,6 +50,8 @@ namespace ealogger
  * %t  :  Thread ID
  * %m  :  Log message
  * %s  :  Log level / severity
+ * %w  :  Sampling weight of the message, see Sampler
+ * %c  :  Name of the ChildLogger that issued the message
  *
  */
 struct ConversionPattern {
@@ -66,7 +68,10 @@ public:
         HOST,          /**< Hostname */
         THREADID,      /**< Thread ID */
         MSG,           /**< Log Message */
-        LVL            /**< Log level/severity */
+        LVL,           /**< Log level/severity */
+        WEIGHT,        /**< Sampling weight */
+        LOGGER_NAME,   /**< Name of the logger */
+        TEXT           /**< Text of the template between patterns */
     };
 
     /**
@@ -90,6 +95,13 @@ public:
         this->replace_conversion_pattern(msg, std::to_string(new_value));
     }
 
+    /**
+     * @brief Get the conversion pattern
+     *
+     * @return The pattern like "%m" or the text for PATTERN_TYPE::TEXT
+     */
+    const std::string &get_conv_pattern() const { return this->conv_pattern; }
+
     /**
      * @brief Get the conversion pattern type
      *
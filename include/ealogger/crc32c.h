@@ -0,0 +1,66 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+/**
+ * @file crc32c.h
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ealogger
+{
+/**
+ * @namespace crc32c
+ * @brief CRC-32C (Castagnoli) checksums for the binary log format
+ *
+ * @details
+ * The checksum is computed with the crc32 instruction of SSE 4.2 on x86-64 and
+ * of ARMv8 if the CPU has it, otherwise with a table driven implementation
+ * that processes eight bytes per step. The CPU is checked once at runtime.
+ */
+namespace crc32c
+{
+/**
+ * @brief Continue the checksum \p crc with \p len bytes at \p data
+ *
+ * @param crc Checksum of the data so far, 0 for the first call
+ * @param data
+ * @param len
+ *
+ * @return Checksum including \p data
+ */
+std::uint32_t extend(std::uint32_t crc, const char *data, std::size_t len);
+
+/**
+ * @brief Compute the checksum of \p len bytes at \p data
+ */
+inline std::uint32_t value(const char *data, std::size_t len)
+{
+    return extend(0, data, len);
+}
+
+/**
+ * @brief Check whether the checksum is computed by the CPU
+ */
+bool is_hardware();
+}
+}
+
+#endif /* CRC32C_H */
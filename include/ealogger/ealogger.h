@@ -20,13 +20,18 @@
  * @file ealogger.h
  */
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 /*
  * Mutual exclusion for threadsafe logger
  */
+#include <condition_variable>
 #include <csignal>
 #include <iostream>
 #include <mutex>
+#include <sstream>
 #include <stdexcept>
 /*
  * Background logger thread
@@ -35,11 +40,21 @@
 #include <thread>
 #include <vector>
 
+#include <ealogger/callsite.h>
+#include <ealogger/flight_recorder.h>
 #include <ealogger/global.h>
 #include <ealogger/logmessage.h>
 #include <ealogger/logqueue.h>
+#include <ealogger/ratelimit.h>
+#include <ealogger/sampler.h>
 #include <ealogger/sink_console.h>
 #include <ealogger/sink_file.h>
+#include <ealogger/sink_file_binary.h>
+#include <ealogger/sink_file_direct.h>
+#include <ealogger/sink_file_gzip.h>
+#include <ealogger/sink_file_mmap.h>
+#include <ealogger/sink_file_rotating.h>
+#include <ealogger/sink_shm.h>
 #include <ealogger/sink_syslog.h>
 #include "config.h"
 
@@ -58,49 +73,324 @@ namespace ealogger
  * @{
  */
 
-// Define macros for all log levels and call public member write_log()
+/**
+ * @def EAL_CALLSITE(lvl)
+ * @brief Static CallSite object that belongs to the place the macro is used
+ *
+ * @details
+ * Every lambda expression has its own closure type. The function local static
+ * inside is therefore unique for every place this macro is expanded.
+ */
+#define EAL_CALLSITE(lvl)                                                     \
+    []() -> ealogger::CallSite & {                                            \
+        static ealogger::CallSite eal_site ATTR_USED(                         \
+            __FILE__, __LINE__, ealogger::constants::LOG_LEVEL::lvl);         \
+        return eal_site;                                                      \
+    }()
+
+// Define macros for all log levels and call public member write_log_site()
+/**
+ * @def EAL_LAZY(msg)
+ * @brief Wrap the message expression \p msg in a lambda
+ *
+ * @details
+ * The lambda is only called after all checks have passed, so an expensive
+ * message expression is not evaluated if nothing will be written.
+ */
+#define EAL_LAZY(msg) [&]() -> std::string { return msg; }
+
+/**
+ * @def EAL_STREAM(expr)
+ * @brief Wrap the stream expression \p expr in a lambda
+ *
+ * @details
+ * \p expr is everything that can follow an output stream operator, for
+ * example `"Request " << req.id() << " failed"`. The std::ostringstream is
+ * only created if the message will be written.
+ */
+#define EAL_STREAM(expr)                                                      \
+    [&]() -> std::string {                                                    \
+        std::ostringstream eal_os;                                            \
+        eal_os << expr;                                                       \
+        return eal_os.str();                                                  \
+    }
+
 /**
  * @def eal_debug(msg)
  * @brief Write a debug message
  */
-#define eal_debug(msg)                                                  \
-    write_log(msg, ealogger::constants::LOG_LEVEL::EAL_DEBUG, __FILE__, \
-              __LINE__, __func__)
+#define eal_debug(msg)                                                        \
+    write_log_site(EAL_CALLSITE(EAL_DEBUG), EAL_LAZY(msg), __func__)
 /**
  * @def eal_info(msg)
  * @brief Write a info message
  */
-#define eal_info(msg)                                                  \
-    write_log(msg, ealogger::constants::LOG_LEVEL::EAL_INFO, __FILE__, \
-              __LINE__, __func__)
+#define eal_info(msg)                                                         \
+    write_log_site(EAL_CALLSITE(EAL_INFO), EAL_LAZY(msg), __func__)
 /**
  * @def eal_warn(msg)
  * @brief Write a warning message
  */
-#define eal_warn(msg)                                                     \
-    write_log(msg, ealogger::constants::LOG_LEVEL::EAL_WARNING, __FILE__, \
-              __LINE__, __func__)
+#define eal_warn(msg)                                                         \
+    write_log_site(EAL_CALLSITE(EAL_WARNING), EAL_LAZY(msg), __func__)
 /**
  * @def eal_error(msg)
  * @brief Write an error message
  */
-#define eal_error(msg)                                                  \
-    write_log(msg, ealogger::constants::LOG_LEVEL::EAL_ERROR, __FILE__, \
-              __LINE__, __func__)
+#define eal_error(msg)                                                        \
+    write_log_site(EAL_CALLSITE(EAL_ERROR), EAL_LAZY(msg), __func__)
 /**
  * @def eal_fatal(msg)
  * @brief Write a fatal message
  */
-#define eal_fatal(msg)                                                  \
-    write_log(msg, ealogger::constants::LOG_LEVEL::EAL_FATAL, __FILE__, \
-              __LINE__, __func__)
+#define eal_fatal(msg)                                                        \
+    write_log_site(EAL_CALLSITE(EAL_FATAL), EAL_LAZY(msg), __func__)
 /**
  * @def eal_stack()
  * @brief Write a message with a stacktrace
  */
-#define eal_stack()                                                    \
-    write_log("", ealogger::constants::LOG_LEVEL::EAL_STACK, __FILE__, \
-              __LINE__, __func__)
+#define eal_stack()                                                           \
+    write_log_site(EAL_CALLSITE(EAL_STACK), EAL_LAZY(""), __func__)
+
+/**
+ * @def eal_debug_stream(expr)
+ * @brief Write a debug message built with stream operators
+ */
+#define eal_debug_stream(expr)                                                \
+    write_log_site(EAL_CALLSITE(EAL_DEBUG), EAL_STREAM(expr), __func__)
+/**
+ * @def eal_info_stream(expr)
+ * @brief Write an info message built with stream operators
+ */
+#define eal_info_stream(expr)                                                 \
+    write_log_site(EAL_CALLSITE(EAL_INFO), EAL_STREAM(expr), __func__)
+/**
+ * @def eal_warn_stream(expr)
+ * @brief Write a warning message built with stream operators
+ */
+#define eal_warn_stream(expr)                                                 \
+    write_log_site(EAL_CALLSITE(EAL_WARNING), EAL_STREAM(expr), __func__)
+/**
+ * @def eal_error_stream(expr)
+ * @brief Write an error message built with stream operators
+ */
+#define eal_error_stream(expr)                                                \
+    write_log_site(EAL_CALLSITE(EAL_ERROR), EAL_STREAM(expr), __func__)
+/**
+ * @def eal_fatal_stream(expr)
+ * @brief Write a fatal message built with stream operators
+ */
+#define eal_fatal_stream(expr)                                                \
+    write_log_site(EAL_CALLSITE(EAL_FATAL), EAL_STREAM(expr), __func__)
+
+/**
+ * @def EAL_RATELIMITER()
+ * @brief Static RateLimiter object that belongs to the call site of the macro
+ *
+ * @details
+ * Every lambda expression has its own closure type. The function local static
+ * inside is therefore unique for every place this macro is expanded.
+ */
+#define EAL_RATELIMITER()                                    \
+    []() -> ealogger::RateLimiter & {                        \
+        static ealogger::RateLimiter eal_limiter ATTR_USED;  \
+        return eal_limiter;                                  \
+    }()
+
+/**
+ * @def EAL_WRITE_LIMITED(type, limit, lvl, msg)
+ * @brief Write a rate limited message, used by the *_every_n, *_first_n and
+ * *_per_second macros
+ *
+ * @details
+ * \p msg is only evaluated if the message passes the rate limiter.
+ */
+#define EAL_WRITE_LIMITED(type, limit, lvl, msg)                          \
+    write_log_limited(EAL_CALLSITE(lvl), EAL_RATELIMITER(),               \
+                      ealogger::RateLimiter::LIMIT_TYPE::type, limit,     \
+                      EAL_LAZY(msg), __func__)
+
+/**
+ * @def eal_debug_every_n(n, msg)
+ * @brief Write a debug message every n-th time this line is reached
+ */
+#define eal_debug_every_n(n, msg) EAL_WRITE_LIMITED(EVERY_N, n, EAL_DEBUG, msg)
+/**
+ * @def eal_info_every_n(n, msg)
+ * @brief Write an info message every n-th time this line is reached
+ */
+#define eal_info_every_n(n, msg) EAL_WRITE_LIMITED(EVERY_N, n, EAL_INFO, msg)
+/**
+ * @def eal_warn_every_n(n, msg)
+ * @brief Write a warning message every n-th time this line is reached
+ */
+#define eal_warn_every_n(n, msg) EAL_WRITE_LIMITED(EVERY_N, n, EAL_WARNING, msg)
+/**
+ * @def eal_error_every_n(n, msg)
+ * @brief Write an error message every n-th time this line is reached
+ */
+#define eal_error_every_n(n, msg) EAL_WRITE_LIMITED(EVERY_N, n, EAL_ERROR, msg)
+/**
+ * @def eal_debug_first_n(n, msg)
+ * @brief Write a debug message only the first n times this line is reached
+ */
+#define eal_debug_first_n(n, msg) EAL_WRITE_LIMITED(FIRST_N, n, EAL_DEBUG, msg)
+/**
+ * @def eal_info_first_n(n, msg)
+ * @brief Write an info message only the first n times this line is reached
+ */
+#define eal_info_first_n(n, msg) EAL_WRITE_LIMITED(FIRST_N, n, EAL_INFO, msg)
+/**
+ * @def eal_warn_first_n(n, msg)
+ * @brief Write a warning message only the first n times this line is reached
+ */
+#define eal_warn_first_n(n, msg) EAL_WRITE_LIMITED(FIRST_N, n, EAL_WARNING, msg)
+/**
+ * @def eal_error_first_n(n, msg)
+ * @brief Write an error message only the first n times this line is reached
+ */
+#define eal_error_first_n(n, msg) EAL_WRITE_LIMITED(FIRST_N, n, EAL_ERROR, msg)
+/**
+ * @def eal_debug_per_second(limit, msg)
+ * @brief Write at most \p limit debug messages per second from this line
+ */
+#define eal_debug_per_second(limit, msg) \
+    EAL_WRITE_LIMITED(PER_SECOND, limit, EAL_DEBUG, msg)
+/**
+ * @def eal_info_per_second(limit, msg)
+ * @brief Write at most \p limit info messages per second from this line
+ */
+#define eal_info_per_second(limit, msg) \
+    EAL_WRITE_LIMITED(PER_SECOND, limit, EAL_INFO, msg)
+/**
+ * @def eal_warn_per_second(limit, msg)
+ * @brief Write at most \p limit warning messages per second from this line
+ */
+#define eal_warn_per_second(limit, msg) \
+    EAL_WRITE_LIMITED(PER_SECOND, limit, EAL_WARNING, msg)
+/**
+ * @def eal_error_per_second(limit, msg)
+ * @brief Write at most \p limit error messages per second from this line
+ */
+#define eal_error_per_second(limit, msg) \
+    EAL_WRITE_LIMITED(PER_SECOND, limit, EAL_ERROR, msg)
+
+/**
+ * @def EAL_SAMPLER()
+ * @brief Static Sampler object that belongs to the call site of the macro
+ */
+#define EAL_SAMPLER()                                    \
+    []() -> ealogger::Sampler & {                        \
+        static ealogger::Sampler eal_sampler ATTR_USED;  \
+        return eal_sampler;                              \
+    }()
+
+/**
+ * @def EAL_WRITE_SAMPLED(type, value, lvl, msg)
+ * @brief Write a sampled message, used by the *_sampled and *_sampled_rate
+ * macros
+ *
+ * @details
+ * \p msg is only evaluated if the message has been chosen by the sampler.
+ */
+#define EAL_WRITE_SAMPLED(type, value, lvl, msg)                            \
+    write_log_sampled(EAL_CALLSITE(lvl), EAL_SAMPLER(),                     \
+                      ealogger::Sampler::SAMPLE_TYPE::type, value,          \
+                      EAL_LAZY(msg), __func__)
+
+/**
+ * @def eal_debug_sampled(n, msg)
+ * @brief Write on average one in \p n debug messages from this line
+ */
+#define eal_debug_sampled(n, msg) EAL_WRITE_SAMPLED(ONE_IN_N, n, EAL_DEBUG, msg)
+/**
+ * @def eal_info_sampled(n, msg)
+ * @brief Write on average one in \p n info messages from this line
+ */
+#define eal_info_sampled(n, msg) EAL_WRITE_SAMPLED(ONE_IN_N, n, EAL_INFO, msg)
+/**
+ * @def eal_debug_sampled_rate(rate, msg)
+ * @brief Write on average \p rate debug messages per second from this line
+ */
+#define eal_debug_sampled_rate(rate, msg) \
+    EAL_WRITE_SAMPLED(RATE, rate, EAL_DEBUG, msg)
+/**
+ * @def eal_info_sampled_rate(rate, msg)
+ * @brief Write on average \p rate info messages per second from this line
+ */
+#define eal_info_sampled_rate(rate, msg) \
+    EAL_WRITE_SAMPLED(RATE, rate, EAL_INFO, msg)
+
+class ChildLogger;
+class Logger;
+
+/**
+ * @brief Handle to a named Sink of a Logger
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * Returned by Logger::add_file_sink and Logger::get_sink. The handle
+ * reconfigures the Sink with the same locking the Logger uses and keeps the
+ * Logger informed about changed severities. A default constructed handle or a
+ * handle returned for an unknown name is not valid, all methods do nothing
+ * then.
+ *
+ * After Logger::remove_sink the handle still works but the Sink does not get
+ * messages anymore. A handle must not outlive its Logger.
+ */
+class SinkHandle
+{
+public:
+    SinkHandle();
+
+    /**
+     * @brief Check if the handle refers to a Sink
+     */
+    bool is_valid() const;
+    /**
+     * @brief Get the name the Sink was added with
+     */
+    const std::string &get_name() const;
+
+    /**
+     * @brief Enable or disable the Sink
+     */
+    void set_enabled(bool enabled);
+    /**
+     * @brief Set the minimum severity of the Sink
+     */
+    void set_min_lvl(ealogger::constants::LOG_LEVEL min_level);
+    /**
+     * @brief Set the message template of the Sink
+     */
+    void set_msg_template(std::string msg_template);
+    /**
+     * @brief Set the datetime pattern of the Sink
+     */
+    void set_datetime_pattern(std::string datetime_pattern);
+    /**
+     * @brief Keep a backtrace of messages below the minimum severity
+     *
+     * @sa
+     * Logger::set_backtrace
+     */
+    void set_backtrace(std::size_t size);
+    /**
+     * @brief Get statistics of the Sink
+     */
+    SinkStats get_stats();
+
+private:
+    friend class Logger;
+
+    SinkHandle(Logger *logger, std::string name, std::shared_ptr<Sink> sink,
+               std::shared_ptr<std::mutex> mtx);
+
+    Logger *logger;
+    std::string name;
+    std::shared_ptr<Sink> sink;
+    std::shared_ptr<std::mutex> mtx; /**< Mutex the Logger uses for sink */
+};
 
 /**
  * @brief ealogger main class
@@ -138,6 +428,14 @@ namespace ealogger
  * #eal_warn(msg) #eal_error(msg) #eal_fatal(msg) #eal_stack())
  * Logger::write_log allows you to write log messages without using these macros.
  *
+ * Every macro call site is registered in the CallSiteRegistry and can be
+ * switched on or off at runtime.
+ *
+ * Call sites that may fire in a tight loop can be rate limited with the
+ * *_every_n, *_first_n and *_per_second variants of these macros, e.g.
+ * #eal_warn_every_n(n, msg) or #eal_warn_per_second(limit, msg). Suppressed
+ * messages are counted per call site and reported periodically.
+ *
  * ealogger and its sinks are threadsafe. Meaning if you use the same instance all
  * over your application it will make sure only one message at a time is written
  * to an iostream for example and the internal message queue is synchronized.
@@ -170,8 +468,9 @@ public:
      *
      * @details
      *
-     * This method is called by the macros that are defined in this header file
-     * for the different log levels. You can of course call this method yourself
+     * The macros that are defined in this header file use
+     * Logger::write_log_site instead. You can of course call this method
+     * yourself, it does not belong to any CallSite
      * @code
      * mylogger.write_log("This is a warning", ealogger::constants::LOG_LEVEL::EAL_WARNING,
      *                    __FILE__, __LINE__, __func__);
@@ -198,6 +497,205 @@ public:
      */
     void write_log(std::string msg, ealogger::constants::LOG_LEVEL lvl);
 
+    /**
+     * @brief Write a log message from a CallSite
+     *
+     * @param site CallSite of the macro
+     * @param msg_fn Callable returning the message text
+     * @param func Function name
+     *
+     * @details
+     * This method is called by the macros for the different log levels. If
+     * \p site has been disabled in the CallSiteRegistry, the log level of
+     * the site does not pass Logger::will_write or the sampler of the log
+     * level drops the message, the method returns right away and \p msg_fn
+     * is never called.
+     */
+    template <typename F>
+    void write_log_site(CallSite &site, F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->write_site_named(this->root_name, site, std::move(msg_fn),
+                                   func);
+    }
+
+    /**
+     * @brief Write a log message if the call site rate limiter allows it
+     *
+     * @param site CallSite of the macro
+     * @param limiter RateLimiter of the call site
+     * @param type Rate limiting strategy
+     * @param limit Parameter for the rate limiting strategy
+     * @param msg_fn Callable returning the message text. Only called if the
+     * message passes the limiter and the sampler of the log level
+     * @param func Function name
+     *
+     * @details
+     * This method is used by the rate limiting macros like
+     * #eal_warn_every_n(n, msg). If the limiter has suppressed messages since
+     * its last report an additional message with the number of suppressed
+     * messages is written for this call site.
+     */
+    template <typename F>
+    void write_log_limited(CallSite &site, RateLimiter &limiter,
+                           RateLimiter::LIMIT_TYPE type, std::uint64_t limit,
+                           F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->write_limited_named(this->root_name, site, limiter, type,
+                                      limit, std::move(msg_fn), func);
+    }
+
+    /**
+     * @brief Write a log message if the call site sampler chooses it
+     *
+     * @param site CallSite of the macro
+     * @param sampler Sampler of the call site
+     * @param type Sampling strategy
+     * @param value Parameter for the sampling strategy
+     * @param msg_fn Callable returning the message text. Only called if the
+     * message has been chosen
+     * @param func Function name
+     *
+     * @details
+     * This method is used by the sampling macros like
+     * #eal_debug_sampled(n, msg). The call site sampler replaces the sampler
+     * of the log level, the message is still counted in
+     * Logger::get_sample_stats.
+     */
+    template <typename F>
+    void write_log_sampled(CallSite &site, Sampler &sampler,
+                           Sampler::SAMPLE_TYPE type, std::uint64_t value,
+                           F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->write_sampled_named(this->root_name, site, sampler, type,
+                                      value, std::move(msg_fn), func);
+    }
+
+    /**
+     * @brief Get a named child logger
+     *
+     * @param name Name of the logger, a dot separated hierarchy like "net.http"
+     *
+     * @return Reference to the ChildLogger, valid as long as this Logger exists
+     *
+     * @details
+     * Child loggers are lightweight handles that share the message queue and
+     * the sinks of this Logger. Each of them has a log level that is inherited
+     * from its parent ("net" for "net.http") unless it was set explicitly with
+     * Logger::set_level. The logger name is available in message templates
+     * with the conversion pattern %c.
+     *
+     * @code
+     * ealogger::ChildLogger &http = logger.get("net.http");
+     * logger.set_level(ealogger::constants::LOG_LEVEL::EAL_WARNING);
+     * logger.set_level("net.http", ealogger::constants::LOG_LEVEL::EAL_DEBUG);
+     * http.eal_debug("Only net.http and its children write debug messages");
+     * @endcode
+     */
+    ChildLogger &get(const std::string &name);
+
+    /**
+     * @brief Set the log level of this Logger
+     *
+     * @param lvl Messages with a lower severity are discarded right away
+     *
+     * @details
+     * The log level of a Logger is checked before a message is created, while
+     * the minimum severity of a Sink (Logger::set_min_lvl) is checked in the
+     * Sink. Child loggers without an explicit level inherit this level.
+     */
+    void set_level(ealogger::constants::LOG_LEVEL lvl);
+    /**
+     * @brief Set the log level of a child logger and all its descendants that
+     * do not have an explicit level
+     *
+     * @param name Name of the child logger
+     * @param lvl
+     */
+    void set_level(const std::string &name, ealogger::constants::LOG_LEVEL lvl);
+    /**
+     * @brief Let a child logger inherit its log level from its parent again
+     *
+     * @param name Name of the child logger
+     */
+    void reset_level(const std::string &name);
+    /**
+     * @brief Get the log level of this Logger
+     *
+     * @return Log level
+     */
+    ealogger::constants::LOG_LEVEL get_level();
+
+    /**
+     * @brief Check whether messages with severity \p lvl pass the log level
+     *
+     * @param lvl
+     *
+     * @return True if a message would be created
+     */
+    bool is_enabled(ealogger::constants::LOG_LEVEL lvl)
+    {
+        return static_cast<int>(lvl) >=
+               this->level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check whether a message with severity \p lvl would be written
+     *
+     * @param lvl
+     *
+     * @return True if the message passes the log level and at least one
+     * enabled Sink or the FlightRecorder accepts the severity
+     *
+     * @details
+     * The lowest severity any Sink accepts is cached whenever a Sink is
+     * changed, so this costs two relaxed atomic loads.
+     */
+    bool will_write(ealogger::constants::LOG_LEVEL lvl)
+    {
+        return this->is_enabled(lvl) &&
+               static_cast<int>(lvl) >=
+                   this->write_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sample messages of a log level
+     *
+     * @param lvl Log level
+     * @param type Sampling strategy
+     * @param value Parameter for the sampling strategy, n for ONE_IN_N and
+     * messages per second for RATE
+     *
+     * @details
+     * Sampling lets you keep some visibility of high volume log levels like
+     * DEBUG or INFO without paying for all of them. The decision is made before
+     * a LogMessage is created. Every written message carries its sampling
+     * weight, add the conversion pattern %w to your message template to see
+     * it.
+     *
+     * Use Sampler::SAMPLE_TYPE::NONE to disable sampling for \p lvl again.
+     *
+     * @sa
+     * Sampler
+     */
+    void set_sampling(ealogger::constants::LOG_LEVEL lvl,
+                      Sampler::SAMPLE_TYPE type, std::uint64_t value);
+
+    /**
+     * @brief Get the exact number of seen and written messages of a log level
+     *
+     * @param lvl Log level
+     *
+     * @return SampleStats
+     *
+     * @details
+     * Messages are only counted while sampling is set for \p lvl or when
+     * they come from one of the sampling macros.
+     */
+    SampleStats get_sample_stats(ealogger::constants::LOG_LEVEL lvl);
+
     /**
      * @brief Init a syslog Sink
      *
@@ -250,13 +748,20 @@ public:
      * @param msg_template Message template based on conversion patterns
      * @param datetime_pattern Datetime conversion patterns
      * @param logfile Logfile to use
-     * @param flush_buffer Flush the ofstream buffer with every message
+     * @param flush_buffer Write every message to the file immediately
      * @details
      *
      * This method initializes a file sink. Using a file sink you can write to
      * a logfile that was specified with \p logfile. The file will be created if
      * it does not exist otherwise new messages will be appended.
      *
+     * Messages are collected in a buffer and written with one system call
+     * when the buffer is full, the flush interval has passed or a message
+     * with the flush severity or higher arrives. This is much faster than
+     * writing every message on its own while errors still reach the file
+     * right away. Use the overload with SinkFile::Options to tune buffering,
+     * io_uring, durability and the index.
+     *
      * @note
      * ealogger will not create any directories for you and you have to make sure
      * the target location is writeable by the user that runs the application.
@@ -272,11 +777,293 @@ public:
                         std::string datetime_pattern = "%F %T",
                         std::string logfile = "ealogger_logfile.log",
                         bool flush_buffer = false);
-    // void init_file_sink_rotating(bool enabled,
-    // ealogger::constants::LOG_LEVEL min_lvl,
-    // std::string msg_template,
-    // std::string datetime_pattern,
-    // std::string logfile);
+    /**
+     * @brief Initialize the simple file Sink with tuning options
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param logfile Logfile to use
+     * @param options Buffering, durability and index settings
+     * @details
+     *
+     * With SinkFile::Options#io_uring_depth greater than 0 the buffers are
+     * written asynchronously so a slow disk does not block the logger thread.
+     * If io_uring is not available the sink silently uses blocking writes,
+     * Logger::get_sink_stats tells you which one is used.
+     *
+     * SinkFile::Options#durability controls when the file is synced to stable
+     * storage. DURABILITY::PERIODIC calls fdatasync every
+     * SinkFile::Options#sync_interval. With DURABILITY::GROUP_COMMIT logging a
+     * message with severity SinkFile::Options#flush_lvl or higher returns
+     * only after a sync covering it has finished. Threads logging at the same
+     * time share one sync.
+     *
+     * SinkFile::Options#index_block writes a LogIndex in logfile.idx that
+     * lets the ealogger_query tool jump to a time range or to the blocks with
+     * errors without reading the whole logfile. An entry of 40 bytes per
+     * block is written, 65536 is a good start.
+     *
+     * @sa
+     * Logger::init_file_sink(bool, ealogger::constants::LOG_LEVEL,
+     * std::string, std::string, std::string, bool)
+     */
+    void init_file_sink(bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                        std::string msg_template, std::string datetime_pattern,
+                        std::string logfile, const SinkFile::Options &options);
+
+    /**
+     * @brief Initialize the file Sink that bypasses the page cache
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param logfile Logfile
+     * @param options Buffer size, flush interval and flush severity
+     * @param block_size Alignment required by the device
+     * @details
+     *
+     * An alternative to the simple file sink for hosts where the log file
+     * should not compete with other applications for the page cache. The
+     * logfile is opened with O_DIRECT and written in aligned blocks.
+     * SinkFile::Options#buffer_size is rounded up to whole blocks, the
+     * durability, io_uring and index settings are not used.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_FILE_DIRECT to change the
+     * settings of this sink.
+     *
+     * @sa
+     * SinkFileDirect
+     */
+    void init_file_direct_sink(bool enabled = true,
+                               ealogger::constants::LOG_LEVEL min_lvl =
+                                   ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                               std::string msg_template = "%d %s [%f:%l] %m",
+                               std::string datetime_pattern = "%F %T",
+                               std::string logfile = "ealogger_logfile.log",
+                               const SinkFile::Options &options =
+                                   SinkFile::Options(),
+                               std::size_t block_size = 4096);
+
+    /**
+     * @brief Initialize the binary file Sink
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template stored in the file for rendering
+     * @param datetime_pattern Datetime pattern stored in the file
+     * @param logfile Logfile
+     * @param options Buffering, io_uring, durability and index settings like
+     * for the simple file sink
+     * @param checksums End every record with a CRC-32C
+     * @details
+     *
+     * Messages are written as binary records instead of rendered lines. The
+     * files are smaller and keep every field of a message, but the sink is
+     * not much faster than a buffered simple file sink. The file has to be
+     * rendered with a tool before humans can read it.
+     *
+     * With \p checksums a record that was torn by a crash or power loss is
+     * detected. The sink cuts it off when it opens the file again and
+     * readers skip damaged records in the middle of the file.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_FILE_BINARY to change the
+     * settings of this sink.
+     *
+     * @sa
+     * SinkFileBinary
+     */
+    void init_file_binary_sink(bool enabled = true,
+                               ealogger::constants::LOG_LEVEL min_lvl =
+                                   ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                               std::string msg_template = "%d %s [%f:%l] %m",
+                               std::string datetime_pattern = "%F %T",
+                               std::string logfile = "ealogger_logfile.eal",
+                               const SinkFile::Options &options =
+                                   SinkFile::Options(),
+                               bool checksums = false);
+
+    /**
+     * @brief Initialize the compressed file Sink
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param logfile Logfile
+     * @param options Frame size and flush interval
+     * @param compression_level zlib compression level from 1 to 9
+     * @details
+     *
+     * Writes a gzip file that is compressed on the fly by a separate thread.
+     * Every frame is a gzip member of its own so the file can be read with
+     * zcat up to the last complete frame at any time.
+     * SinkFile::Options#buffer_size is the uncompressed size of a frame and
+     * SinkFile::Options#flush_interval the maximum time a message is held in
+     * a frame.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_FILE_GZIP to change the
+     * settings of this sink.
+     *
+     * @sa
+     * SinkFileGzip
+     */
+    void init_file_gzip_sink(bool enabled = true,
+                             ealogger::constants::LOG_LEVEL min_lvl =
+                                 ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                             std::string msg_template = "%d %s [%f:%l] %m",
+                             std::string datetime_pattern = "%F %T",
+                             std::string logfile = "ealogger_logfile.log.gz",
+                             const SinkFile::Options &options =
+                                 SinkFile::Options(),
+                             int compression_level = 6);
+
+    /**
+     * @brief Initialize the memory mapped file Sink
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param logfile Base name of the segment files
+     * @param segment_size Size of one segment file in bytes
+     * @details
+     *
+     * A peer of the simple file sink that writes to preallocated segment
+     * files named *logfile.0*, *logfile.1* and so on. The segments are mapped
+     * into memory so writing a message is a memcpy and the kernel writes the
+     * pages back to disk. Every segment is truncated to the size that was used
+     * when the sink switches to the next segment or is closed.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_FILE_MMAP to change the
+     * settings of this sink.
+     *
+     * @sa
+     * SinkFileMmap
+     */
+    void init_file_mmap_sink(bool enabled = true,
+                             ealogger::constants::LOG_LEVEL min_lvl =
+                                 ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                             std::string msg_template = "%d %s [%f:%l] %m",
+                             std::string datetime_pattern = "%F %T",
+                             std::string logfile = "ealogger_logfile.log",
+                             std::size_t segment_size = 16 * 1024 * 1024);
+    /**
+     * @brief Initialize the rotating file Sink
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param logfile Logfile
+     * @param max_size Rotate before the logfile grows beyond this size in
+     * bytes, 0 disables size based rotation
+     * @param interval Rotate when a new interval starts, 0 disables time based
+     * rotation
+     * @param retention Number of rotated files to keep, 0 keeps all of them
+     * @param naming Naming scheme for rotated files
+     * @param options Buffering, io_uring and durability settings, rotated
+     * files have no index
+     * @details
+     *
+     * Like the simple file sink but the logfile is rotated by ealogger
+     * itself, there is no need for an external logrotate with copytruncate.
+     * Rotation is done by the sink in the logger thread, no message is lost
+     * or written twice.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_FILE_ROTATING to change the
+     * settings of this sink.
+     *
+     * @sa
+     * SinkFileRotating
+     */
+    void init_file_sink_rotating(
+        bool enabled = true,
+        ealogger::constants::LOG_LEVEL min_lvl =
+            ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+        std::string msg_template = "%d %s [%f:%l] %m",
+        std::string datetime_pattern = "%F %T",
+        std::string logfile = "ealogger_logfile.log",
+        std::uint64_t max_size = 10 * 1024 * 1024,
+        std::chrono::seconds interval = std::chrono::seconds(0),
+        std::size_t retention = 5,
+        SinkFileRotating::NAMING naming = SinkFileRotating::NAMING::INDEX,
+        const SinkFile::Options &options = SinkFile::Options());
+    /**
+     * @brief Initialize the shared memory Sink
+     *
+     * @param enabled Choose whether this sink is enabled or not
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param name Name of the shared memory object, has to start with a slash
+     * @param capacity Size of the ring buffer in bytes
+     * @param format Write rendered lines or binary messages the collector
+     * renders
+     * @details
+     *
+     * Messages are copied into a ring buffer in shared memory that a
+     * collector process like ealogger_collect drains. The application does
+     * no file I/O for this sink and the messages in the ring survive a crash
+     * of the application. Messages are dropped if the collector does not
+     * keep up.
+     *
+     * Use ealogger::constants::LOGGER_SINK::EAL_SHM to change the settings of
+     * this sink.
+     *
+     * @sa
+     * SinkShm
+     */
+    void init_shm_sink(bool enabled = true,
+                       ealogger::constants::LOG_LEVEL min_lvl =
+                           ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                       std::string msg_template = "%d %s [%f:%l] %m",
+                       std::string datetime_pattern = "%F %T",
+                       std::string name = "/ealogger",
+                       std::size_t capacity = 4 * 1024 * 1024,
+                       ShmRing::FORMAT format = ShmRing::FORMAT::LINES);
+
+    /**
+     * @brief Record every message in a FlightRecorder
+     *
+     * @param path File of the ring
+     * @param size Size of the ring in bytes
+     * @param min_lvl Lowest severity that is recorded, independent of the
+     * minimum severity of the sinks
+     * @param replay_bytes If the previous process crashed, write the last
+     * \p replay_bytes of its recorder to the sinks, 0 writes nothing
+     *
+     * @details
+     * The flight recorder is a black box, a fixed size ring in a memory
+     * mapped file that always holds the most recent messages. Messages are
+     * copied into it by the thread that logs them, before they are queued
+     * for the sinks, so they are in the file even if the process crashes
+     * right after. Messages that only the recorder accepts are never queued
+     * and are recorded without allocating memory for a LogMessage. The log
+     * level of the Logger, rate limiting and sampling still apply.
+     *
+     * If the file has records of a previous process, it is kept as
+     * \<path\>.prev. A warning is logged if that process did not shut down
+     * cleanly. Use FlightRecorder::recover or the ealogger_recover tool to
+     * read the files.
+     *
+     * A recorder that is replaced by another call is kept until the Logger
+     * is destroyed, other threads may still use it.
+     *
+     * @sa
+     * FlightRecorder
+     */
+    void init_flight_recorder(std::string path = "ealogger_flight.rec",
+                              std::size_t size = 16 * 1024 * 1024,
+                              ealogger::constants::LOG_LEVEL min_lvl =
+                                  ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                              std::size_t replay_bytes = 0);
+    /**
+     * @brief Stop recording messages in the FlightRecorder
+     */
+    void discard_flight_recorder();
     /**
      * @brief Discard a Sink and delete the object
      *
@@ -339,6 +1126,148 @@ public:
     void set_min_lvl(ealogger::constants::LOGGER_SINK sink,
                      ealogger::constants::LOG_LEVEL min_level);
 
+    /**
+     * @brief Collapse consecutive identical messages for a Sink
+     *
+     * @param sink
+     * @param collapse Enable or disable collapsing
+     * @param flush_timeout Maximum time a repeat count is held back
+     *
+     * @details
+     * Like syslogd the Sink will write *Last message repeated N times* instead
+     * of rendering and writing the same message over and over again. A message
+     * is considered a repetition if severity, call site and text are equal to
+     * the message before. The repeat count is written when a different message
+     * arrives or after \p flush_timeout.
+     *
+     * @sa
+     * Sink::set_collapse_repeated
+     */
+    void set_collapse_repeated(ealogger::constants::LOGGER_SINK sink,
+                               bool collapse,
+                               std::chrono::milliseconds flush_timeout =
+                                   std::chrono::milliseconds(30000));
+
+    /**
+     * @brief Keep messages below the minimum severity of a Sink as error
+     * context
+     *
+     * @param sink
+     * @param size Number of messages to keep, 0 disables the backtrace
+     *
+     * @details
+     * Messages below the minimum severity of \p sink are held in a ring buffer
+     * instead of being dropped. They are neither rendered nor written until a
+     * message with severity EAL_ERROR or EAL_FATAL arrives at the sink. Then
+     * the buffered messages are written first with their original
+     * timestamps. This gives you debug context for failures while normal
+     * operation only pays for storing a pointer.
+     *
+     * Messages below the level of the Logger never reach a Sink and can not
+     * be part of the backtrace.
+     *
+     * @sa
+     * Sink::set_backtrace
+     */
+    void set_backtrace(ealogger::constants::LOGGER_SINK sink, std::size_t size);
+
+    /**
+     * @brief Get statistics of a Sink
+     *
+     * @param sink
+     *
+     * @return SinkStats object, all values are 0 if the sink does not exist
+     * or does not collect statistics
+     *
+     * @details
+     * The file sink reports whether io_uring is used, how many writes are in
+     * flight and their completion latency.
+     */
+    SinkStats get_sink_stats(ealogger::constants::LOGGER_SINK sink);
+
+    /**
+     * @brief Add a named file Sink
+     *
+     * @param name Name of the Sink, an existing Sink with this name is
+     * replaced
+     * @param logfile Logfile
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param flush_buffer Write every message to the file immediately
+     *
+     * @return Handle to reconfigure the Sink
+     *
+     * @details
+     * The sinks set up with the init methods exist once per
+     * ealogger::constants::LOGGER_SINK value. Named sinks can be added as
+     * often as you like, for example to write errors, audit and access
+     * messages to different files. They get every message like the other
+     * sinks, use the minimum severity or a message template to separate
+     * them.
+     *
+     * @sa
+     * init_file_sink
+     */
+    SinkHandle add_file_sink(const std::string &name, std::string logfile,
+                             ealogger::constants::LOG_LEVEL min_lvl =
+                                 ealogger::constants::LOG_LEVEL::EAL_DEBUG,
+                             std::string msg_template = "%d %s [%f:%l] %m",
+                             std::string datetime_pattern = "%F %T",
+                             bool flush_buffer = false);
+    /**
+     * @brief Add a named file Sink with tuning options
+     *
+     * @param name Name of the Sink, an existing Sink with this name is
+     * replaced
+     * @param logfile Logfile
+     * @param min_lvl Minimum severity for this sink
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Datetime conversion patterns
+     * @param options Buffering, durability and index settings
+     *
+     * @return Handle to reconfigure the Sink
+     */
+    SinkHandle add_file_sink(const std::string &name, std::string logfile,
+                             ealogger::constants::LOG_LEVEL min_lvl,
+                             std::string msg_template,
+                             std::string datetime_pattern,
+                             const SinkFile::Options &options);
+    /**
+     * @brief Add a user defined Sink
+     *
+     * @param name Name of the sink, an existing sink with this name is replaced
+     * @param sink Your Sink implementation
+     *
+     * @return Handle to reconfigure the Sink, not valid if \p sink is empty
+     *
+     * @details
+     * The Sink is handled like the ones added with add_file_sink. See the
+     * documentation of Sink for the methods you have to implement and the
+     * guarantees the Logger gives.
+     */
+    SinkHandle add_sink(const std::string &name, std::shared_ptr<Sink> sink);
+    /**
+     * @brief Get a handle to a named Sink
+     *
+     * @param name
+     *
+     * @return Handle, not valid if there is no Sink with this name
+     */
+    SinkHandle get_sink(const std::string &name);
+    /**
+     * @brief Remove a named Sink
+     *
+     * @param name
+     *
+     * @details
+     * Buffered messages of the Sink are written before this returns, the
+     * Logger does not call the Sink afterwards.
+     *
+     * @return True if a Sink was removed
+     */
+    bool remove_sink(const std::string &name);
+
     /**
      * @brief Check if the message queue is empty
      *
@@ -347,10 +1276,37 @@ public:
     bool queue_empty();
 
 private:
+    friend class ChildLogger;
+    friend class SinkHandle;
+
     /** Mutex used when not in async mode */
     std::mutex mtx_logger_stop;
 
-    static bool signal_SIGUSR1;
+    /** Name of this Logger for conversion pattern %c */
+    const std::string root_name;
+    /** Log level of this Logger */
+    std::atomic<int> level;
+    /** Lowest severity accepted by an enabled Sink */
+    std::atomic<int> sink_level;
+    /** Lowest severity accepted by a Sink or the flight recorder */
+    std::atomic<int> write_level;
+    /** Serializes Logger::update_sink_level */
+    std::mutex mtx_sink_level;
+    /** Lowest severity a Sink commits to disk, see Sink::get_commit_lvl */
+    std::atomic<int> commit_level;
+    /** Mutex for Logger#processed */
+    std::mutex mtx_processed;
+    /** Notified when the background thread has handled a batch */
+    std::condition_variable cond_processed;
+    /** Messages the background thread has handed over to all sinks */
+    std::uint64_t processed;
+    /** Mutex for Logger#child_loggers and the explicit child levels */
+    std::mutex mtx_child_loggers;
+    /** All child loggers sorted by name, parents come before their children */
+    std::map<std::string, std::unique_ptr<ChildLogger>> child_loggers;
+
+    /** Last reopen request the background thread has handled */
+    unsigned int reopen_seen;
 
     bool async;
 
@@ -360,23 +1316,268 @@ private:
     std::thread logger_thread;
     /** Controls background logger thread */
     bool logger_thread_stop;
+    /** Interval in which the background thread calls Sink::tick */
+    static const std::chrono::milliseconds tick_interval;
+    /** Maximum number of messages the background thread handles at once */
+    static const std::size_t max_batch = 256;
+
+    /**
+     * @brief Sampling configuration and counters for one log level
+     */
+    struct LevelSampler {
+        Sampler sampler;
+        std::atomic<Sampler::SAMPLE_TYPE> type;
+        std::atomic<std::uint64_t> value;
+    };
+    LevelSampler level_samplers[ealogger::constants::LOG_LEVEL_COUNT];
 
     std::map<ealogger::constants::LOGGER_SINK, std::shared_ptr<Sink>>
         logger_sink_map;
-    std::map<ealogger::constants::LOGGER_SINK, std::unique_ptr<std::mutex>>
+    std::map<ealogger::constants::LOGGER_SINK, std::shared_ptr<std::mutex>>
         logger_mutex_map;
 
-    /** Static Method to be registered for logrotate signal */
+    /**
+     * @brief A Sink and the mutex that serializes access to it
+     */
+    struct SinkSlot {
+        std::shared_ptr<Sink> sink;
+        std::shared_ptr<std::mutex> mtx;
+        /**
+         * Set with SinkSlot#mtx locked when the Sink was removed or replaced,
+         * an older snapshot of Logger#dispatch may still contain the slot.
+         * Empty for the built-in sinks.
+         */
+        std::shared_ptr<bool> removed;
+
+        /**
+         * @brief Check whether the Sink may still be called
+         * @details
+         * SinkSlot#mtx has to be locked when calling this method
+         */
+        bool active() const { return !this->removed || !*this->removed; }
+    };
+    /** Sinks added with Logger::add_file_sink */
+    std::map<std::string, SinkSlot> named_sinks;
+    /**
+     * All sinks messages are dispatched to. Replaced as a whole when a sink
+     * is added or removed, the background thread works on the snapshot it
+     * loaded with std::atomic_load.
+     */
+    std::shared_ptr<const std::vector<SinkSlot>> dispatch;
+    /** Serializes changes of the sink maps and Logger#dispatch */
+    std::mutex mtx_dispatch;
+
+    /**
+     * @brief A rate limited call site registered with Logger::add_rate_report
+     */
+    struct RateReport {
+        std::string logger_name;
+        CallSite *site;
+        RateLimiter::LIMIT_TYPE type;
+        std::uint64_t limit;
+        const char *func;
+    };
+    /** Call sites this Logger suppressed messages of */
+    std::map<RateLimiter *, RateReport> rate_reports;
+    /** Mutex for Logger#rate_reports */
+    std::mutex mtx_rate_reports;
+    /** steady_clock time in ms when a synchronous Logger reports next */
+    std::atomic<std::int64_t> next_rate_report;
+
+    /** FlightRecorder messages are copied to, nullptr if there is none */
+    std::atomic<FlightRecorder *> recorder;
+    /** Owns the current and all replaced flight recorders */
+    std::vector<std::unique_ptr<FlightRecorder>> recorders;
+    /** Mutex for Logger#recorders */
+    std::mutex mtx_recorder;
+
+    /**
+     * @brief Static Method to be registered for logrotate signal
+     *
+     * @details
+     * Only writes one byte to a pipe, which is async-signal-safe. The signal
+     * watcher thread reads it and asks all Loggers to reopen their sinks.
+     */
     static void logrotate(int signo);
+    /**
+     * @brief Entry point of the thread that waits for SIGUSR1
+     *
+     * @details
+     * Background threads of asynchronous Loggers are woken up and reopen
+     * their sinks between two batches. Synchronous Loggers have no thread so
+     * their sinks are reopened right away.
+     */
+    static void signal_watcher();
 
     void thread_entry_point();
 
+    /**
+     * @brief Apply the sampler of the log level and push the message
+     *
+     * @details
+     * The log level of the calling logger has already been checked.
+     */
+    void write_log_named(const std::string &logger_name, std::string msg,
+                         ealogger::constants::LOG_LEVEL lvl, std::string file,
+                         int lnumber, std::string func);
+
+    /**
+     * @brief Ask the sampler of a log level whether a message is written
+     *
+     * @param lvl Log level
+     * @param weight Set to the sampling weight of the message
+     */
+    bool sample_level(ealogger::constants::LOG_LEVEL lvl,
+                      std::uint32_t &weight)
+    {
+        LevelSampler &ls = this->level_samplers[static_cast<int>(lvl)];
+        return ls.sampler.sample(ls.type.load(std::memory_order_relaxed),
+                                 ls.value.load(std::memory_order_relaxed),
+                                 weight);
+    }
+
+    /**
+     * @brief Apply the sampler of the log level before the message text of a
+     * CallSite is evaluated
+     */
+    template <typename F>
+    void write_site_named(const std::string &logger_name, CallSite &site,
+                          F msg_fn, const char *func)
+    {
+        std::uint32_t weight = 1;
+        if (this->sample_level(site.level, weight))
+            this->push_log_message(msg_fn(), site.level, site.file, site.line,
+                                   func, weight, logger_name);
+    }
+
+    template <typename F>
+    void write_limited_named(const std::string &logger_name, CallSite &site,
+                             RateLimiter &limiter, RateLimiter::LIMIT_TYPE type,
+                             std::uint64_t limit, F msg_fn, const char *func)
+    {
+        std::uint64_t suppressed = 0;
+        bool pass = limiter.allow(type, limit, suppressed);
+        if (suppressed > 0) {
+            this->write_log_named(logger_name,
+                                  "Rate limit suppressed " +
+                                      std::to_string(suppressed) + " messages",
+                                  site.level, site.file, site.line, func);
+        }
+        if (pass) {
+            this->write_site_named(logger_name, site, std::move(msg_fn), func);
+        } else {
+            if (!limiter.is_reported_by(this))
+                this->add_rate_report(logger_name, site, limiter, type, limit,
+                                      func);
+            if (!this->async)
+                this->sync_rate_reports();
+        }
+    }
+
+    /**
+     * @brief Remember a rate limited call site that suppressed a message
+     *
+     * @details
+     * Its suppressed messages are reported by Logger::write_rate_reports even
+     * if the call site never passes again. A call site is registered once per
+     * Logger, with the logger name of its first suppressed message.
+     */
+    void add_rate_report(const std::string &logger_name, CallSite &site,
+                         RateLimiter &limiter, RateLimiter::LIMIT_TYPE type,
+                         std::uint64_t limit, const char *func);
+    /**
+     * @brief Write the pending suppression reports of all registered call
+     * sites
+     *
+     * @param force Ignore RateLimiter#report_interval_ms
+     *
+     * @details
+     * Called by the background thread on every tick and by the destructor.
+     * The reports are handed to the sinks directly, the background thread
+     * must not wait for its own queue.
+     */
+    void write_rate_reports(bool force);
+    /**
+     * @brief Write the pending suppression reports at most once per
+     * Logger#tick_interval
+     * @details
+     * A synchronous Logger has no background thread, this is called when it
+     * writes or suppresses a message.
+     */
+    void sync_rate_reports();
+
+    template <typename F>
+    void write_sampled_named(const std::string &logger_name, CallSite &site,
+                             Sampler &sampler, Sampler::SAMPLE_TYPE type,
+                             std::uint64_t value, F msg_fn, const char *func)
+    {
+        std::uint32_t weight = 1;
+        bool pass = sampler.sample(type, value, weight);
+        this->level_samplers[static_cast<int>(site.level)].sampler.record(pass);
+        if (pass) {
+            this->push_log_message(msg_fn(), site.level, site.file, site.line,
+                                   func, weight, logger_name);
+        }
+    }
+
+    /**
+     * @brief Create a LogMessage and hand it over to the flight recorder and
+     * the queue or the sinks
+     */
+    void push_log_message(std::string msg, ealogger::constants::LOG_LEVEL lvl,
+                          std::string file, int lnumber, std::string func,
+                          std::uint32_t weight, const std::string &logger_name);
+
+    /**
+     * @brief Recalculate the effective level of all child loggers
+     * @details
+     * Logger#mtx_child_loggers has to be locked when calling this method
+     */
+    void update_child_levels();
+    /**
+     * @brief Recalculate Logger#sink_level, Logger#write_level and
+     * Logger#commit_level after a Sink or the flight recorder has been
+     * changed
+     * @details
+     * None of the sink mutexes may be locked when calling this method
+     */
+    void update_sink_level();
+    /**
+     * @brief Build a new Logger#dispatch after a Sink was added or removed
+     */
+    void rebuild_dispatch();
+    /**
+     * @brief Add or replace a named Sink
+     */
+    SinkHandle add_named_sink(const std::string &name,
+                              std::shared_ptr<Sink> sink);
+
     /**
      * @brief This method writes the LogMessage to all activated sinks
      *
      * @param m LogMessage
      */
     void internal_log_routine(std::shared_ptr<LogMessage> m);
+    /**
+     * @brief This method writes a batch of LogMessage objects to all
+     * activated sinks
+     *
+     * @param batch LogMessage objects in the order they were logged
+     */
+    void internal_log_batch_routine(
+        const std::vector<std::shared_ptr<LogMessage>> &batch);
+    /**
+     * @brief Call Sink::tick for all sinks
+     */
+    void internal_tick_routine();
+    /**
+     * @brief Call Sink::flush for all sinks
+     */
+    void internal_flush_routine();
+    /**
+     * @brief Call Sink::reopen for all sinks
+     */
+    void internal_reopen_routine();
 
     /*
      * So far controlling the background logger thread is only possible for the
@@ -385,6 +1586,167 @@ private:
     bool get_logger_thread_stop();
     void set_logger_thread_stop(bool stop);
 };
+
+/**
+ * @brief A named logger that shares queue and sinks with its Logger
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * Child loggers are created with Logger::get and live as long as the Logger
+ * they belong to. They support the same macros as the Logger itself.
+ *
+ * The effective log level of a child logger is cached, checking if a message
+ * passes is a single atomic load. When a level changes the Logger recalculates
+ * the cached levels of all affected child loggers, logging threads are never
+ * locked out.
+ */
+class ChildLogger
+{
+public:
+    /**
+     * @brief ChildLogger constructor, use Logger::get to create child loggers
+     *
+     * @param root Logger this child belongs to
+     * @param name Full name of the child logger
+     * @param parent Parent child logger or nullptr if the Logger is the parent
+     */
+    ChildLogger(Logger &root, std::string name, ChildLogger *parent);
+
+    /**
+     * @brief Write a log message
+     *
+     * @sa
+     * Logger::write_log(std::string, ealogger::constants::LOG_LEVEL, std::string, int, std::string)
+     */
+    void write_log(std::string msg, ealogger::constants::LOG_LEVEL lvl,
+                   std::string file, int lnumber, std::string func);
+    /**
+     * @brief Write a log message
+     *
+     * @sa
+     * Logger::write_log(std::string, ealogger::constants::LOG_LEVEL)
+     */
+    void write_log(std::string msg, ealogger::constants::LOG_LEVEL lvl);
+
+    /**
+     * @brief Write a log message from a CallSite
+     *
+     * @sa
+     * Logger::write_log_site
+     */
+    template <typename F>
+    void write_log_site(CallSite &site, F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->root.write_site_named(this->name, site, std::move(msg_fn),
+                                        func);
+    }
+
+    /**
+     * @brief Write a log message if the call site rate limiter allows it
+     *
+     * @sa
+     * Logger::write_log_limited
+     */
+    template <typename F>
+    void write_log_limited(CallSite &site, RateLimiter &limiter,
+                           RateLimiter::LIMIT_TYPE type, std::uint64_t limit,
+                           F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->root.write_limited_named(this->name, site, limiter, type,
+                                           limit, std::move(msg_fn), func);
+    }
+
+    /**
+     * @brief Write a log message if the call site sampler chooses it
+     *
+     * @sa
+     * Logger::write_log_sampled
+     */
+    template <typename F>
+    void write_log_sampled(CallSite &site, Sampler &sampler,
+                           Sampler::SAMPLE_TYPE type, std::uint64_t value,
+                           F msg_fn, const char *func)
+    {
+        if (site.is_enabled(func) && this->will_write(site.level))
+            this->root.write_sampled_named(this->name, site, sampler, type,
+                                           value, std::move(msg_fn), func);
+    }
+
+    /**
+     * @brief Get a descendant of this child logger
+     *
+     * @param name Name relative to this logger, get("client") on "net.http"
+     * returns "net.http.client"
+     *
+     * @return Reference to the ChildLogger
+     */
+    ChildLogger &get(const std::string &name);
+
+    /**
+     * @brief Set the log level of this logger
+     *
+     * @param lvl
+     *
+     * @sa
+     * Logger::set_level(const std::string &, ealogger::constants::LOG_LEVEL)
+     */
+    void set_level(ealogger::constants::LOG_LEVEL lvl);
+    /**
+     * @brief Inherit the log level from the parent again
+     */
+    void reset_level();
+    /**
+     * @brief Get the effective log level of this logger
+     *
+     * @return Log level
+     */
+    ealogger::constants::LOG_LEVEL get_level();
+    /**
+     * @brief Get the full name of this logger
+     *
+     * @return Name
+     */
+    const std::string &get_name() const { return this->name; }
+
+    /**
+     * @brief Check whether messages with severity \p lvl pass the log level
+     *
+     * @param lvl
+     *
+     * @return True if a message would be created
+     */
+    bool is_enabled(ealogger::constants::LOG_LEVEL lvl)
+    {
+        return static_cast<int>(lvl) >=
+               this->effective_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check whether a message with severity \p lvl would be written
+     *
+     * @sa
+     * Logger::will_write
+     */
+    bool will_write(ealogger::constants::LOG_LEVEL lvl)
+    {
+        return this->is_enabled(lvl) &&
+               static_cast<int>(lvl) >=
+                   this->root.write_level.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class Logger;
+
+    Logger &root;
+    const std::string name;
+    ChildLogger *parent;
+    /** Explicitly set level or -1 if it is inherited */
+    int explicit_level;
+    /** Cached level used by ChildLogger::is_enabled */
+    std::atomic<int> effective_level;
+};
 /** @} */
 }
 
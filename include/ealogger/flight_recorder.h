@@ -0,0 +1,166 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+/**
+ * @file flight_recorder.h
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ealogger/global.h>
+#include <ealogger/logmessage.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Fixed size circular log in a memory mapped file
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * The black box of a process. Logger::init_flight_recorder makes the Logger
+ * hand every message to the recorder, also the ones no Sink accepts. The
+ * message is encoded like a shm_ring::RECORD::MESSAGE and copied into the
+ * mapped file by the calling thread, there is no lock, system call or
+ * background thread involved. When the file is full the oldest messages are
+ * overwritten.
+ *
+ * The file starts with a header of FlightRecorder::header_size bytes. Every
+ * record starts with a prefix
+ * | uint32 size | uint32 CRC-32C | uint64 position | uint8 type |
+ * followed by the body of the message. The position is the offset of the
+ * record counted over all laps of the ring, records of older laps and torn
+ * records fail the check and are skipped when the file is read.
+ *
+ * Records are in the page cache as soon as they are copied, so they survive
+ * a crash of the process but not a crash of the machine. When the recorder
+ * opens a file that has records, the file is kept as \<file\>.prev and a new
+ * one is started, FlightRecorder::previous_crashed tells whether the last
+ * process ended without closing the recorder. FlightRecorder::recover reads
+ * both, the ealogger_recover tool renders them.
+ *
+ * Not available on Windows, the recorder is never valid there.
+ */
+class FlightRecorder
+{
+public:
+    /** Size of the header in front of the ring */
+    static const std::size_t header_size = 4096;
+    /** Suffix of the file of the previous process */
+    static const char *const previous_suffix;
+
+    /**
+     * @brief Create the recorder file
+     *
+     * @param path File of the ring
+     * @param size Size of the ring in bytes, rounded up to a power of 2 of at
+     * least 64 KiB
+     * @param min_lvl Messages with a lower severity are not recorded
+     */
+    FlightRecorder(std::string path, std::size_t size,
+                   ealogger::constants::LOG_LEVEL min_lvl);
+    /**
+     * @brief Unmap the file and mark it as closed cleanly
+     */
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+    /**
+     * @brief Check whether the file is mapped
+     */
+    bool is_valid() const;
+    /**
+     * @brief Get the lowest severity that is recorded
+     */
+    ealogger::constants::LOG_LEVEL get_min_lvl() const;
+    /**
+     * @brief Check whether the file of the previous process was not closed
+     * cleanly
+     */
+    bool previous_crashed() const;
+    /**
+     * @brief Copy a message into the ring
+     *
+     * @param m
+     *
+     * @details
+     * Safe to call from any number of threads at the same time. Messages
+     * larger than half of the ring are not recorded. A thread that is
+     * suspended while other threads write a whole lap may finish its copy
+     * over a newer record, which is then skipped as torn.
+     */
+    void record(LogMessage &m);
+
+    /**
+     * @brief Read the messages of a recorder file
+     *
+     * @param path File of a FlightRecorder, also \<file\>.prev
+     * @param messages The messages are appended in the order they were
+     * recorded
+     * @param skipped Set to the number of bytes of torn records
+     * @param max_bytes Only read the last \p max_bytes of the ring, 0 reads
+     * everything
+     *
+     * @return False if the file could not be read or is no recorder file
+     *
+     * @details
+     * The file may still be written while it is read, messages that are
+     * overwritten in the meantime are skipped.
+     */
+    static bool recover(const std::string &path,
+                        std::vector<std::shared_ptr<LogMessage>> &messages,
+                        std::uint64_t &skipped, std::uint64_t max_bytes = 0);
+
+private:
+    struct Header;
+
+    std::string path;
+    ealogger::constants::LOG_LEVEL min_lvl;
+    bool crashed; /**< The previous file was not closed cleanly */
+    int fd;
+    Header *header;
+    char *data;             /**< Start of the ring */
+    std::uint64_t capacity; /**< Size of the ring */
+
+    /**
+     * @brief Keep the file of the previous process if it has records
+     */
+    void keep_previous();
+    /**
+     * @brief Create, preallocate and map the file for a ring of \p size bytes
+     *
+     * @return False if the file can not be created or its blocks can not be
+     * allocated, the recorder is disabled then
+     */
+    bool create(std::uint64_t size);
+};
+
+/** @} */
+}
+
+#endif /* FLIGHT_RECORDER_H */
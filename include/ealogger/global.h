@@ -29,6 +29,15 @@
 #define ATTR_UNUSED
 #endif
 
+// macro to keep the compiler from analysing all uses of a static variable.
+// GCC may lose track of the address of a function local static when it clones
+// the function and then places the variable in read only memory.
+#ifdef __GNUC__
+#define ATTR_USED __attribute__((used))
+#else
+#define ATTR_USED
+#endif
+
 namespace ealogger
 {
 /**
@@ -42,9 +51,15 @@ namespace constants
  * @brief Supported logger Sinks
  */
 enum class LOGGER_SINK {
-    EAL_CONSOLE = 0, /**< Sink writing to a console SinkConsole */
-    EAL_SYSLOG,      /**< Sink writing to linux syslog SinkSyslog */
-    EAL_FILE_SIMPLE  /**< Sink writing to a file SinkFile */
+    EAL_CONSOLE = 0,   /**< Sink writing to a console SinkConsole */
+    EAL_SYSLOG,        /**< Sink writing to linux syslog SinkSyslog */
+    EAL_FILE_SIMPLE,   /**< Sink writing to a file SinkFile */
+    EAL_FILE_MMAP,     /**< Sink writing to mapped segment files SinkFileMmap */
+    EAL_FILE_ROTATING, /**< Sink writing to rotating files SinkFileRotating */
+    EAL_FILE_GZIP,     /**< Sink writing compressed files SinkFileGzip */
+    EAL_FILE_DIRECT,   /**< Sink bypassing the page cache SinkFileDirect */
+    EAL_FILE_BINARY,   /**< Sink writing binary records SinkFileBinary */
+    EAL_SHM            /**< Sink writing to shared memory SinkShm */
 };
 // enum CONVERSION_PATTERN {};
 
@@ -64,6 +79,11 @@ enum class LOG_LEVEL {
     EAL_STACK,     /**< Stack log message */
     EAL_INTERNAL   /**< Internal Message, do not use this loglevel yourself */
 };
+
+/**
+ * @brief Number of members in LOG_LEVEL, used for lookup tables
+ */
+const int LOG_LEVEL_COUNT = 7;
 }
 }
 
@@ -0,0 +1,172 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+/**
+ * @file log_index.h
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ealogger/binlog.h>
+#include <ealogger/global.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Sparse time and severity index of a log file
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * SinkFile and SinkFileBinary can write an index next to the log file, the
+ * name of the log file with LogIndex::suffix appended. The log file is split
+ * into blocks of roughly the configured size, every block starts at the
+ * beginning of a message. For every finished block one LogIndex::Entry of
+ * LogIndex::entry_size bytes is appended to the index. The index starts with
+ * a header of LogIndex::header_size bytes, LogIndex::magic, the format
+ * version and the block size as uint32. An entry is
+ *
+ * | uint64 offset | int64 first ns | int64 last ns | uint32 bytes |
+ * | uint32 messages | uint32 severities | uint32 reserved |
+ *
+ * in little endian byte order. The severities are a bitmap with bit n set
+ * if a message with LOG_LEVEL n is in the block. The last timestamp is the
+ * maximum over this and all previous blocks, so it never decreases and the
+ * index can be searched by time even if messages of different threads are
+ * slightly out of order.
+ *
+ * Binary log files start their dictionary again with every block, a block
+ * can be decoded without reading anything in front of it, see
+ * BinlogReader::seek. Text files store the time the line was handed to the
+ * sink, messages are stamped when they are created, so a line may be up to
+ * the queue latency of an asynchronous Logger older than its block says.
+ *
+ * LogIndex maps the index file, a query only touches the pages of the
+ * entries it looks at. The data at the end of the log file that belongs to
+ * the current block is not indexed yet and always part of the result.
+ */
+class LogIndex
+{
+public:
+    /** First bytes of every index file */
+    static const char magic[8];
+    /** Appended to the name of the log file */
+    static const char *const suffix;
+    /** Version of the format described here */
+    static const std::uint32_t version = 1;
+    /** Size of the index file header */
+    static const std::size_t header_size = 16;
+    /** Size of one LogIndex::Entry in the file */
+    static const std::size_t entry_size = 40;
+
+    /**
+     * @brief A block of the log file
+     */
+    struct Entry {
+        std::uint64_t offset; /**< Offset of the first byte of the block */
+        std::int64_t first_ns; /**< Earliest timestamp in the block */
+        /** Latest timestamp in this or any previous block */
+        std::int64_t last_ns;
+        std::uint32_t bytes;    /**< Length of the block */
+        std::uint32_t messages; /**< Number of messages in the block */
+        std::uint32_t levels;   /**< Bitmap of the severities */
+    };
+
+    /**
+     * @brief A byte range of the log file, \p end is exclusive
+     */
+    struct Range {
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    /**
+     * @brief Append the header of an index file to \p out
+     */
+    static void put_header(std::string &out, std::uint32_t block_size);
+    /**
+     * @brief Append the encoded \p entry to \p out
+     */
+    static void put_entry(std::string &out, const Entry &entry);
+
+    /**
+     * @brief Open and map the index of \p log_file
+     *
+     * @param log_file Name of the log file, not of the index
+     */
+    explicit LogIndex(const std::string &log_file);
+    ~LogIndex();
+
+    LogIndex(const LogIndex &) = delete;
+    LogIndex &operator=(const LogIndex &) = delete;
+
+    /**
+     * @brief Check whether the index exists and has a valid header
+     */
+    bool is_valid() const;
+    /**
+     * @brief Number of entries in the index
+     */
+    std::size_t size() const;
+    /**
+     * @brief Decode entry \p i
+     */
+    Entry get(std::size_t i) const;
+    /**
+     * @brief Find the parts of the log file that may hold matching messages
+     *
+     * @param from Earliest time of interest
+     * @param to Messages at or after this time are not of interest
+     * @param min_lvl Minimum severity
+     *
+     * @return Ordered byte ranges of the log file, adjacent blocks are merged.
+     * The end of the last range is UINT64_MAX if it includes the unindexed
+     * end of the log file.
+     *
+     * @details
+     * The first block is found with a binary search, the result covers whole
+     * blocks, so the caller still has to check every message.
+     */
+    std::vector<Range> query(std::chrono::system_clock::time_point from,
+                             std::chrono::system_clock::time_point to,
+                             ealogger::constants::LOG_LEVEL min_lvl) const;
+
+private:
+    int fd;
+    const char *data; /**< Mapped index file */
+    std::size_t len;  /**< Mapped bytes */
+#ifdef _WIN32
+    std::string contents; /**< Index file content, there is no mmap */
+#endif
+    std::size_t entries;
+    bool valid;
+};
+
+/** @} */
+}
+
+#endif /* LOG_INDEX_H */
@@ -17,11 +17,13 @@
 #define LOGMESSAGE_H
 
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <string>
 #include <vector>
 
 #include <ealogger/global.h>
+#include <ealogger/utility.h>
 
 namespace ealogger
 {
@@ -37,7 +39,8 @@ namespace ealogger
  *
  * Additionally a LogMessage stores the message severity, the file from where the
  * message was issued as well as the line number and the function name. All these
- * properties are exposed with appropriate getter functions.
+ * properties are exposed with appropriate getter functions. The time and the
+ * id of the calling thread are taken when the message is created.
  */
 struct LogMessage {
 public:
@@ -72,7 +75,9 @@ public:
           log_type(log_type),
           call_file(std::move(file)),
           call_file_line_num(lnumber),
-          call_func(std::move(func))
+          call_func(std::move(func)),
+          sample_weight(1),
+          thread_id(ealogger::utility::get_thread_id())
     {
         this->t = std::chrono::system_clock::now();
     }
@@ -94,7 +99,9 @@ public:
           log_type(log_type),
           call_file(std::move(file)),
           call_file_line_num(lnumber),
-          call_func(std::move(func))
+          call_func(std::move(func)),
+          sample_weight(1),
+          thread_id(ealogger::utility::get_thread_id())
     {
         this->t = std::chrono::system_clock::now();
         this->message = "";
@@ -108,6 +115,28 @@ public:
     {
         return std::chrono::system_clock::to_time_t(this->t);
     }
+    /**
+     * @brief Return the time_point when this message was created
+     * @return std::chrono::system_clock::time_point with full resolution
+     */
+    std::chrono::system_clock::time_point get_time() { return this->t; }
+    /**
+     * @brief Set the time_point of this message
+     * @param t
+     * @details
+     * Used for messages that are read back from a binary log file
+     */
+    void set_time(std::chrono::system_clock::time_point t) { this->t = t; }
+    /**
+     * @brief Return the id of the thread that created this message
+     * @return Thread id, see ealogger::utility::get_thread_id
+     */
+    std::uint64_t get_thread_id() { return this->thread_id; }
+    /**
+     * @brief Set the id of the thread that created this message
+     * @param id
+     */
+    void set_thread_id(std::uint64_t id) { this->thread_id = id; }
     /**
      * @brief Returns the severity of the message
      * @return Return severity
@@ -117,7 +146,7 @@ public:
      * @brief Get the log message
      * @return Log message as std::string
      */
-    std::string get_message() { return this->message; }
+    const std::string &get_message() { return this->message; }
     /**
      * @brief Get the log message type
      * @return LogMessage#LOGTYPE
@@ -137,7 +166,7 @@ public:
      * @brief Return file from where this log message was issued
      * @return
      */
-    std::string get_call_file() { return this->call_file; }
+    const std::string &get_call_file() { return this->call_file; }
     /**
      * @brief Return line number in file from where this log message was issued
      * @return
@@ -147,7 +176,28 @@ public:
      * @brief Return function name from where this log message was issued
      * @return
      */
-    std::string get_call_func() { return this->call_func; }
+    const std::string &get_call_func() { return this->call_func; }
+    /**
+     * @brief Return the sampling weight of this message
+     * @return Number of messages this message stands for, 1 if the message
+     * was not sampled
+     */
+    std::uint32_t get_sample_weight() { return this->sample_weight; }
+    /**
+     * @brief Set the sampling weight of this message
+     * @param weight
+     */
+    void set_sample_weight(std::uint32_t weight) { this->sample_weight = weight; }
+    /**
+     * @brief Return the name of the ChildLogger that issued this message
+     * @return Logger name, empty for the Logger itself
+     */
+    const std::string &get_logger_name() { return this->logger_name; }
+    /**
+     * @brief Set the name of the logger that issued this message
+     * @param name
+     */
+    void set_logger_name(std::string name) { this->logger_name = std::move(name); }
 private:
     /** Time Point when this log message was created*/
     std::chrono::system_clock::time_point t;
@@ -163,6 +213,9 @@ private:
         call_file; /**< The source file from which the logger was called */
     int call_file_line_num; /**< Line number in the source file */
     std::string call_func;  /**< function from which the logger was called */
+    std::uint32_t sample_weight; /**< Sampling weight, see Sampler */
+    std::string logger_name;     /**< Name of the issuing ChildLogger */
+    std::uint64_t thread_id;     /**< Id of the thread that logged this */
 };
 }
 
@@ -16,8 +16,11 @@
 #ifndef LOGQUEUE_H
 #define LOGQUEUE_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 /*
  * We use a std::queue as basis for this threadsafe queue
  */
@@ -57,13 +60,32 @@ public:
     /**
      * @brief Push LogMessage in the Queue.
      * @param m LogMessage object as shared pointer
+     * @return Number of messages pushed so far including \p m
      */
-    void push(std::shared_ptr<LogMessage> m);
+    std::uint64_t push(std::shared_ptr<LogMessage> m);
     /**
      * @brief Get the next LogMessage object in the Queue and remove it
      * @return Shared pointer LogMessage object
      */
     std::shared_ptr<LogMessage> pop();
+    /**
+     * @brief Remove up to \p max LogMessage objects from the Queue at once
+     * @param batch Vector the messages are appended to
+     * @param max Maximum number of messages to remove
+     * @param timeout Maximum time to wait for the first message
+     * @return Number of messages that were appended to \p batch
+     *
+     * @details
+     * Takes the lock only once for all messages that are ready, so the
+     * background thread can hand them over to the sinks as one batch.
+     */
+    std::size_t pop_batch(std::vector<std::shared_ptr<LogMessage>> &batch,
+                          std::size_t max, std::chrono::milliseconds timeout);
+    /**
+     * @brief Wake up a thread waiting in LogQueue::pop_batch even if there
+     * are no messages
+     */
+    void wake();
     /**
      * @brief Check if the Queue is empty
      * @return True if it is empty, otherwise false
@@ -74,6 +96,10 @@ private:
     /** The Mutex that makes the Queue threadsafe */
     std::mutex mtx;
     std::queue<std::shared_ptr<LogMessage>> msg_queue;
+    /** Set by LogQueue::wake, reset by LogQueue::pop_batch */
+    bool woken;
+    /** Number of messages ever pushed */
+    std::uint64_t pushed;
     /**
      * conditional variable we use to signal the background thread to wake up and
      * pop a new LogMessage object and route it to the internal message method
@@ -0,0 +1,207 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+/**
+ * @file ratelimit.h
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Per call site state for the rate limiting macros
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * Every rate limited macro like #eal_warn_every_n(n, msg) creates exactly one
+ * RateLimiter object with static storage duration for its call site. The
+ * decision whether a message passes is made before the message text is
+ * evaluated and before a LogMessage is created. On the suppressed path
+ * EVERY_N and FIRST_N cost one relaxed atomic increment and one relaxed load.
+ * PER_SECOND additionally reads std::chrono::steady_clock and the current
+ * window, the window is swapped with a compare and exchange once per second.
+ *
+ * Suppressed messages are not forgotten. At most once per
+ * RateLimiter#report_interval_ms the call site reports how many messages it
+ * has suppressed since the last report. The report is piggybacked on a message
+ * that passes the limiter. The first suppressed message registers the call
+ * site with every Logger (or ChildLogger of it) that suppresses it. Call
+ * sites that do not pass again (FIRST_N) are reported by the background
+ * thread on its next tick, a synchronous Logger checks for due reports when
+ * it writes a message. Pending reports are written when the Logger is
+ * destroyed. The number of suppressed messages belongs to the call site, the
+ * Logger that reports first gets all of them.
+ *
+ * The constructor is constexpr so the static objects are constant initialized
+ * and do not need a thread safe initialization guard.
+ */
+class RateLimiter
+{
+public:
+    /**
+     * @brief Supported rate limiting strategies
+     */
+    enum class LIMIT_TYPE {
+        EVERY_N = 0, /**< Let every n-th message pass */
+        FIRST_N,     /**< Let only the first n messages pass */
+        PER_SECOND   /**< Let at most n messages per second pass */
+    };
+
+    /** Minimum time between two suppression reports of a call site */
+    static const std::int64_t report_interval_ms = 1000;
+
+    constexpr RateLimiter()
+        : hits(0),
+          window(0),
+          window_hits(0),
+          window_suppressed(0),
+          reported(0),
+          last_report(0),
+          reporter(nullptr)
+    {
+    }
+
+    /**
+     * @brief Decide whether a message from this call site may pass
+     *
+     * @param type Rate limiting strategy
+     * @param limit Parameter for the strategy (n)
+     * @param suppressed Will be set to the number of suppressed messages that
+     * have to be reported now, 0 if there is nothing to report
+     *
+     * @return True if the message should be written
+     */
+    bool allow(LIMIT_TYPE type, std::uint64_t limit, std::uint64_t &suppressed)
+    {
+        suppressed = 0;
+        std::uint64_t h = 0;
+        bool pass = false;
+        switch (type) {
+        case LIMIT_TYPE::EVERY_N:
+            h = this->hits.fetch_add(1, std::memory_order_relaxed);
+            pass = limit <= 1 || h % limit == 0;
+            break;
+        case LIMIT_TYPE::FIRST_N:
+            h = this->hits.fetch_add(1, std::memory_order_relaxed);
+            pass = h < limit;
+            break;
+        case LIMIT_TYPE::PER_SECOND:
+            pass = this->allow_per_second(limit, h);
+            break;
+        }
+        if (pass)
+            suppressed = this->take_report(type, limit);
+        return pass;
+    }
+
+    /**
+     * @brief Check whether \p logger registered the call site last
+     * @details
+     * Only a hint, every Logger keeps its own list of registered call sites.
+     * It saves the lookup in this list while the same Logger suppresses
+     * messages of the call site.
+     */
+    bool is_reported_by(const void *logger) const
+    {
+        return this->reporter.load(std::memory_order_relaxed) == logger;
+    }
+    /**
+     * @brief Remember the Logger that registered the call site last
+     */
+    void set_reporter(const void *logger)
+    {
+        this->reporter.store(logger, std::memory_order_relaxed);
+    }
+    /**
+     * @brief Forget \p logger if it registered the call site last
+     */
+    void clear_reporter(const void *logger)
+    {
+        const void *expected = logger;
+        this->reporter.compare_exchange_strong(expected, nullptr,
+                                               std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check if a suppression report is due and mark it as reported
+     *
+     * @param type Rate limiting strategy the call site uses
+     * @param limit Parameter for the strategy
+     * @param force Ignore RateLimiter#report_interval_ms
+     *
+     * @return Number of messages suppressed since the last report or 0
+     */
+    std::uint64_t take_report(LIMIT_TYPE type, std::uint64_t limit,
+                              bool force = false);
+
+    /**
+     * @brief Get the total number of messages this call site has suppressed
+     *
+     * @param type Rate limiting strategy the call site uses
+     * @param limit Parameter for the strategy
+     *
+     * @return Number of suppressed messages
+     */
+    std::uint64_t get_suppressed(LIMIT_TYPE type, std::uint64_t limit) const;
+
+private:
+    std::atomic<std::uint64_t> hits; /**< Calls for EVERY_N and FIRST_N */
+    std::atomic<std::int64_t> window; /**< Current second for PER_SECOND */
+    std::atomic<std::uint64_t> window_hits; /**< Calls in the current second */
+    /** Suppressed messages of all previous seconds */
+    std::atomic<std::uint64_t> window_suppressed;
+    std::atomic<std::uint64_t> reported; /**< Suppressed messages reported */
+    std::atomic<std::int64_t> last_report; /**< Last report in ms */
+    /** Logger that registered the call site last, nullptr if none */
+    std::atomic<const void *> reporter;
+
+    bool allow_per_second(std::uint64_t limit, std::uint64_t &h)
+    {
+        std::int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        std::int64_t w = this->window.load(std::memory_order_relaxed);
+        // only the first call of a new second swaps the window
+        if (now != w &&
+            this->window.compare_exchange_strong(w, now,
+                                                 std::memory_order_relaxed)) {
+            std::uint64_t old_hits =
+                this->window_hits.exchange(0, std::memory_order_relaxed);
+            if (old_hits > limit) {
+                this->window_suppressed.fetch_add(old_hits - limit,
+                                                  std::memory_order_relaxed);
+            }
+        }
+        h = this->window_hits.fetch_add(1, std::memory_order_relaxed);
+        return h < limit;
+    }
+};
+
+/** @} */
+}
+
+#endif /* RATELIMIT_H */
@@ -0,0 +1,191 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+/**
+ * @file sampler.h
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Number of messages a Sampler has seen and let pass
+ */
+struct SampleStats {
+    std::uint64_t seen;    /**< Messages that reached the sampler */
+    std::uint64_t emitted; /**< Messages that have been written */
+};
+
+/**
+ * @brief Probabilistic sampling of log messages
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * A Sampler decides randomly whether a message will be written. It either
+ * lets pass one message in n on average or adapts its probability every second
+ * so that roughly a target number of messages per second is written.
+ *
+ * Every message that passes carries a weight, the inverse of the probability
+ * with which it was chosen. Summing up the weights of the written messages
+ * gives an estimate of the number of messages that occurred. Use the
+ * conversion pattern %w to add the weight to a message template. The exact
+ * number of seen and written messages is counted as well, but only while a
+ * sampling strategy is set. SAMPLE_TYPE::NONE lets every message pass without
+ * touching the shared counters.
+ *
+ * The Logger uses one Sampler per log level, the *_sampled macros use one per
+ * call site. Like RateLimiter the constructor is constexpr.
+ */
+class Sampler
+{
+public:
+    /**
+     * @brief Supported sampling strategies
+     */
+    enum class SAMPLE_TYPE {
+        NONE = 0, /**< Every message passes */
+        ONE_IN_N, /**< On average one message in n passes */
+        RATE      /**< On average n messages per second pass */
+    };
+
+    constexpr Sampler()
+        : seen(0),
+          emitted(0),
+          rate_threshold(threshold_all),
+          window(0),
+          window_seen(0)
+    {
+    }
+
+    /**
+     * @brief Decide whether a message should be written
+     *
+     * @param type Sampling strategy
+     * @param value Parameter for the strategy (n), ONE_IN_N uses at most
+     * 2^32
+     * @param weight Will be set to the weight of the message if it passes
+     *
+     * @return True if the message should be written
+     */
+    bool sample(SAMPLE_TYPE type, std::uint64_t value, std::uint32_t &weight)
+    {
+        if (type == SAMPLE_TYPE::NONE) {
+            weight = 1;
+            return true;
+        }
+        this->seen.fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t threshold = threshold_all;
+        switch (type) {
+        case SAMPLE_TYPE::NONE:
+            break;
+        case SAMPLE_TYPE::ONE_IN_N:
+            // larger values would round the probability down to 0
+            if (value > 1)
+                threshold = threshold_all / std::min(value, threshold_all);
+            break;
+        case SAMPLE_TYPE::RATE:
+            threshold = this->get_rate_threshold(value);
+            break;
+        }
+        if (threshold < threshold_all && Sampler::random() >= threshold)
+            return false;
+        this->emitted.fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t w = threshold == 0
+                              ? UINT32_MAX
+                              : (threshold_all + threshold / 2) / threshold;
+        weight = static_cast<std::uint32_t>(
+            std::min(w, static_cast<std::uint64_t>(UINT32_MAX)));
+        return true;
+    }
+
+    /**
+     * @brief Count a message that was decided on somewhere else
+     *
+     * @param emitted Whether the message is going to be written
+     */
+    void record(bool emitted)
+    {
+        this->seen.fetch_add(1, std::memory_order_relaxed);
+        if (emitted)
+            this->emitted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the exact number of seen and written messages
+     * @return SampleStats
+     */
+    SampleStats get_stats() const
+    {
+        SampleStats stats;
+        stats.seen = this->seen.load(std::memory_order_relaxed);
+        stats.emitted = this->emitted.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    /** Probabilities are expressed as fraction of 2^32 */
+    static const std::uint64_t threshold_all = std::uint64_t(1) << 32;
+
+    std::atomic<std::uint64_t> seen;
+    std::atomic<std::uint64_t> emitted;
+    /** Probability the RATE strategy has calculated for the current second */
+    std::atomic<std::uint64_t> rate_threshold;
+    std::atomic<std::int64_t> window;        /**< Current second */
+    std::atomic<std::uint64_t> window_seen;  /**< Messages in this second */
+
+    /**
+     * @brief Get a random number in [0, 2^32) from a thread local generator
+     */
+    static std::uint64_t random();
+
+    std::uint64_t get_rate_threshold(std::uint64_t rate)
+    {
+        std::int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        std::int64_t w = this->window.load(std::memory_order_relaxed);
+        if (now != w &&
+            this->window.compare_exchange_strong(w, now,
+                                                 std::memory_order_relaxed)) {
+            // adapt the probability to the number of messages of the last second
+            std::uint64_t last_seen =
+                this->window_seen.exchange(0, std::memory_order_relaxed);
+            std::uint64_t t = threshold_all;
+            if (now == w + 1 && last_seen > rate)
+                t = (rate * threshold_all) / last_seen;
+            this->rate_threshold.store(t, std::memory_order_relaxed);
+        }
+        this->window_seen.fetch_add(1, std::memory_order_relaxed);
+        return this->rate_threshold.load(std::memory_order_relaxed);
+    }
+};
+
+/** @} */
+}
+
+#endif /* SAMPLER_H */
@@ -0,0 +1,110 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SHM_READER_H
+#define SHM_READER_H
+
+/**
+ * @file shm_reader.h
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <ealogger/logmessage.h>
+#include <ealogger/shm_ring.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief Reads the messages a SinkShm writes to shared memory
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * This is the library interface for a collector process. Records are taken
+ * out of the ShmRing and decoded into LogMessage objects, so they can be
+ * rendered by any Sink. For a ring with rendered lines the text of the
+ * message is the line, render it with the message template "%m".
+ *
+ * The reader is the only consumer of the ring. A message that was read is
+ * gone for every other reader.
+ *
+ * The application may start after the collector or replace the ring when it
+ * is started with other settings. ShmReader::refresh attaches to the new
+ * ring once the old one is read completely.
+ */
+class ShmReader
+{
+public:
+    /**
+     * @brief Attach to the ring \p name
+     *
+     * @param name Name of the shared memory object
+     */
+    explicit ShmReader(std::string name);
+
+    /**
+     * @brief Check whether a ring is attached
+     */
+    bool is_valid() const;
+    /**
+     * @brief Attach to the ring again if there was none or it was replaced
+     *
+     * @return True if a new ring was attached
+     *
+     * @details
+     * Does nothing while there are unread records.
+     */
+    bool refresh();
+    /**
+     * @brief Read the next message
+     *
+     * @param m Set to a new LogMessage
+     *
+     * @return False if there is no message right now
+     */
+    bool next(std::shared_ptr<LogMessage> &m);
+    /**
+     * @brief Get the kind of records in the ring
+     */
+    ShmRing::FORMAT get_format() const;
+    /**
+     * @brief Get the number of records the application dropped because the
+     * ring was full
+     */
+    std::uint64_t get_dropped() const;
+    /**
+     * @brief Get the number of records that could not be decoded
+     */
+    std::uint64_t get_skipped() const;
+
+private:
+    std::string name;
+    std::unique_ptr<ShmRing> ring;
+    std::string record; /**< Copy of the current record */
+    std::uint64_t skipped;
+};
+
+/** @} */
+}
+
+#endif /* SHM_READER_H */
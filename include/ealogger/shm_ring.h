@@ -0,0 +1,249 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+/**
+ * @file shm_ring.h
+ * @brief Ring buffer in shared memory used by SinkShm and ShmReader
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <ealogger/logmessage.h>
+
+namespace ealogger
+{
+/**
+ * @namespace shm_ring
+ * @brief Layout of the shared memory ring and its records
+ *
+ * @details
+ * The shared memory object starts with a header of shm_ring::header_size
+ * bytes, shm_ring::magic, the version, the ShmRing::FORMAT and the capacity
+ * of the data area. The write position, the read position and the number of
+ * records dropped because the ring was full are atomic counters on cache
+ * lines of their own. Positions only grow, the offset in the data area is
+ * the position modulo the capacity. Both processes run on the same machine,
+ * so the header uses the native byte order.
+ *
+ * A record in the data area starts with its size as uint32, not counting
+ * the size field, followed by one byte shm_ring::RECORD and the body. Records
+ * are padded to 8 bytes and never wrap around the end of the data area, a
+ * size of shm_ring::wrap_marker means the next record is at offset 0.
+ *
+ * Unlike in the binary log format there is no dictionary, a collector may
+ * attach late or miss records that were dropped. Every record is complete
+ * on its own:
+ *
+ * RECORD::LINE
+ * | uint8 level | rendered line |
+ *
+ * RECORD::MESSAGE starts with a header of shm_ring::message_header_size
+ * bytes
+ * | int64 timestamp ns | uint64 sequence | uint64 thread id | int32 line |
+ * | uint32 sampling weight | uint8 level | uint8 LogMessage::LOGTYPE |
+ * | uint32 file length | uint32 function length | uint32 logger length |
+ * followed by file, function, logger name and the message text. The elements
+ * of a stacktrace are written as uint32 length and text each. The integers of
+ * the records are little endian like in ealogger::binlog.
+ */
+namespace shm_ring
+{
+/** First bytes of every ring */
+const char magic[8] = {'E', 'A', 'L', 'S', 'H', 'M', '\r', '\n'};
+/** Version of the layout described here */
+const std::uint32_t version = 1;
+/** Size of the header in front of the data area, one page */
+const std::size_t header_size = 4096;
+/** Size field of a record that marks the end of the used data area */
+const std::uint32_t wrap_marker = 0xFFFFFFFF;
+/** Size of the fixed part of a RECORD::MESSAGE body */
+const std::size_t message_header_size = 46;
+
+/**
+ * @brief Types of records in the ring
+ */
+enum class RECORD : std::uint8_t {
+    LINE = 1, /**< A rendered line */
+    MESSAGE   /**< A log message that is rendered by the collector */
+};
+
+/**
+ * @brief Append a RECORD::MESSAGE record body for \p m to \p out
+ *
+ * @param out
+ * @param m
+ * @param sequence Sequence number of the message
+ */
+void put_message(std::string &out, LogMessage &m, std::uint64_t sequence);
+/**
+ * @brief Decode a RECORD::MESSAGE or RECORD::LINE record
+ *
+ * @param rec Type and body of the record
+ * @param len Size of the record without the size field
+ * @param m Set to a new LogMessage, the line of a RECORD::LINE is its text
+ *
+ * @return False for unknown or corrupt records
+ */
+bool get_message(const char *rec, std::size_t len,
+                 std::shared_ptr<LogMessage> &m);
+}
+
+/**
+ * @addtogroup EALOGGER_GROUP
+ *
+ * @{
+ */
+
+/**
+ * @brief A single producer, single consumer ring buffer in shared memory
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * The ring is a POSIX shared memory object, see shm_open(3), that lives
+ * until it is removed with ShmRing::remove or the machine reboots. Records
+ * that were written survive a crash of the producer, a record is published
+ * by advancing the write position after it was copied completely.
+ *
+ * The producer never waits for the consumer. A record that does not fit
+ * into the free space is dropped and counted in the header. The consumer
+ * copies a record out of the ring before it releases the space.
+ *
+ * A producer attaches to an existing ring with the same capacity and
+ * format, records a collector has not read yet are kept. Other objects of
+ * the name are replaced by a new ring. Only one producer and one consumer
+ * may use a ring at a time.
+ *
+ * On platforms without shm_open every ring is invalid.
+ */
+class ShmRing
+{
+public:
+    /**
+     * @brief Kind of records a ring holds
+     */
+    enum class FORMAT : std::uint32_t {
+        LINES = 1, /**< Rendered lines, shm_ring::RECORD::LINE */
+        MESSAGES   /**< Log messages, shm_ring::RECORD::MESSAGE */
+    };
+
+    /**
+     * @brief Create a ring or attach to it as producer
+     *
+     * @param name Name of the shared memory object like "/myapp.log"
+     * @param capacity Size of the data area in bytes, rounded up to a power
+     * of 2 of at least 4096
+     * @param format Kind of records
+     */
+    ShmRing(std::string name, std::size_t capacity, FORMAT format);
+    /**
+     * @brief Attach to an existing ring as consumer
+     *
+     * @param name Name of the shared memory object
+     */
+    explicit ShmRing(std::string name);
+    ~ShmRing();
+
+    ShmRing(const ShmRing &) = delete;
+    ShmRing &operator=(const ShmRing &) = delete;
+
+    /**
+     * @brief Check whether the ring is mapped and has a valid header
+     */
+    bool is_valid() const;
+    /**
+     * @brief Check whether the name refers to another object than the mapped
+     * one now
+     *
+     * @details
+     * A producer that was started with other settings replaces the ring.
+     */
+    bool is_replaced() const;
+    /**
+     * @brief Get the kind of records in the ring
+     */
+    FORMAT get_format() const;
+    /**
+     * @brief Get the size of the data area in bytes
+     */
+    std::uint64_t get_capacity() const;
+    /**
+     * @brief Get the number of records dropped because the ring was full
+     */
+    std::uint64_t get_dropped() const;
+    /**
+     * @brief Get the number of bytes the consumer has not read yet
+     */
+    std::uint64_t get_pending() const;
+    /**
+     * @brief Write one record
+     *
+     * @param type Type of the record
+     * @param body Body of the record
+     * @param len Length of \p body
+     *
+     * @return False if the record was dropped
+     */
+    bool write(shm_ring::RECORD type, const char *body, std::size_t len);
+    /**
+     * @brief Read the next record
+     *
+     * @param rec Set to the type and body of the record
+     *
+     * @return False if there is no record
+     *
+     * @details
+     * A record with an invalid size means the ring was damaged, the consumer
+     * skips everything that was written so far.
+     */
+    bool read(std::string &rec);
+    /**
+     * @brief Remove the shared memory object \p name
+     *
+     * @details
+     * Producers and consumers that have mapped it keep using it.
+     */
+    static bool remove(const std::string &name);
+
+private:
+    struct Header;
+
+    std::string name;
+    int fd;
+    std::uint64_t dev; /**< Device of the mapped object */
+    std::uint64_t ino; /**< Inode of the mapped object */
+    Header *header;
+    char *data;             /**< Start of the data area */
+    std::uint64_t capacity; /**< Size of the data area */
+
+    /**
+     * @brief Map the open object and check its header
+     */
+    bool map();
+    /**
+     * @brief Create a new object and initialize the header
+     */
+    bool create(std::uint64_t size, FORMAT format);
+    void unmap();
+};
+
+/** @} */
+}
+
+#endif /* SHM_RING_H */
@@ -21,6 +21,9 @@
  */
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -41,17 +44,88 @@ namespace ealogger
  * @{
  */
 
+/**
+ * @brief Statistics of a Sink
+ */
+struct SinkStats {
+    SinkStats()
+        : io_uring(false),
+          writes_submitted(0),
+          writes_completed(0),
+          in_flight(0),
+          max_in_flight(0),
+          latency_avg_us(0),
+          latency_max_us(0),
+          degraded(false),
+          write_errors(0),
+          messages_dropped(0),
+          last_error(0)
+    {
+    }
+
+    bool io_uring; /**< Writes are submitted to an io_uring */
+    std::uint64_t writes_submitted; /**< Asynchronous writes submitted */
+    std::uint64_t writes_completed; /**< Asynchronous writes completed */
+    std::uint64_t in_flight;        /**< Writes currently in flight */
+    std::uint64_t max_in_flight;    /**< Highest number of writes in flight */
+    std::uint64_t latency_avg_us;   /**< Average completion latency */
+    std::uint64_t latency_max_us;   /**< Highest completion latency */
+
+    bool degraded; /**< Writes fail, messages are dropped until a retry works */
+    std::uint64_t write_errors;     /**< Failed writes, opens and syncs */
+    std::uint64_t messages_dropped; /**< Messages lost because of errors */
+    int last_error;                 /**< errno of the last error */
+};
+
 /**
  * @brief A sink is an object that writes the log message to a specific target
  * @author Christian Rapp
  * @details
  *
  * The virtual class Sink has to be implemented by each possible target. To add
- * a new Sink to ealogger you have to provide an implementation for Sink::write_message
+ * a new Sink to ealogger you have to provide an implementation for
+ * Sink::write_message and Sink::config_changed.
+ *
+ * User defined sinks are added with Logger::add_sink and get the same
+ * guarantees as the built-in ones:
+ * - All calls of the protected hooks for one sink are serialized by a mutex
+ *   the Logger holds for this sink. In asynchronous mode they come from the
+ *   background thread of the Logger only.
+ * - The Logger keeps a std::shared_ptr to the sink. After Logger::remove_sink
+ *   returns, the Logger will not call the sink again.
+ * - Sink::buffer_flush is called before the Logger is destroyed and when
+ *   the sink is removed or replaced by Logger::remove_sink or
+ *   Logger::add_sink.
+ *
+ * A sink receives rendered lines by default. Sinks that want the LogMessage
+ * objects themselves, for example to serialize them in a format of their own,
+ * return true from Sink::wants_log_messages and implement
+ * Sink::write_log_messages.
  */
 class Sink
 {
 public:
+    /**
+     * @brief A rendered message of a batch
+     */
+    struct RenderedLine {
+        RenderedLine(std::string text, ealogger::constants::LOG_LEVEL lvl,
+                     std::chrono::system_clock::time_point time)
+            : text(std::move(text)), lvl(lvl), time(time)
+        {
+        }
+
+        std::string text;                   /**< Formatted message */
+        ealogger::constants::LOG_LEVEL lvl; /**< Severity of the message */
+        /** Time the LogMessage was created */
+        std::chrono::system_clock::time_point time;
+    };
+    /**
+     * @brief Rendered messages of a batch together with their severity and
+     * timestamp
+     */
+    typedef std::vector<RenderedLine> rendered_batch;
+
     /**
      * @brief Sink constructor
      * @param msg_template Message template for this sink
@@ -69,9 +143,9 @@ public:
      * For example "%H:%M:%S" returns a 24-hour based time string like 20:12:02
      *
      * @note
-     * Sink objects are not exposed to the user directly. You have to use the
-     * Logger class to change a sinks settings. Some options for a Sink
-     * are only exposed via Logger::init_sink_* methods.
+     * The built-in Sink objects are not exposed to the user directly. You have
+     * to use the Logger class or a SinkHandle to change a sinks settings. Some
+     * options for a Sink are only exposed via Logger::init_sink_* methods.
      *
      * @sa
      * ConversionPattern
@@ -122,6 +196,23 @@ public:
      * @param min_lvl
      */
     void set_min_lvl(ealogger::constants::LOG_LEVEL min_lvl);
+    /**
+     * @brief Get the lowest severity this sink does something with
+     *
+     * @return Sink#min_level or EAL_DEBUG if the sink keeps a backtrace
+     */
+    ealogger::constants::LOG_LEVEL get_lowest_lvl();
+    /**
+     * @brief Get the lowest severity this sink commits to stable storage
+     * before logging returns
+     *
+     * @return Severity as int, ealogger::constants::LOG_LEVEL_COUNT if the
+     * sink does not commit messages
+     */
+    virtual int get_commit_lvl()
+    {
+        return ealogger::constants::LOG_LEVEL_COUNT;
+    }
 
     /**
      * @brief Prepare a log message before it is written to the targets
@@ -133,12 +224,89 @@ public:
      * corresponding information
      */
     void prepare_log_message(const std::shared_ptr<LogMessage> &log_message);
+    /**
+     * @brief Prepare several log messages and write them at once
+     *
+     * @param batch LogMessage objects in the order they were logged
+     *
+     * @details
+     * Every message is handled like in Sink::prepare_log_message but the
+     * rendered lines are collected and handed over to Sink::write_batch
+     * together.
+     */
+    void prepare_log_batch(
+        const std::vector<std::shared_ptr<LogMessage>> &batch);
+
+    /**
+     * @brief Collapse consecutive identical messages into one line
+     *
+     * @param collapse Enable or disable collapsing
+     * @param flush_timeout Maximum time a repeat count is held back
+     *
+     * @details
+     * If enabled, a message that has the same severity, call site and text as
+     * the message before is not rendered or written. Instead the sink counts
+     * the repetitions and writes a single *Last message repeated N times* line
+     * once a different message arrives, or when \p flush_timeout has passed
+     * since the first repetition.
+     */
+    void set_collapse_repeated(bool collapse,
+                               std::chrono::milliseconds flush_timeout);
+
+    /**
+     * @brief Keep messages below the minimum severity for error context
+     *
+     * @param size Number of messages to keep, 0 disables the backtrace
+     *
+     * @details
+     * Messages below Sink#min_level are normally dropped. With a backtrace
+     * the last \p size of them are kept in a ring buffer without being
+     * rendered. When a message with severity EAL_ERROR or EAL_FATAL arrives
+     * the buffered messages are written first, with their original
+     * timestamps, and the ring is cleared.
+     */
+    void set_backtrace(std::size_t size);
+
+    /**
+     * @brief Get statistics of this sink
+     *
+     * @return SinkStats object, sinks that do not collect statistics return
+     * an object with all values set to 0
+     */
+    virtual SinkStats get_stats() { return SinkStats(); }
+
+    /**
+     * @brief Give the sink a chance to handle pending timeouts
+     *
+     * @details
+     * Called periodically by the Logger background thread.
+     */
+    void tick();
+    /**
+     * @brief Write everything the sink is holding back
+     *
+     * @details
+     * Called by the Logger before it shuts down.
+     */
+    void flush();
+    /**
+     * @brief Reopen the files this sink writes to
+     *
+     * @details
+     * Called by the Logger background thread after SIGUSR1 so files that were
+     * moved away by logrotate are replaced by new ones. Sinks without files
+     * do nothing.
+     */
+    virtual void reopen() {}
 
 protected:
     // TODO: I think some of these protected members could be moved to private
     std::string
         msg_template; /**< Message template string consisting of conversion patterns */
     std::string datetime_pattern; /**< Date / time conversion pattern */
+    /** Second that Sink#datetime_cache was formatted for */
+    std::time_t datetime_cache_time;
+    std::string datetime_cache; /**< Last formatted date / time */
     bool enabled;                 /**< Is this Sink enabled  */
     ealogger::constants::LOG_LEVEL
         min_level; /**< Minimum log message severity for this sink */
@@ -149,9 +317,28 @@ protected:
     std::mutex mtx_enabled;          /**< Sink#enabled mutex */
     std::mutex mtx_min_lvl;          /**< Sink#min_levek mutex */
     std::mutex mtx_conv_pattern;     /**< Sink#vec_conv_patterns mutex */
+    std::mutex mtx_collapse;         /**< Mutex for the repeat collapsing */
+
+    bool collapse_repeated; /**< Collapse consecutive identical messages */
+    std::chrono::milliseconds
+        collapse_timeout; /**< Maximum time a repeat count is held back */
+    std::shared_ptr<LogMessage>
+        last_message; /**< Last message that was written by this sink */
+    std::size_t repeat_count; /**< Repetitions of Sink#last_message */
+    std::chrono::steady_clock::time_point
+        repeat_since; /**< Time of the first unreported repetition */
 
-    std::vector<ConversionPattern>
-        vec_conv_patterns; /**< Vector of conversion patterns a Sink uses*/
+    std::mutex mtx_backtrace; /**< Mutex for the backtrace ring */
+    std::vector<std::shared_ptr<LogMessage>>
+        backtrace_ring;        /**< Messages below Sink#min_level */
+    std::size_t backtrace_next;  /**< Next slot in Sink#backtrace_ring */
+    std::size_t backtrace_count; /**< Used slots in Sink#backtrace_ring */
+
+    bool batch_active; /**< Sink::prepare_log_batch is running */
+    rendered_batch batch_lines; /**< Lines collected during a batch */
+
+    /** Sink#msg_template split into text and conversion patterns in order */
+    std::vector<ConversionPattern> vec_conv_patterns;
 
     std::map<ealogger::constants::LOG_LEVEL, std::string>
         loglevel_lookup; /**< Lookup table for loglevel Strings */
@@ -161,6 +348,40 @@ protected:
      * Sink#msg_template
      */
     void fill_conv_patterns(bool lock);
+    /**
+     * @brief Substitute the conversion patterns in Sink#msg_template
+     *
+     * @param log_message
+     *
+     * @return The formatted message
+     */
+    std::string render_message(const std::shared_ptr<LogMessage> &log_message);
+    /**
+     * @brief Write the repeat counter of Sink#last_message if necessary
+     * @details
+     * Sink#mtx_collapse has to be locked when calling this method
+     */
+    void write_repeat_count();
+    /**
+     * @brief Render a message and write it or collect it if a batch is active
+     *
+     * @param log_message LogMessage object
+     */
+    void emit_message(const std::shared_ptr<LogMessage> &log_message);
+    /**
+     * @brief Write and clear the backtrace ring
+     *
+     * @return True if at least one message was written
+     */
+    bool write_backtrace();
+    /**
+     * @brief Check Sink#enabled and Sink#min_level for a LogMessage
+     *
+     * @param log_message
+     *
+     * @return True if the message has to be written by this sink
+     */
+    bool accept_log_message(const std::shared_ptr<LogMessage> &log_message);
     /**
      * @brief Writes a LogMessage object to the logger sink
      *
@@ -172,6 +393,101 @@ protected:
      * specified sink.
      */
     virtual void write_message(const std::string &msg) = 0;
+    /**
+     * @brief Writes a formatted message together with its severity
+     *
+     * @param msg Formatted message
+     * @param lvl Severity of the message
+     *
+     * @details
+     * Sinks that buffer messages can override this to decide when a buffer has
+     * to be written. The default implementation calls
+     * Sink::write_message(const std::string &)
+     */
+    virtual void write_message(const std::string &msg,
+                               ATTR_UNUSED ealogger::constants::LOG_LEVEL lvl)
+    {
+        this->write_message(msg);
+    }
+    /**
+     * @brief Writes a formatted message together with its severity and the
+     * time it was logged
+     *
+     * @param msg Formatted message
+     * @param lvl Severity of the message
+     * @param time Time the LogMessage was created
+     *
+     * @details
+     * Sinks that need the timestamp of a message without parsing the
+     * formatted line override this. The default implementation calls
+     * Sink::write_message(const std::string &, ealogger::constants::LOG_LEVEL)
+     */
+    virtual void
+    write_message(const std::string &msg, ealogger::constants::LOG_LEVEL lvl,
+                  ATTR_UNUSED std::chrono::system_clock::time_point time)
+    {
+        this->write_message(msg, lvl);
+    }
+    /**
+     * @brief Writes all lines of a batch
+     *
+     * @param lines Formatted messages and their severity
+     *
+     * @details
+     * Sinks that can write several lines with one operation should override
+     * this. The default implementation calls
+     * Sink::write_message(const std::string &, ealogger::constants::LOG_LEVEL,
+     * std::chrono::system_clock::time_point) for every line.
+     */
+    virtual void write_batch(const rendered_batch &lines)
+    {
+        for (const auto &line : lines)
+            this->write_message(line.text, line.lvl, line.time);
+    }
+    /**
+     * @brief Called by Sink::tick, write buffered messages that are due
+     */
+    virtual void buffer_tick() {}
+    /**
+     * @brief Called by Sink::flush, write all buffered messages
+     */
+    virtual void buffer_flush() {}
+    /**
+     * @brief Called for every message that passed the filters before it is
+     * rendered
+     *
+     * @return True if the message has to be dropped
+     *
+     * @details
+     * A sink whose target does not accept writes anymore can use this to save
+     * the work of rendering messages it would lose anyway. Also called for
+     * sinks that get LogMessage objects.
+     */
+    virtual bool drop_message() { return false; }
+    /**
+     * @brief Whether this sink gets LogMessage objects instead of lines
+     *
+     * @return True if Sink::write_log_messages should be called
+     *
+     * @details
+     * The messages are filtered by Sink#enabled and Sink#min_level as usual.
+     * The message template, repeat collapsing and the backtrace only apply to
+     * rendered lines.
+     */
+    virtual bool wants_log_messages() const { return false; }
+    /**
+     * @brief Writes LogMessage objects that passed the filters of this sink
+     *
+     * @param messages Messages in the order they were logged
+     *
+     * @details
+     * Called once per batch of the background thread and for every single
+     * message of a synchronous Logger.
+     */
+    virtual void write_log_messages(
+        ATTR_UNUSED const std::vector<std::shared_ptr<LogMessage>> &messages)
+    {
+    }
 
     /**
      * @brief This method will be called when the SinkConfig option changes
@@ -50,6 +50,10 @@ private:
     std::mutex mtx_console;
 
     void write_message(const std::string &msg);
+    /**
+     * @brief Write all lines of a batch to stdout with one writev call
+     */
+    void write_batch(const rendered_batch &lines);
     void config_changed();
 };
 /** @} */
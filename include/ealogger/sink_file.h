@@ -13,14 +13,20 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 
+
 #ifndef SINK_FILE_H
 #define SINK_FILE_H
 
 /** @file sink_file.h */
 
-#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
 
+#include <ealogger/log_index.h>
 #include <ealogger/sink.h>
+#include <ealogger/uring_writer.h>
 
 namespace ealogger
 {
@@ -33,37 +39,131 @@ namespace ealogger
  * @brief Sink to write to a log file
  * @details
  *
- * This sink allows you to write to a log file. It does not support rotating files
- * based on elapsed time or file size.
+ * This sink allows you to write to a log file. It does not rotate the file,
+ * use SinkFileRotating for that.
  * You also have to make sure the application hass appropriate write permissions
  * and the target directory exists.
+ *
+ * Rendered messages are collected in a userspace buffer and written to the file
+ * descriptor with a single write system call when
+ * - the buffer is full
+ * - the flush interval has passed since the last write
+ * - a message with at least the flush severity arrives
+ * - the sink is flushed or closed
+ *
+ * On Linux the buffer can be handed over to an io_uring instead of calling
+ * write. The logger thread then continues while up to \p io_uring_depth
+ * writes are in flight. See UringWriter.
+ *
+ * Written data reaches the disk when the kernel decides to, unless a
+ * SinkFile::DURABILITY policy is chosen. With GROUP_COMMIT every message with
+ * at least the flush severity is followed by one fdatasync that covers all
+ * messages written so far. An asynchronous Logger lets the thread that logged
+ * such a message wait until the sync has finished, threads that log errors at
+ * the same time share one sync.
+ *
+ * When the log file can not be opened or a write fails, for example because
+ * the disk is full, the sink switches to a degraded mode. Messages are then
+ * dropped before they are rendered and counted. Every
+ * SinkFile#retry_interval the sink tries to write again. The first line
+ * written after it recovered reports how many messages were lost. See
+ * SinkFile::get_stats for the counters.
+ *
+ * With \p index_block greater than 0 the sink writes a sparse time and
+ * severity index of the log file, see LogIndex. A block is closed when it has
+ * grown to \p index_block bytes, its entry is written when the next block
+ * starts or the file is closed.
  */
 class SinkFile : public Sink
 {
 public:
     /**
-     * @brief SinkFile constructor with additional parameters
+     * @brief When written messages are synced to stable storage
+     */
+    enum class DURABILITY {
+        NONE = 0,    /**< Leave it to the kernel */
+        PERIODIC,    /**< fdatasync every \p sync_interval */
+        GROUP_COMMIT /**< fdatasync after messages with the flush severity */
+    };
+
+    /**
+     * @brief Tuning options of a SinkFile
+     *
+     * @details
+     * Start from the defaults and change the members you need:
+     * @code
+     * ealogger::SinkFile::Options opts;
+     * opts.durability = ealogger::SinkFile::DURABILITY::GROUP_COMMIT;
+     * opts.index_block = 64 * 1024;
+     * @endcode
+     */
+    struct Options {
+        Options()
+            : flush_buffer(false),
+              buffer_size(65536),
+              flush_interval(std::chrono::milliseconds(1000)),
+              flush_lvl(ealogger::constants::LOG_LEVEL::EAL_ERROR),
+              io_uring_depth(0),
+              durability(DURABILITY::NONE),
+              sync_interval(std::chrono::milliseconds(1000)),
+              index_block(0)
+        {
+        }
+
+        /** Write every message to the file immediately */
+        bool flush_buffer;
+        /** Size of the userspace buffer in bytes */
+        std::size_t buffer_size;
+        /** Maximum time a message is held in the buffer */
+        std::chrono::milliseconds flush_interval;
+        /** Messages with this or a higher severity are written immediately */
+        ealogger::constants::LOG_LEVEL flush_lvl;
+        /** Number of asynchronous writes in flight, 0 uses blocking writes */
+        std::size_t io_uring_depth;
+        /** Policy for syncing the file to stable storage */
+        DURABILITY durability;
+        /** Interval for DURABILITY::PERIODIC */
+        std::chrono::milliseconds sync_interval;
+        /** Size of the blocks of the LogIndex in bytes, 0 disables the index */
+        std::size_t index_block;
+    };
+
+    /**
+     * @brief SinkFile constructor
      *
      * @param msg_template String with conversion specifiers
      * @param datetime_pattern Conversion specifiers for date time
      * @param enabled Whether or not this sink is enabled
      * @param min_lvl Minimum severity
      * @param log_file Log file
-     * @param flush_buffer Flush the ofstream buffer with every message
+     * @param flush_buffer Write every message to the file immediately
      *
      * @details
      * Make sure you have write permissions for \p log_file and the corresponding
      * directories exist.
      *
      * The parameter \p flush_buffer can be used to influence the flushing of
-     * internal buffers. Normally ealogger leaves this to the system. This means
-     * not every message might be written immediately to the file. If you want a
-     * different behaviour set flush_buffer to true at the cost of decreasing
-     * performance.
+     * internal buffers. Normally ealogger collects messages in a buffer of
+     * SinkFile::Options#buffer_size bytes. This means not every message is
+     * written immediately to the file. If you want a different behaviour set
+     * flush_buffer to true at the cost of decreasing performance.
      */
     SinkFile(std::string msg_template, std::string datetime_pattern,
              bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
              std::string log_file, bool flush_buffer);
+    /**
+     * @brief SinkFile constructor with tuning options
+     *
+     * @param msg_template String with conversion specifiers
+     * @param datetime_pattern Conversion specifiers for date time
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Log file
+     * @param options Buffering, durability and index settings
+     */
+    SinkFile(std::string msg_template, std::string datetime_pattern,
+             bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+             std::string log_file, const Options &options);
     virtual ~SinkFile();
 
     /**
@@ -78,15 +178,182 @@ public:
      */
     void set_log_file(std::string log_file);
 
+    /**
+     * @brief Get io_uring and error statistics of this sink
+     *
+     * @return SinkStats object
+     */
+    SinkStats get_stats();
+
+    /**
+     * @brief Write all buffered messages and reopen the log file
+     */
+    void reopen();
+
+    /**
+     * @brief Get the flush severity if DURABILITY::GROUP_COMMIT is used
+     */
+    int get_commit_lvl();
+
+protected:
+    std::mutex mtx_file;
+
+    int fd; /**< File descriptor of the log file, -1 if closed */
+    std::string log_file;
+    /** Bytes in the current log file including buffered messages */
+    std::uint64_t file_size;
+
+    /**
+     * @brief Called before a line of \p len bytes is appended
+     *
+     * @param len Length of the rendered message without the newline
+     * @details
+     * SinkFile#mtx_file is locked and SinkFile#fd is open when this is called.
+     * Derived sinks may switch to a different file here, the line is written
+     * to whatever file is open when this method returns.
+     */
+    virtual void prepare_append(std::size_t len);
+    /**
+     * @brief Called after the log file was opened
+     * @details
+     * SinkFile#mtx_file is locked. Data appended with SinkFile::append_record
+     * here is written to the beginning of the new file if SinkFile#file_size
+     * is 0. Not called for the file opened by the SinkFile constructor.
+     *
+     * @return False if the file must not be written, for example because it
+     * has a different format. SinkFile::reject_file is called then.
+     */
+    virtual bool file_opened() { return true; }
+    /**
+     * @brief Close a file that file_opened rejected and enter the degraded
+     * mode with EINVAL
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void reject_file();
+    /**
+     * @brief Write the line that reports lost messages after an error
+     *
+     * @param count Messages lost since the last report
+     * @param err errno of the last error
+     * @details
+     * SinkFile#mtx_file is locked when this is called
+     */
+    virtual void report_dropped(std::uint64_t count, int err);
+    /**
+     * @brief Append data that is not a rendered line to the log file
+     *
+     * @param data
+     * @param len
+     * @param lvl Severity, decides when the buffer is written like for lines
+     * @param message Whether the data is a message that is counted as dropped
+     * if it can not be written
+     * @param time Timestamp of the message for the LogIndex
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void append_record(const char *data, std::size_t len,
+                       ealogger::constants::LOG_LEVEL lvl,
+                       bool message = true,
+                       std::chrono::system_clock::time_point time =
+                           std::chrono::system_clock::time_point());
+    /**
+     * @brief Cut the log file to \p size bytes
+     *
+     * @return False if the file could not be truncated
+     *
+     * @details
+     * Used to remove a torn record at the end of a file after a crash.
+     * SinkFile#mtx_file has to be locked and SinkFile#buffer has to be empty
+     * when calling this method. Entries of the LogIndex behind the new end
+     * are removed.
+     */
+    bool truncate_file(std::uint64_t size);
+    /**
+     * @brief Check whether the data appended next should start a new block
+     * of the LogIndex
+     *
+     * @return Always false if there is no index
+     */
+    bool index_block_due() const;
+    /**
+     * @brief Write the entry of the current block and start a new one at the
+     * end of the file
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method. Does
+     * nothing if there is no index.
+     */
+    void start_index_block();
+
+    /**
+     * @brief Open logfile
+     *
+     * @param lock Whether SinkFile#mtx_file has to be locked
+     */
+    void open_file(bool lock = true);
+    /**
+     * @brief Write all buffered messages and close logfile
+     *
+     * @param lock Whether SinkFile#mtx_file has to be locked
+     */
+    void close_file(bool lock = true);
+
 private:
-    std::mutex mtx_file_stream;
     std::mutex mtx_log_file;
 
-    std::ofstream file_stream;
-    std::string log_file;
     bool flush_buffer;
 
+    std::string buffer;      /**< Rendered messages not yet written */
+    std::size_t buffer_size; /**< Capacity of SinkFile#buffer */
+    std::chrono::milliseconds flush_interval;
+    ealogger::constants::LOG_LEVEL flush_level;
+    std::chrono::steady_clock::time_point last_write;
+    /** Asynchronous writer, nullptr if blocking writes are used */
+    std::unique_ptr<UringWriter> uring;
+
+    DURABILITY durability;
+    std::chrono::milliseconds sync_interval;
+    std::chrono::steady_clock::time_point last_sync;
+    bool unsynced; /**< Data was written since the last sync */
+    std::size_t buffered_lines; /**< Messages in SinkFile#buffer */
+
+    bool degraded; /**< Writes failed, messages are dropped */
+    int last_error; /**< errno of the last failed open, write or sync */
+    std::uint64_t write_errors;
+    std::uint64_t dropped; /**< Messages lost since the sink was created */
+    std::uint64_t dropped_unreported; /**< Messages lost since the last report */
+    std::chrono::steady_clock::time_point next_retry;
+    /** Time between two attempts to leave the degraded mode */
+    static const std::chrono::milliseconds retry_interval;
+
+    std::size_t index_block; /**< Block size of the index, 0 if disabled */
+    int index_fd;            /**< File descriptor of the index, -1 if closed */
+    LogIndex::Entry index_entry; /**< The block that is currently written */
+    bool index_started; /**< SinkFile#index_entry is a valid block */
+    std::int64_t index_last_ns; /**< Latest timestamp of all blocks */
+    std::string index_record;   /**< Encoding buffer for entries */
+
     void write_message(const std::string &msg);
+    void write_message(const std::string &msg,
+                       ealogger::constants::LOG_LEVEL lvl);
+    void write_message(const std::string &msg,
+                       ealogger::constants::LOG_LEVEL lvl,
+                       std::chrono::system_clock::time_point time);
+    /**
+     * @brief Append data to SinkFile#buffer and write it if necessary
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void append(const char *data, std::size_t len, bool newline,
+                ealogger::constants::LOG_LEVEL lvl, bool message,
+                std::chrono::system_clock::time_point time);
+    void write_batch(const rendered_batch &lines);
+    void buffer_tick();
+    void buffer_flush();
+    /**
+     * @brief Drop messages without rendering them while the sink is degraded
+     */
+    bool drop_message();
     /**
      * @brief Called when Sink::set_enabled was called
      * @details
@@ -94,13 +361,63 @@ private:
      */
     void config_changed();
     /**
-     * @brief Open logfile
+     * @brief Write SinkFile#buffer to the file descriptor
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void write_buffer();
+    /**
+     * @brief Write SinkFile#buffer and sync the file to stable storage
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void commit();
+    /**
+     * @brief Record a failed open or write and enter the degraded mode
+     *
+     * @param err errno of the failed operation
+     * @param lost Messages that were lost besides the ones in SinkFile#buffer
+     * @param bytes Size of the failed write, the file is truncated by this
+     * amount so a partial write does not leave a torn message behind
+     *
+     * @details
+     * SinkFile#buffer is discarded. SinkFile#mtx_file has to be locked when
+     * calling this method
+     */
+    void write_failed(int err, std::uint64_t lost, std::uint64_t bytes);
+    /**
+     * @brief Record errors of asynchronous writes
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void check_uring();
+    /**
+     * @brief Try to leave the degraded mode and report the lost messages
+     *
+     * @return True if the sink writes again
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    bool retry_writes();
+    /**
+     * @brief Open the index of the log file, a new log file gets a new index
+     * @details
+     * Entries that point behind the end of the log file and a torn entry at
+     * the end of the index are removed.
+     *
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void open_index();
+    /**
+     * @brief Write the entry of the current block and close the index
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
      */
-    void open_file();
+    void close_index();
     /**
-     * @brief Close logfile
+     * @brief Write the entry of the current block if it has messages
      */
-    void close_file();
+    void finish_index_block();
 };
 /** @} */
 }
@@ -0,0 +1,159 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef SINK_FILE_BINARY_H
+#define SINK_FILE_BINARY_H
+
+/** @file sink_file_binary.h */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ealogger/binlog.h>
+#include <ealogger/sink_file.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Sink writing messages in the binary log format
+ * @details
+ *
+ * Messages are not rendered. Every message becomes a length prefixed record
+ * with a fixed header and the message text, file, function and logger names
+ * are written once per file in dictionary records. See ealogger::binlog for
+ * the format. The message template and the datetime pattern of the sink are
+ * stored in the file too, they are used when the file is rendered later.
+ *
+ * Buffering, durability, reopening and the handling of write errors are the
+ * same as for SinkFile.
+ *
+ * With \p checksums every record ends with a CRC-32C, see ealogger::binlog.
+ * When an existing file is opened the sink checks its records and cuts off a
+ * record that was torn by a crash or power loss, then it continues with the
+ * flags of the existing file. A message in the file reports the removed
+ * bytes. Files without checksums are checked for incomplete records only.
+ * An existing file that is no binary log file is never written, the sink
+ * treats it like a file that can not be opened and drops the messages.
+ *
+ * If a LogIndex is written, every block of the index starts with a new
+ * dictionary. The timestamps in the index are the ones of the messages.
+ */
+class SinkFileBinary : public SinkFile
+{
+public:
+    /**
+     * @brief SinkFileBinary constructor
+     *
+     * @param msg_template Message template stored in the file
+     * @param datetime_pattern Datetime pattern stored in the file
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Log file
+     * @param options Buffering, io_uring, durability and index settings
+     * @param checksums Write a checksum with every record of a new file
+     */
+    SinkFileBinary(std::string msg_template, std::string datetime_pattern,
+                   bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                   std::string log_file, const Options &options = Options(),
+                   bool checksums = false);
+
+protected:
+    /**
+     * @brief Recover an existing file or write the header of a new one and
+     * forget the dictionary of the old file
+     *
+     * @return False if the file exists and is no binary log file
+     */
+    bool file_opened();
+    /**
+     * @brief Write the report as a message record
+     * @details
+     * The dictionary is written again, some of its records may have been lost
+     */
+    void report_dropped(std::uint64_t count, int err);
+
+private:
+    /**
+     * @brief Key for the call site dictionary
+     */
+    struct CallSite {
+        std::string file;
+        std::string func;
+        int line;
+
+        bool operator==(const CallSite &other) const
+        {
+            return this->line == other.line && this->file == other.file &&
+                   this->func == other.func;
+        }
+    };
+    struct CallSiteHash {
+        std::size_t operator()(const CallSite &site) const
+        {
+            return std::hash<std::string>()(site.file) * 31 +
+                   std::hash<std::string>()(site.func) * 7 +
+                   static_cast<std::size_t>(site.line);
+        }
+    };
+
+    std::uint64_t sequence; /**< Sequence number of the next message */
+    bool checksums; /**< Checksums for new files */
+    bool framed;    /**< The open file has checksums */
+    std::unordered_map<CallSite, std::uint32_t, CallSiteHash> call_sites;
+    std::unordered_map<std::string, std::uint32_t> loggers;
+    std::string record; /**< Encoding buffer, reused for every record */
+    CallSite lookup;    /**< Reused key for SinkFileBinary#call_sites */
+
+    bool wants_log_messages() const { return true; }
+    void write_log_messages(
+        const std::vector<std::shared_ptr<LogMessage>> &messages);
+    /**
+     * @brief Encode \p m and its dictionary records and append them
+     */
+    void append_message(LogMessage &m);
+    /**
+     * @brief Append the RECORD::FORMAT record with the current settings
+     */
+    void append_format();
+    /**
+     * @brief Start a new block of the index and forget the dictionary
+     * @details
+     * The dictionary records are written again when they are needed, so the
+     * block can be decoded on its own.
+     */
+    void restart_dictionary();
+    /**
+     * @brief Cut off a torn record at the end of the open file
+     *
+     * @param torn Number of bytes that were removed
+     * @return False if the file is no binary log file
+     */
+    bool recover(std::uint64_t &torn);
+    std::uint32_t get_call_site(LogMessage &m);
+    std::uint32_t get_logger(LogMessage &m);
+};
+/** @} */
+}
+
+#endif /* SINK_FILE_BINARY_H */
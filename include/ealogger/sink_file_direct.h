@@ -0,0 +1,208 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef SINK_FILE_DIRECT_H
+#define SINK_FILE_DIRECT_H
+
+/** @file sink_file_direct.h */
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <ealogger/sink.h>
+#include <ealogger/sink_file.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Sink writing to a log file with O_DIRECT, bypassing the page cache
+ * @details
+ *
+ * Log files are written once and rarely read, but with normal writes they
+ * occupy the page cache and push out data other applications need. This sink
+ * opens the log file with O_DIRECT and only writes whole, aligned blocks of
+ * \p block_size bytes from an aligned buffer.
+ *
+ * The last block is usually incomplete. It is padded with NUL bytes when it is
+ * written and kept in the buffer, the next write rewrites it together with
+ * the new messages. When the sink is closed the file is truncated to the size
+ * of the messages, so only a crash leaves a padded tail behind.
+ *
+ * Messages are written when the buffer is full, \p flush_interval has passed,
+ * a message with at least \p flush_lvl arrives or the sink is flushed. Small
+ * writes are expensive because every write goes to the device, so do not
+ * choose a short flush interval.
+ *
+ * If the file system does not support O_DIRECT (tmpfs for example) the sink
+ * uses normal writes, SinkFileDirect::is_direct tells you which one is used.
+ * This sink is only available on Linux.
+ *
+ * If the buffer can not be allocated, the log file can not be opened or a
+ * write fails, the sink switches to a degraded mode. A failed write keeps the
+ * buffer and its file offset, new messages are dropped and counted until
+ * SinkFileDirect#retry_interval has passed. When the buffer could be written
+ * again, a line with the number of dropped messages follows it.
+ * SinkFileDirect::get_stats returns the counters.
+ */
+class SinkFileDirect : public Sink
+{
+public:
+    /**
+     * @brief SinkFileDirect constructor
+     *
+     * @param msg_template String with conversion specifiers
+     * @param datetime_pattern Conversion specifiers for date time
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Log file, new messages are appended
+     * @param options Buffer size, flush interval and flush severity
+     * @param block_size Alignment required by the device, usually the
+     * logical block size or the page size
+     *
+     * @details
+     * SinkFile::Options#buffer_size is rounded up to a multiple of \p
+     * block_size and at least two blocks. Messages longer than the buffer
+     * minus one block are cut off. The other members of \p options are not
+     * used by this sink.
+     */
+    SinkFileDirect(std::string msg_template, std::string datetime_pattern,
+                   bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                   std::string log_file,
+                   const SinkFile::Options &options = SinkFile::Options(),
+                   std::size_t block_size = 4096);
+    virtual ~SinkFileDirect();
+
+    /**
+     * @brief Check whether the log file is written with O_DIRECT
+     *
+     * @return False if the file is closed or the file system does not
+     * support O_DIRECT
+     */
+    bool is_direct();
+
+    /**
+     * @brief Get write errors and dropped messages
+     *
+     * @return SinkStats object, SinkStats#last_error is ENOMEM if the buffer
+     * could not be allocated
+     */
+    SinkStats get_stats();
+
+    /**
+     * @brief Write all buffered messages and reopen the log file
+     */
+    void reopen();
+
+private:
+    std::mutex mtx_file;
+    int fd; /**< File descriptor of the log file, -1 if closed */
+    bool direct;
+    std::string log_file;
+
+    char *buffer;            /**< Aligned buffer, starts with the tail block */
+    std::size_t buffer_size; /**< Capacity of SinkFileDirect#buffer */
+    std::size_t block_size;
+    std::size_t used;     /**< Bytes in SinkFileDirect#buffer */
+    std::uint64_t offset; /**< File offset of SinkFileDirect#buffer */
+    bool dirty;           /**< The buffer contains data not written yet */
+    std::uint64_t file_end; /**< End of the messages written to the file */
+    std::uint64_t pending_lines; /**< Lines in the buffer not written yet */
+
+    bool degraded;  /**< Writes failed, messages are dropped */
+    int last_error; /**< errno of the last failed allocation, open or write */
+    std::uint64_t write_errors;
+    std::uint64_t dropped; /**< Messages lost since the sink was created */
+    std::uint64_t dropped_unreported; /**< Messages lost since the last report */
+    std::chrono::steady_clock::time_point next_retry;
+    /** Time between two attempts to leave the degraded mode */
+    static const std::chrono::milliseconds retry_interval;
+
+    std::chrono::milliseconds flush_interval;
+    ealogger::constants::LOG_LEVEL flush_level;
+    std::chrono::steady_clock::time_point last_write;
+
+    void write_message(const std::string &msg);
+    void write_message(const std::string &msg,
+                       ealogger::constants::LOG_LEVEL lvl);
+    void buffer_tick();
+    void buffer_flush();
+    /**
+     * @brief Called when Sink::set_enabled was called
+     * @details
+     * Opens or closes logfile according to Sink#enabled
+     */
+    void config_changed();
+
+    /**
+     * @brief Append \p len bytes and a newline as one line
+     * @details
+     * If the line does not fit the buffer is written first, a line is always
+     * copied as a whole. A line longer than the buffer without one block is
+     * cut off.
+     *
+     * @return False if the buffer had to be written and the write failed,
+     * nothing of the line was copied then
+     */
+    bool append_line(const char *data, std::size_t len);
+    /**
+     * @brief Record a failed allocation, open or write and enter the degraded
+     * mode
+     */
+    void write_failed(int err);
+    /**
+     * @brief Try to leave the degraded mode once SinkFileDirect#next_retry
+     * has passed
+     * @details
+     * Reopens logfile if necessary, writes the buffer and appends a line with
+     * the number of dropped messages.
+     *
+     * @return True if the sink is no longer degraded
+     */
+    bool retry_writes();
+    /**
+     * @brief Open logfile and load its incomplete last block
+     * @details
+     * SinkFileDirect#mtx_file has to be locked when calling this method
+     */
+    void open_file();
+    /**
+     * @brief Write the buffer, truncate the padding and close logfile
+     * @details
+     * SinkFileDirect#mtx_file has to be locked when calling this method
+     */
+    void close_file();
+    /**
+     * @brief Write the buffer in whole blocks and keep the incomplete block
+     * @details
+     * If the write fails the buffer and SinkFileDirect#offset are left
+     * unchanged so the next attempt writes the same data again.
+     * SinkFileDirect#mtx_file has to be locked when calling this method
+     *
+     * @return False if the write failed
+     */
+    bool write_buffer();
+};
+/** @} */
+}
+
+#endif /* SINK_FILE_DIRECT_H */
@@ -0,0 +1,167 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef SINK_FILE_GZIP_H
+#define SINK_FILE_GZIP_H
+
+/** @file sink_file_gzip.h */
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <ealogger/sink.h>
+#include <ealogger/sink_file.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Sink writing a gzip compressed log file
+ * @details
+ *
+ * Rendered messages are collected in frames of \p frame_size bytes. A frame
+ * is finished when it is full, when \p flush_interval has passed since its
+ * first message or when the sink is flushed. Finished frames are compressed
+ * by a thread owned by the sink, every frame becomes a complete gzip member.
+ * Concatenated members are a valid gzip file, so a file that is still written
+ * or was cut off by a crash can be read up to the last complete frame with
+ * zcat or gunzip.
+ *
+ * The Logger thread only copies messages into the current frame. It waits for
+ * the compressor thread only if SinkFileGzip#max_pending_frames frames are
+ * queued already, which means the disk or the CPU can not keep up.
+ *
+ * A frame that can not be compressed or written is dropped and its lines are
+ * counted, a partially written frame is cut off the file again. Like SinkFile
+ * the sink then drops frames until SinkFileGzip#retry_interval has passed and
+ * reports the number of lost messages in the first frame that is written
+ * again. SinkFileGzip::get_stats returns the counters.
+ *
+ * @note
+ * If ealogger was built without zlib the frames are written uncompressed and
+ * a ".gz" suffix is removed from the name of the log file.
+ */
+class SinkFileGzip : public Sink
+{
+public:
+    /**
+     * @brief SinkFileGzip constructor
+     *
+     * @param msg_template String with conversion specifiers
+     * @param datetime_pattern Conversion specifiers for date time
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Log file, new frames are appended
+     * @param options Frame size and flush interval
+     * @param compression_level zlib compression level from 1 to 9
+     *
+     * @details
+     * SinkFile::Options#buffer_size is the uncompressed size of a frame and
+     * SinkFile::Options#flush_interval the maximum time a message is held in
+     * a frame. The other members of \p options are not used by this sink.
+     */
+    SinkFileGzip(std::string msg_template, std::string datetime_pattern,
+                 bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                 std::string log_file,
+                 const SinkFile::Options &options = SinkFile::Options(),
+                 int compression_level = 6);
+    virtual ~SinkFileGzip();
+
+    /**
+     * @brief Write all frames and reopen the log file
+     */
+    void reopen();
+    /**
+     * @brief Get write errors and dropped messages
+     *
+     * @return SinkStats object, SinkStats#last_error is EIO if zlib failed
+     */
+    SinkStats get_stats();
+
+private:
+    /** Frames that may wait for the compressor before the Logger blocks */
+    static const std::size_t max_pending_frames = 16;
+
+    std::mutex mtx_frame;
+    std::string frame; /**< Messages of the frame that is filled right now */
+    std::size_t frame_size;
+    std::chrono::milliseconds flush_interval;
+    std::chrono::steady_clock::time_point frame_start;
+
+    std::mutex mtx_fd;
+    int fd; /**< File descriptor of the log file, -1 if closed */
+    std::string log_file;
+    int compression_level;
+
+    /** Error state, guarded by SinkFileGzip#mtx_fd like the descriptor */
+    bool degraded;
+    int last_error; /**< errno of the last failed open or write */
+    std::uint64_t write_errors;
+    std::uint64_t dropped; /**< Messages lost since the sink was created */
+    std::uint64_t dropped_unreported; /**< Messages lost since the last report */
+    std::chrono::steady_clock::time_point next_retry;
+    /** Time between two attempts to leave the degraded mode */
+    static const std::chrono::milliseconds retry_interval;
+
+    std::mutex mtx_queue;
+    std::condition_variable cond_queue; /**< Frame queued or stop requested */
+    std::condition_variable cond_done;  /**< Frame written or space in queue */
+    std::deque<std::string> frames;     /**< Finished frames to compress */
+    bool compressing; /**< The compressor thread is working on a frame */
+    bool stop;
+    std::thread compressor;
+
+    void write_message(const std::string &msg);
+    void buffer_tick();
+    void buffer_flush();
+    void config_changed();
+
+    /**
+     * @brief Queue the current frame for compression
+     * @details
+     * SinkFileGzip#mtx_frame has to be locked when calling this method
+     */
+    void submit_frame();
+    /**
+     * @brief Wait until all queued frames have been written
+     */
+    void wait_frames();
+    /**
+     * @brief Entry point of the compressor thread
+     */
+    void compress_loop();
+
+    void open_file();
+    void close_file();
+    /**
+     * @brief Count the lost lines and enter the degraded mode
+     * @details
+     * SinkFileGzip#mtx_fd has to be locked when calling this method
+     */
+    void write_failed(int err, std::uint64_t lost);
+};
+/** @} */
+}
+
+#endif /* SINK_FILE_GZIP_H */
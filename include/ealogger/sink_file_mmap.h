@@ -0,0 +1,155 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef SINK_FILE_MMAP_H
+#define SINK_FILE_MMAP_H
+
+/** @file sink_file_mmap.h */
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <ealogger/sink.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Sink writing to memory mapped, preallocated segment files
+ * @details
+ *
+ * The log is split into segments of a fixed size named *logfile.N* where N
+ * counts up from the first index that does not exist yet. Every segment is
+ * preallocated with fallocate and mapped into memory, so writing a message is
+ * a memcpy into the mapping and the kernel takes care of writeback.
+ *
+ * The next segment is always prepared in advance. When a message does not fit
+ * into the current segment the sink switches to the prepared one and
+ * truncates the old segment to the size that was actually used, so every
+ * segment holds whole lines. A message longer than a segment is cut off to
+ * fill a segment on its own. The same happens with the current segment
+ * when the sink is closed, the prepared segment is removed.
+ *
+ * If the application crashes the current segment keeps its preallocated size,
+ * the unused tail consists of NUL bytes.
+ *
+ * A segment that can not be preallocated, for example on a full disk, is not
+ * used. Only file systems without fallocate get a sparse segment. Messages
+ * are dropped and counted until a new segment can be created,
+ * SinkFileMmap::get_stats reports errors and drops.
+ *
+ * This sink is only available on POSIX systems.
+ */
+class SinkFileMmap : public Sink
+{
+public:
+    /**
+     * @brief SinkFileMmap constructor
+     *
+     * @param msg_template String with conversion specifiers
+     * @param datetime_pattern Conversion specifiers for date time
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Base name of the segment files
+     * @param segment_size Size of a segment in bytes, rounded up to a multiple
+     * of the page size
+     */
+    SinkFileMmap(std::string msg_template, std::string datetime_pattern,
+                 bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                 std::string log_file, std::size_t segment_size);
+    virtual ~SinkFileMmap();
+
+    /**
+     * @brief Finish the current segment and continue with a new one
+     */
+    void reopen();
+    /**
+     * @brief Get failed segment operations and dropped messages
+     *
+     * @return SinkStats object, SinkStats#degraded is set while there is no
+     * segment to write to
+     */
+    SinkStats get_stats();
+
+private:
+    /**
+     * @brief A mapped segment file
+     */
+    struct Segment {
+        Segment() : fd(-1), data(nullptr), used(0) {}
+        int fd;
+        char *data;       /**< Mapping of the whole segment */
+        std::size_t used; /**< Bytes written to the segment */
+        std::string path;
+    };
+
+    std::mutex mtx_segment;
+    std::string log_file;
+    std::size_t segment_size;
+    unsigned int next_index; /**< Index of the next segment file */
+
+    Segment current; /**< Segment messages are written to */
+    Segment spare;   /**< Prepared segment for the next roll */
+    SinkStats stats; /**< Errors and drops, guarded by mtx_segment */
+    /** Earliest time to try again after a segment could not be created */
+    std::chrono::steady_clock::time_point next_retry;
+    /** Time between two attempts to create a segment */
+    static const std::chrono::milliseconds retry_interval;
+
+    void write_message(const std::string &msg);
+    /**
+     * @brief Called when Sink::set_enabled was called
+     * @details
+     * Maps or unmaps the segments according to Sink#enabled
+     */
+    void config_changed();
+    /**
+     * @brief Map the first segment and prepare the next one
+     */
+    void open_segments();
+    /**
+     * @brief Unmap all segments, truncate the current one and remove the
+     * prepared one
+     */
+    void close_segments();
+    /**
+     * @brief Create, preallocate and map a new segment file
+     *
+     * @param seg Segment object to initialize
+     *
+     * @return True on success
+     */
+    bool map_segment(Segment &seg);
+    /**
+     * @brief Unmap a segment and truncate it to the used size
+     *
+     * @param seg
+     */
+    void unmap_segment(Segment &seg);
+    /**
+     * @brief Switch to the prepared segment and prepare the next one
+     */
+    void roll();
+};
+/** @} */
+}
+
+#endif /* SINK_FILE_MMAP_H */
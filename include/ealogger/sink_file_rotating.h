@@ -0,0 +1,147 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef SINK_FILE_ROTATING_H
+#define SINK_FILE_ROTATING_H
+
+/** @file sink_file_rotating.h */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <ealogger/sink_file.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief SinkFile that rotates the log file by size and time
+ * @details
+ *
+ * The log file is rotated before a message would make it grow beyond
+ * \p max_size bytes or when a new \p interval has started. Intervals are
+ * aligned to the epoch, an interval of 24 hours rotates at midnight UTC.
+ *
+ * Rotation happens in the write path of the sink, with an asynchronous Logger
+ * this is the logger thread and producers are never blocked by it. The sink
+ * writes all buffered messages to the old file, waits for outstanding io_uring
+ * writes, closes and renames the file and opens a new one before the next
+ * message is appended. Every message therefore ends up in exactly one file.
+ *
+ * Rotated files are named according to SinkFileRotating::NAMING
+ * - INDEX: *logfile.1* is the most recent file, older files are shifted to
+ *   *logfile.2*, *logfile.3* and so on
+ * - DATETIME: *logfile.YYYYmmdd-HHMMSS* with the local time of the rotation
+ *
+ * Only the \p retention most recent rotated files are kept, 0 keeps all of
+ * them. With DATETIME naming every file starting with *logfile.* counts as a
+ * rotated file.
+ */
+class SinkFileRotating : public SinkFile
+{
+public:
+    /**
+     * @brief Naming scheme for rotated files
+     */
+    enum class NAMING {
+        INDEX = 0, /**< logfile.1, logfile.2, ... */
+        DATETIME   /**< logfile.YYYYmmdd-HHMMSS */
+    };
+
+    /**
+     * @brief SinkFileRotating constructor
+     *
+     * @param msg_template String with conversion specifiers
+     * @param datetime_pattern Conversion specifiers for date time
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param log_file Log file
+     * @param max_size Maximum size of the log file in bytes, 0 disables size
+     * based rotation
+     * @param interval Rotate when a new interval starts, 0 disables time based
+     * rotation
+     * @param retention Number of rotated files to keep, 0 keeps all files
+     * @param naming Naming scheme for rotated files
+     * @param options Buffering, io_uring and durability settings,
+     * SinkFile::Options#index_block is ignored because rotated files have no
+     * index
+     */
+    SinkFileRotating(std::string msg_template, std::string datetime_pattern,
+                     bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+                     std::string log_file, std::uint64_t max_size,
+                     std::chrono::seconds interval, std::size_t retention,
+                     NAMING naming, const Options &options = Options());
+    virtual ~SinkFileRotating();
+
+    /**
+     * @brief Get the number of rotations this sink has done
+     *
+     * @return Number of rotations
+     */
+    std::uint64_t get_rotations();
+
+private:
+    std::uint64_t max_size;
+    std::chrono::seconds interval;
+    std::size_t retention;
+    NAMING naming;
+
+    std::int64_t period; /**< Interval of the current file, -1 if unknown */
+    std::uint64_t rotations;
+
+    void prepare_append(std::size_t len);
+    /**
+     * @brief Rotated files need to see every line, write batches line by line
+     */
+    void write_batch(const rendered_batch &lines);
+
+    /**
+     * @brief Get the interval \p now belongs to
+     */
+    std::int64_t get_period(std::chrono::system_clock::time_point now);
+    /**
+     * @brief Close, rename and reopen the log file
+     * @details
+     * SinkFile#mtx_file has to be locked when calling this method
+     */
+    void rotate();
+    /**
+     * @brief Shift *logfile.N* to *logfile.N+1* and move the log file to
+     * *logfile.1*
+     *
+     * @return True if the log file was renamed
+     */
+    bool rotate_index();
+    /**
+     * @brief Move the log file to *logfile.YYYYmmdd-HHMMSS*
+     *
+     * @return True if the log file was renamed
+     */
+    bool rotate_datetime();
+    /**
+     * @brief Remove the oldest DATETIME files exceeding the retention count
+     */
+    void remove_expired();
+};
+/** @} */
+}
+
+#endif /* SINK_FILE_ROTATING_H */
@@ -0,0 +1,99 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef SINK_SHM_H
+#define SINK_SHM_H
+
+/** @file sink_shm.h */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ealogger/shm_ring.h>
+#include <ealogger/sink.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Sink writing to a ring buffer in shared memory
+ * @details
+ *
+ * A collector process on the same machine drains the ring and writes the
+ * messages wherever they have to go, ShmReader is the library for it and
+ * ealogger_collect a ready to use collector. The application does no file
+ * I/O for this sink, writing a message is a copy into the ring. Messages
+ * that were written stay in shared memory when the application crashes.
+ *
+ * With ShmRing::FORMAT::LINES the sink writes rendered lines. With
+ * ShmRing::FORMAT::MESSAGES it writes the LogMessage objects in binary form
+ * and the collector renders them, see ealogger::shm_ring.
+ *
+ * The sink never waits for the collector. If the ring is full the message
+ * is dropped and counted, SinkStats#messages_dropped and ShmReader report
+ * the drops. If the ring can not be created the sink is degraded and drops
+ * every message.
+ */
+class SinkShm : public Sink
+{
+public:
+    /**
+     * @brief SinkShm constructor
+     *
+     * @param msg_template Message template based on conversion patterns
+     * @param datetime_pattern Date and time conversion specifiers
+     * @param enabled Whether or not this sink is enabled
+     * @param min_lvl Minimum severity
+     * @param name Name of the shared memory object like "/myapp.log"
+     * @param capacity Size of the ring in bytes
+     * @param format Write rendered lines or binary messages
+     */
+    SinkShm(std::string msg_template, std::string datetime_pattern,
+            bool enabled, ealogger::constants::LOG_LEVEL min_lvl,
+            std::string name, std::size_t capacity = 4 * 1024 * 1024,
+            ShmRing::FORMAT format = ShmRing::FORMAT::LINES);
+
+    /**
+     * @brief Get statistics of this sink
+     *
+     * @return SinkStats with the drops of the ring
+     */
+    SinkStats get_stats();
+
+private:
+    ShmRing ring;
+    ShmRing::FORMAT format;
+    std::uint64_t sequence; /**< Sequence number of the next message */
+    std::string record;     /**< Encoding buffer, reused for every record */
+
+    void write_message(const std::string &msg);
+    void write_message(const std::string &msg,
+                       ealogger::constants::LOG_LEVEL lvl);
+    bool drop_message();
+    bool wants_log_messages() const;
+    void write_log_messages(
+        const std::vector<std::shared_ptr<LogMessage>> &messages);
+    void config_changed();
+};
+/** @} */
+}
+
+#endif /* SINK_SHM_H */
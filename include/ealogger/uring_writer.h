@@ -0,0 +1,186 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef URING_WRITER_H
+#define URING_WRITER_H
+
+/**
+ * @file uring_writer.h
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <ealogger/sink.h>
+
+namespace ealogger
+{
+/**
+ * @addtogroup SINK_GROUP
+ * @{
+ */
+
+/**
+ * @brief Asynchronous file writes with Linux io_uring
+ * @author Christian Rapp (crapp)
+ *
+ * @details
+ * The writer owns an io_uring with \p depth entries and as many write buffers
+ * that are registered with the kernel. UringWriter::write copies the data into
+ * a free buffer and submits it without waiting for the write to finish, so up
+ * to \p depth writes can be in flight. Completions are reaped without a
+ * system call whenever new data is written or UringWriter::reap is called.
+ * Only if all buffers are in flight the caller has to wait for the oldest
+ * write.
+ *
+ * Every write carries an explicit file offset so writes that complete out of
+ * order still end up in the right place. The file must therefore not be
+ * opened with O_APPEND and no one else may append to it.
+ *
+ * The io_uring is only available on Linux and if ealogger was built with
+ * EALOGGER_IO_URING. If the ring can not be created, for example because the
+ * kernel is too old or io_uring is blocked by a seccomp filter,
+ * UringWriter::is_active returns false and the file sink falls back to its
+ * regular write path.
+ */
+class UringWriter
+{
+public:
+    /**
+     * @brief Create the io_uring and the write buffers
+     *
+     * @param depth Maximum number of writes in flight
+     * @param buffer_size Size of every write buffer
+     */
+    UringWriter(std::size_t depth, std::size_t buffer_size);
+    ~UringWriter();
+
+    UringWriter(const UringWriter &) = delete;
+    UringWriter &operator=(const UringWriter &) = delete;
+
+    /**
+     * @brief Check if the io_uring could be created
+     *
+     * @return True if writes are submitted to an io_uring
+     */
+    bool is_active() const;
+    /**
+     * @brief Set the file all writes go to
+     *
+     * @param fd File descriptor, not opened with O_APPEND
+     * @param offset Offset of the next write, usually the file size
+     *
+     * @details
+     * All writes to the previous file have to be finished with
+     * UringWriter::wait_all before the file is changed.
+     */
+    void set_file(int fd, std::int64_t offset);
+    /**
+     * @brief Write data asynchronously at the end of the file
+     *
+     * @param data
+     * @param len
+     */
+    void write(const char *data, std::size_t len);
+    /**
+     * @brief Handle all completed writes, never blocks
+     */
+    void reap();
+    /**
+     * @brief Wait until all writes are finished
+     */
+    void wait_all();
+    /**
+     * @brief Copy the io_uring statistics to \p stats
+     *
+     * @param stats
+     *
+     * @details
+     * The completion latency is measured from the submission until the
+     * completion has been reaped.
+     */
+    void fill_stats(SinkStats &stats) const;
+    /**
+     * @brief Get and reset the error of the last failed write
+     *
+     * @param lines Will be set to the number of lines that were lost
+     *
+     * @return errno of the failed write, 0 if all writes succeeded
+     */
+    int take_error(std::uint64_t &lines);
+
+private:
+    /**
+     * @brief A registered write buffer
+     */
+    struct Slot {
+        char *buf;
+        std::size_t len; /**< Bytes in flight, 0 if the slot is free */
+        std::int64_t offset;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    int ring_fd;
+    int file_fd;
+    std::int64_t offset;
+    std::size_t buffer_size;
+    bool fixed_buffers; /**< Buffers are registered with the kernel */
+    std::vector<Slot> slots;
+
+    // mapped ring memory, the layout is described by io_uring_params
+    void *sq_ptr;
+    std::size_t sq_size;
+    void *cq_ptr;
+    std::size_t cq_size;
+    void *sqe_ptr;
+    std::size_t sqe_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    void *cqes;
+
+    std::uint64_t submitted;
+    std::uint64_t completed;
+    std::uint64_t in_flight;
+    std::uint64_t max_in_flight;
+    std::uint64_t latency_total_us;
+    std::uint64_t latency_max_us;
+    int error;                /**< errno of the last failed write */
+    std::uint64_t lines_lost; /**< Lines in writes that failed */
+
+    bool setup(unsigned depth);
+    void teardown();
+    /**
+     * @brief Get a free Slot, waits for a completion if all are in flight
+     */
+    Slot &free_slot();
+    void submit(std::size_t slot);
+    /**
+     * @brief Handle the completion of a write
+     *
+     * @param slot Index of the Slot
+     * @param res Result of the write, bytes written or negative errno
+     */
+    void complete(std::size_t slot, int res);
+};
+/** @} */
+}
+
+#endif /* URING_WRITER_H */
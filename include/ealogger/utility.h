@@ -21,17 +21,27 @@
  * @brief Header with utility functions for ealogger
  */
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #ifndef _WIN32
+#include <sys/uio.h>
 #include <unistd.h>
+#include <cerrno>
+#include <climits>
 #endif
 #ifdef _WIN32
 #include <winsock2.h>
 #pragma comment(lib, "Ws2_32.lib")
 #endif
 #include <algorithm>
+#include <cstdint>
 #include <ctime>
+#include <functional>
 #include <regex>
 #include <string>
+#include <thread>
+#include <vector>
 // Check for backtrace function
 #ifdef __GNUC__
 #include <cxxabi.h>
@@ -60,6 +70,22 @@ inline std::string get_hostname()
     return hname;
 }
 
+/**
+ * @brief Get a numeric id of the calling thread
+ * @return Kernel thread id on Linux, a hash of std::thread::id elsewhere
+ */
+inline std::uint64_t get_thread_id()
+{
+#ifdef __linux__
+    static thread_local std::uint64_t tid =
+        static_cast<std::uint64_t>(syscall(SYS_gettid));
+#else
+    static thread_local std::uint64_t tid =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+    return tid;
+}
+
 /**
  * @brief Get the last element of a path
  * @param absolute_path
@@ -71,6 +97,96 @@ inline std::string get_file_name(const std::string &absolute_path)
     return (absolute_path.substr(pos + 1));
 }
 
+/**
+ * @brief Match a string against a glob pattern
+ * @param pattern Pattern where * matches any sequence and ? any single character
+ * @param str String to match
+ * @return True if the whole string matches the pattern
+ */
+inline bool glob_match(const std::string &pattern, const char *str)
+{
+    const char *p = pattern.c_str();
+    const char *star = nullptr;
+    const char *backtrack = nullptr;
+    while (*str != '\0') {
+        if (*p == '*') {
+            // remember the position and try to match the rest first
+            star = ++p;
+            backtrack = str;
+        } else if (*p == '?' || *p == *str) {
+            p++;
+            str++;
+        } else if (star) {
+            p = star;
+            str = ++backtrack;
+        } else {
+            return false;
+        }
+    }
+    while (*p == '*')
+        p++;
+    return *p == '\0';
+}
+
+#ifndef _WIN32
+/**
+ * @brief Write all buffers of an iovec array to a file descriptor
+ * @param fd File descriptor
+ * @param iov Buffers to write, modified in case of partial writes
+ * @return True if everything has been written
+ *
+ * @details
+ * Uses as few writev calls as possible, at most IOV_MAX buffers are
+ * submitted at once. Partial writes and EINTR are retried.
+ */
+inline bool write_vectored(int fd, std::vector<struct iovec> &iov)
+{
+#ifdef IOV_MAX
+    const std::size_t max_iov = IOV_MAX;
+#else
+    const std::size_t max_iov = 1024;
+#endif
+    std::size_t first = 0;
+    while (first < iov.size()) {
+        int count = static_cast<int>(std::min(iov.size() - first, max_iov));
+        ssize_t n = writev(fd, &iov[first], count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        // skip the buffers that were written completely
+        std::size_t written = static_cast<std::size_t>(n);
+        while (first < iov.size() && written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (written > 0) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) +
+                                  written;
+            iov[first].iov_len -= written;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Append the lines of a batch followed by a newline to an iovec array
+ * @param iov Target array
+ * @param lines Container of objects with the line as member text
+ */
+template <typename T>
+inline void append_lines_iovec(std::vector<struct iovec> &iov, const T &lines)
+{
+    static char newline = '\n';
+    for (const auto &line : lines) {
+        iov.push_back({const_cast<char *>(line.text.data()),
+                       line.text.size()});
+        iov.push_back({&newline, 1});
+    }
+}
+#endif
+
 /**
  * @brief Print a demangled stacktrace
  * @param size How many elements of the stack this should capture
@@ -0,0 +1,382 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/binlog_reader.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <fstream>
+#include <io.h>
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+namespace bl = ealogger::binlog;
+
+eal::BinlogReader::BinlogReader(std::string path)
+    : path(std::move(path)),
+      fd(-1),
+      dev(0),
+      ino(0),
+      data(nullptr),
+      size(0),
+      pos(0),
+      valid(false),
+      checksums(false),
+      skipped(0),
+      format_count(0),
+      sequence(0)
+{
+    this->open_file();
+}
+
+eal::BinlogReader::~BinlogReader() { this->close_file(); }
+bool eal::BinlogReader::is_valid() const { return this->valid; }
+bool eal::BinlogReader::refresh()
+{
+    if (!this->valid)
+        return false;
+    struct stat st;
+    if (this->fd >= 0 && fstat(this->fd, &st) == 0) {
+        std::uint64_t st_size = static_cast<std::uint64_t>(st.st_size);
+        if (st_size > this->size) {
+            this->map_file(st_size);
+            return true;
+        }
+        // truncated in place (copytruncate), the mapping reaches beyond the
+        // end of the file now. Start over with what was written since.
+        if (st_size < this->size) {
+            this->open_file();
+            return this->pos < this->size;
+        }
+    }
+    if (this->pos < this->size)
+        return true;
+    // the old file is read completely, look for a new one
+    if (stat(this->path.c_str(), &st) == 0 &&
+        (this->fd < 0 || static_cast<std::uint64_t>(st.st_dev) != this->dev ||
+         static_cast<std::uint64_t>(st.st_ino) != this->ino)) {
+        this->open_file();
+        return this->pos < this->size;
+    }
+    return false;
+}
+
+bool eal::BinlogReader::next(std::shared_ptr<LogMessage> &m)
+{
+    if (!this->valid)
+        return false;
+    if (this->pos == 0) {
+        if (this->size < bl::file_header_size)
+            return false;
+        if (!bl::is_file_header(this->data, this->size)) {
+            this->valid = false;
+            return false;
+        }
+        this->checksums = (bl::get_file_flags(this->data) &
+                           bl::flag_checksum) != 0;
+        this->pos = bl::file_header_size;
+    }
+    while (this->size - this->pos >= bl::record_prefix_size) {
+        int state = this->check_record(this->pos);
+        // incomplete, the rest has not been written yet
+        if (state == 0)
+            return false;
+        if (state < 0) {
+            if (!this->checksums) {
+                this->valid = false;
+                return false;
+            }
+            if (!this->resync())
+                return false;
+            continue;
+        }
+        const char *rec = this->data + this->pos;
+        std::uint32_t rec_size = bl::get<std::uint32_t>(rec);
+        this->pos += 4 + static_cast<std::uint64_t>(rec_size);
+        bl::RECORD type = static_cast<bl::RECORD>(rec[4]);
+        const char *body = rec + bl::record_prefix_size;
+        std::size_t len =
+            rec_size - 1 - (this->checksums ? bl::checksum_size : 0);
+        if (type == bl::RECORD::MESSAGE) {
+            if (this->read_message(body, len, m))
+                return true;
+        } else {
+            this->read_dictionary(type, body, len);
+        }
+    }
+    return false;
+}
+
+bool eal::BinlogReader::find_valid_end(std::uint64_t &end, std::uint64_t from)
+{
+    end = 0;
+    if (this->fd < 0)
+        return false;
+    if (this->size == 0)
+        return true;
+    if (this->size < bl::file_header_size ||
+        !bl::is_file_header(this->data, this->size)) {
+        // only a header that was torn while the file was created is replaced,
+        // other files are not ours to truncate
+        std::size_t n = static_cast<std::size_t>(
+            std::min<std::uint64_t>(this->size, bl::file_header_size));
+        bool torn = std::memcmp(this->data, bl::magic,
+                                std::min(n, sizeof(bl::magic))) == 0 ||
+                    std::all_of(this->data, this->data + n,
+                                [](char c) { return c == 0; });
+        return torn;
+    }
+    this->checksums =
+        (bl::get_file_flags(this->data) & bl::flag_checksum) != 0;
+    std::uint64_t p = bl::file_header_size;
+    // only a checksum proves that a record starts at from
+    if (this->checksums && from > p && from < this->size &&
+        this->size - from >= bl::record_prefix_size &&
+        this->check_record(from) > 0)
+        p = from;
+    while (this->size - p >= bl::record_prefix_size &&
+           this->check_record(p) > 0)
+        p += 4 + static_cast<std::uint64_t>(
+                     bl::get<std::uint32_t>(this->data + p));
+    end = p;
+    return true;
+}
+
+bool eal::BinlogReader::has_checksums() const { return this->checksums; }
+std::uint64_t eal::BinlogReader::get_skipped() const { return this->skipped; }
+void eal::BinlogReader::seek(std::uint64_t offset)
+{
+    this->call_sites.clear();
+    this->loggers.clear();
+    this->pos = std::min(offset, this->size);
+}
+
+std::uint64_t eal::BinlogReader::get_sequence() const { return this->sequence; }
+std::uint64_t eal::BinlogReader::get_offset() const { return this->pos; }
+const std::string &eal::BinlogReader::get_msg_template() const
+{
+    return this->msg_template;
+}
+
+const std::string &eal::BinlogReader::get_datetime_pattern() const
+{
+    return this->datetime_pattern;
+}
+
+std::size_t eal::BinlogReader::get_format_count() const
+{
+    return this->format_count;
+}
+
+void eal::BinlogReader::open_file()
+{
+    this->close_file();
+    this->call_sites.clear();
+    this->loggers.clear();
+    this->pos = 0;
+#ifdef _WIN32
+    this->fd = _open(this->path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    this->fd = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    this->valid = this->fd >= 0;
+    struct stat st;
+    if (this->fd < 0 || fstat(this->fd, &st) != 0)
+        return;
+    this->dev = static_cast<std::uint64_t>(st.st_dev);
+    this->ino = static_cast<std::uint64_t>(st.st_ino);
+    this->map_file(static_cast<std::uint64_t>(st.st_size));
+    // BinlogReader::seek may skip the header
+    if (bl::is_file_header(this->data, this->size))
+        this->checksums =
+            (bl::get_file_flags(this->data) & bl::flag_checksum) != 0;
+}
+
+void eal::BinlogReader::close_file()
+{
+#ifdef _WIN32
+    this->contents.clear();
+    if (this->fd >= 0)
+        _close(this->fd);
+#else
+    if (this->data)
+        munmap(const_cast<char *>(this->data), this->size);
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+    this->data = nullptr;
+    this->size = 0;
+    this->fd = -1;
+}
+
+void eal::BinlogReader::map_file(std::uint64_t len)
+{
+#ifdef _WIN32
+    // read what was added since the last call
+    std::ifstream in(this->path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(this->contents.size()));
+    this->contents.append(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+    this->data = this->contents.data();
+    this->size = std::min<std::uint64_t>(len, this->contents.size());
+#else
+    if (this->data)
+        munmap(const_cast<char *>(this->data), this->size);
+    this->data = nullptr;
+    this->size = 0;
+    if (len == 0)
+        return;
+    void *p = mmap(nullptr, len, PROT_READ, MAP_SHARED, this->fd, 0);
+    if (p == MAP_FAILED) {
+        this->valid = false;
+        return;
+    }
+    madvise(p, len, MADV_SEQUENTIAL);
+    this->data = static_cast<const char *>(p);
+    this->size = len;
+#endif
+}
+
+int eal::BinlogReader::check_record(std::uint64_t offset) const
+{
+    const char *rec = this->data + offset;
+    std::uint32_t rec_size = bl::get<std::uint32_t>(rec);
+    std::uint32_t min_size =
+        1 + (this->checksums ? static_cast<std::uint32_t>(bl::checksum_size)
+                             : 0);
+    if (rec_size < min_size)
+        return -1;
+    if (this->size - offset - 4 < rec_size)
+        return 0;
+    if (this->checksums && !bl::check_record(rec, rec_size))
+        return -1;
+    return 1;
+}
+
+bool eal::BinlogReader::resync()
+{
+    const std::uint64_t min_record =
+        bl::record_prefix_size + bl::checksum_size;
+    for (std::uint64_t p = this->pos + 1; this->size - p >= min_record; p++) {
+        // an incomplete record here may just be garbage, keep searching
+        if (this->check_record(p) > 0) {
+            this->skipped += p - this->pos;
+            this->pos = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool eal::BinlogReader::read_dictionary(bl::RECORD type, const char *body,
+                                        std::size_t len)
+{
+    switch (type) {
+    case bl::RECORD::FORMAT: {
+        if (len < 4)
+            return false;
+        std::uint32_t tlen = bl::get<std::uint32_t>(body);
+        if (tlen > len - 4)
+            return false;
+        this->msg_template.assign(body + 4, tlen);
+        this->datetime_pattern.assign(body + 4 + tlen, len - 4 - tlen);
+        this->format_count++;
+        return true;
+    }
+    case bl::RECORD::CALL_SITE: {
+        if (len < 12)
+            return false;
+        std::uint32_t id = bl::get<std::uint32_t>(body);
+        std::uint32_t flen = bl::get<std::uint32_t>(body + 8);
+        if (flen > len - 12)
+            return false;
+        if (id >= this->call_sites.size())
+            this->call_sites.resize(id + 1);
+        CallSite &site = this->call_sites[id];
+        site.line = bl::get<std::int32_t>(body + 4);
+        site.file.assign(body + 12, flen);
+        site.func.assign(body + 12 + flen, len - 12 - flen);
+        return true;
+    }
+    case bl::RECORD::LOGGER: {
+        if (len < 4)
+            return false;
+        std::uint32_t id = bl::get<std::uint32_t>(body);
+        if (id >= this->loggers.size())
+            this->loggers.resize(id + 1);
+        this->loggers[id].assign(body + 4, len - 4);
+        return true;
+    }
+    default:
+        // unknown records are skipped
+        return true;
+    }
+}
+
+bool eal::BinlogReader::read_message(const char *body, std::size_t len,
+                                     std::shared_ptr<LogMessage> &m)
+{
+    if (len < bl::message_header_size)
+        return false;
+    std::int64_t ns = bl::get<std::int64_t>(body);
+    std::uint32_t site_id = bl::get<std::uint32_t>(body + 24);
+    std::uint32_t logger = bl::get<std::uint32_t>(body + 28);
+    std::uint8_t lvl = bl::get<std::uint8_t>(body + 36);
+    std::uint8_t type = bl::get<std::uint8_t>(body + 37);
+    if (lvl >= con::LOG_LEVEL_COUNT || site_id >= this->call_sites.size())
+        return false;
+
+    const CallSite &site = this->call_sites[site_id];
+    const char *payload = body + bl::message_header_size;
+    std::size_t payload_len = len - bl::message_header_size;
+    if (type == LogMessage::LOGTYPE::STACK) {
+        std::vector<std::string> elements;
+        std::size_t p = 0;
+        while (payload_len - p >= 4) {
+            std::uint32_t elen = bl::get<std::uint32_t>(payload + p);
+            if (elen > payload_len - p - 4)
+                break;
+            elements.emplace_back(payload + p + 4, elen);
+            p += 4 + elen;
+        }
+        m = std::make_shared<LogMessage>(
+            static_cast<con::LOG_LEVEL>(lvl), std::move(elements),
+            LogMessage::LOGTYPE::STACK, site.file, site.line, site.func);
+    } else {
+        m = std::make_shared<LogMessage>(
+            static_cast<con::LOG_LEVEL>(lvl),
+            std::string(payload, payload_len), LogMessage::LOGTYPE::DEFAULT,
+            site.file, site.line, site.func);
+    }
+    m->set_time(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(ns))));
+    m->set_thread_id(bl::get<std::uint64_t>(body + 16));
+    m->set_sample_weight(bl::get<std::uint32_t>(body + 32));
+    if (logger > 0 && logger < this->loggers.size())
+        m->set_logger_name(this->loggers[logger]);
+    this->sequence = bl::get<std::uint64_t>(body + 8);
+    return true;
+}
@@ -0,0 +1,137 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <algorithm>
+
+#include <ealogger/callsite.h>
+#include <ealogger/utility.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+bool eal::CallSite::register_site(const char *caller_func)
+{
+    return eal::CallSiteRegistry::instance().register_site(*this, caller_func) ==
+           ENABLED;
+}
+
+bool eal::CallSiteQuery::matches(const char *file, const char *func,
+                                 int site_line,
+                                 con::LOG_LEVEL site_level) const
+{
+    if (this->match_level && this->level != site_level)
+        return false;
+    if (this->line != 0 && this->line != site_line)
+        return false;
+    if (!eal::utility::glob_match(this->func_pattern, func))
+        return false;
+    if (eal::utility::glob_match(this->file_pattern, file))
+        return true;
+    // try all parts of the path that start after a directory separator
+    for (const char *p = file; *p != '\0'; p++) {
+        if ((*p == '/' || *p == '\\') &&
+            eal::utility::glob_match(this->file_pattern, p + 1))
+            return true;
+    }
+    return false;
+}
+
+eal::CallSiteRegistry::CallSiteRegistry() {}
+eal::CallSiteRegistry &eal::CallSiteRegistry::instance()
+{
+    static CallSiteRegistry registry;
+    return registry;
+}
+
+std::size_t eal::CallSiteRegistry::set_enabled(const CallSiteQuery &query,
+                                               bool enabled)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_registry);
+    // an identical older rule is superseded by this one
+    this->rules.erase(
+        std::remove_if(this->rules.begin(), this->rules.end(),
+                       [&query](const Rule &r) {
+                           return r.query.file_pattern == query.file_pattern &&
+                                  r.query.func_pattern == query.func_pattern &&
+                                  r.query.line == query.line &&
+                                  r.query.match_level == query.match_level &&
+                                  r.query.level == query.level;
+                       }),
+        this->rules.end());
+    this->rules.push_back(Rule{query, enabled});
+
+    std::size_t matched = 0;
+    for (CallSite *site : this->sites) {
+        if (query.matches(site->file, site->func, site->line, site->level)) {
+            site->state.store(enabled ? CallSite::ENABLED : CallSite::DISABLED,
+                              std::memory_order_release);
+            matched++;
+        }
+    }
+    return matched;
+}
+
+std::size_t eal::CallSiteRegistry::set_enabled(const std::string &file_pattern,
+                                               bool enabled)
+{
+    CallSiteQuery query;
+    query.file_pattern = file_pattern;
+    return this->set_enabled(query, enabled);
+}
+
+std::size_t eal::CallSiteRegistry::set_enabled(const std::string &file_pattern,
+                                               con::LOG_LEVEL lvl, bool enabled)
+{
+    CallSiteQuery query;
+    query.file_pattern = file_pattern;
+    query.match_level = true;
+    query.level = lvl;
+    return this->set_enabled(query, enabled);
+}
+
+std::vector<eal::CallSiteInfo> eal::CallSiteRegistry::get_call_sites()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_registry);
+    std::vector<CallSiteInfo> infos;
+    infos.reserve(this->sites.size());
+    for (CallSite *site : this->sites) {
+        infos.push_back(CallSiteInfo{
+            site->file, site->line, site->func, site->level,
+            site->state.load(std::memory_order_relaxed) == CallSite::ENABLED});
+    }
+    return infos;
+}
+
+int eal::CallSiteRegistry::register_site(CallSite &site, const char *func)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_registry);
+    // another thread may have been faster
+    int state = site.state.load(std::memory_order_relaxed);
+    if (state != CallSite::UNREGISTERED)
+        return state;
+
+    site.func = func;
+    site.id = static_cast<std::uint32_t>(this->sites.size()) + 1;
+    this->sites.push_back(&site);
+
+    state = CallSite::ENABLED;
+    for (const Rule &rule : this->rules) {
+        if (rule.query.matches(site.file, site.func, site.line, site.level))
+            state = rule.enabled ? CallSite::ENABLED : CallSite::DISABLED;
+    }
+    // publishes func and id to threads that see the new state
+    site.state.store(state, std::memory_order_release);
+    return state;
+}
@@ -0,0 +1,157 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/crc32c.h>
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define EALOGGER_CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define EALOGGER_CRC32C_ARM
+#endif
+
+namespace eal = ealogger;
+
+namespace
+{
+/** Reflected CRC-32C polynomial */
+const std::uint32_t poly = 0x82f63b78;
+
+/**
+ * @brief Lookup tables for slicing by eight
+ */
+struct Tables {
+    std::uint32_t t[8][256];
+
+    Tables()
+    {
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t crc = i;
+            for (int k = 0; k < 8; k++)
+                crc = (crc >> 1) ^ (poly & (0u - (crc & 1)));
+            this->t[0][i] = crc;
+        }
+        for (std::uint32_t i = 0; i < 256; i++) {
+            for (int s = 1; s < 8; s++)
+                this->t[s][i] = (this->t[s - 1][i] >> 8) ^
+                                this->t[0][this->t[s - 1][i] & 0xff];
+        }
+    }
+};
+
+std::uint32_t extend_sw(std::uint32_t crc, const unsigned char *p,
+                        std::size_t len)
+{
+    static const Tables tables;
+    const std::uint32_t(*t)[256] = tables.t;
+    while (len >= 8) {
+        // the tables expect the bytes in little endian order
+        std::uint32_t lo = crc ^ (static_cast<std::uint32_t>(p[0]) |
+                                  static_cast<std::uint32_t>(p[1]) << 8 |
+                                  static_cast<std::uint32_t>(p[2]) << 16 |
+                                  static_cast<std::uint32_t>(p[3]) << 24);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][p[4]] ^
+              t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#ifdef EALOGGER_CRC32C_SSE42
+__attribute__((target("sse4.2"))) std::uint32_t extend_hw(
+    std::uint32_t crc, const unsigned char *p, std::size_t len)
+{
+    std::uint64_t c = crc;
+    while (len >= 8) {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    std::uint32_t c32 = static_cast<std::uint32_t>(c);
+    if (len >= 4) {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        c32 = _mm_crc32_u32(c32, v);
+        p += 4;
+        len -= 4;
+    }
+    while (len-- > 0)
+        c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+bool cpu_has_crc()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(EALOGGER_CRC32C_ARM)
+std::uint32_t extend_hw(std::uint32_t crc, const unsigned char *p,
+                        std::size_t len)
+{
+    while (len >= 8) {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = __crc32cb(crc, *p++);
+    return crc;
+}
+
+// the compiler only defines __ARM_FEATURE_CRC32 for CPUs that have it
+bool cpu_has_crc() { return true; }
+#else
+std::uint32_t extend_hw(std::uint32_t crc, const unsigned char *p,
+                        std::size_t len)
+{
+    return extend_sw(crc, p, len);
+}
+
+bool cpu_has_crc() { return false; }
+#endif
+
+typedef std::uint32_t (*extend_fn)(std::uint32_t, const unsigned char *,
+                                   std::size_t);
+
+extend_fn get_extend()
+{
+    // a function local static is safe to use from static initializers
+    static const extend_fn fn = cpu_has_crc() ? extend_hw : extend_sw;
+    return fn;
+}
+}
+
+std::uint32_t eal::crc32c::extend(std::uint32_t crc, const char *data,
+                                  std::size_t len)
+{
+    // the bit inversion at start and end is part of CRC-32C
+    return ~get_extend()(~crc, reinterpret_cast<const unsigned char *>(data),
+                         len);
+}
+
+bool eal::crc32c::is_hardware() { return cpu_has_crc(); }
@@ -15,6 +15,14 @@
 
 #include <ealogger/ealogger.h>
 
+#include <set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /**
  * @file ealogger.cpp
  */
@@ -22,22 +30,77 @@
 namespace eal = ealogger;
 namespace con = ealogger::constants;
 
-eal::Logger::Logger(bool async) : async(async)
-{
-    this->logger_mutex_map.emplace(
-        con::LOGGER_SINK::EAL_CONSOLE,
-        std::unique_ptr<std::mutex>(new std::mutex()));
-    this->logger_mutex_map.emplace(
-        con::LOGGER_SINK::EAL_SYSLOG,
-        std::unique_ptr<std::mutex>(new std::mutex()));
-    this->logger_mutex_map.emplace(
-        con::LOGGER_SINK::EAL_FILE_SIMPLE,
-        std::unique_ptr<std::mutex>(new std::mutex()));
+namespace
+{
+/**
+ * @brief All Loggers that have to be notified about SIGUSR1
+ */
+struct LoggerRegistry {
+    std::mutex mtx;
+    std::set<eal::Logger *> loggers;
+};
+
+LoggerRegistry &logger_registry()
+{
+    // never destroyed, the signal watcher thread may still use it at exit
+    static LoggerRegistry *registry = new LoggerRegistry();
+    return *registry;
+}
+
+/** Self pipe between the SIGUSR1 handler and the signal watcher thread */
+int signal_pipe[2] = {-1, -1};
+/** Incremented by the signal watcher thread for every SIGUSR1 */
+std::atomic<unsigned int> reopen_generation(0);
+}
+
+eal::Logger::Logger(bool async)
+    : root_name(""), level(static_cast<int>(con::LOG_LEVEL::EAL_DEBUG)),
+      sink_level(con::LOG_LEVEL_COUNT), write_level(con::LOG_LEVEL_COUNT),
+      commit_level(con::LOG_LEVEL_COUNT), processed(0), reopen_seen(0),
+      async(async), dispatch(std::make_shared<std::vector<SinkSlot>>()),
+      next_rate_report(0), recorder(nullptr)
+{
+    for (auto &ls : this->level_samplers) {
+        ls.type.store(eal::Sampler::SAMPLE_TYPE::NONE);
+        ls.value.store(1);
+    }
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_CONSOLE,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_SYSLOG,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_SIMPLE,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_MMAP,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_ROTATING,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_GZIP,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_DIRECT,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_FILE_BINARY,
+                                   std::make_shared<std::mutex>());
+    this->logger_mutex_map.emplace(con::LOGGER_SINK::EAL_SHM,
+                                   std::make_shared<std::mutex>());
 // TODO: Make registration of signal handler configurable
 #ifdef __linux__
+    static std::once_flag watcher_once;
+    std::call_once(watcher_once, []() {
+        if (pipe2(signal_pipe, O_CLOEXEC) != 0)
+            throw std::runtime_error("Could not create pipe for SIGUSR1");
+        // the signal handler must never block on a full pipe
+        fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK);
+        std::thread(&eal::Logger::signal_watcher).detach();
+    });
     if (signal(SIGUSR1, eal::Logger::logrotate) == SIG_ERR)
         throw std::runtime_error("Could not create signal handler for SIGUSR1");
 #endif
+    this->reopen_seen = reopen_generation.load();
+    {
+        LoggerRegistry &registry = logger_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.loggers.insert(this);
+    }
 
     if (this->async) {
         logger_thread_stop = false;
@@ -47,6 +110,11 @@ eal::Logger::Logger(bool async) : async(async)
 
 eal::Logger::~Logger()
 {
+    {
+        LoggerRegistry &registry = logger_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.loggers.erase(this);
+    }
     if (this->async) {
         // wait for queue to be emptied. after 1 second we will exit the background logger thread
         int i = 0;
@@ -60,7 +128,8 @@ eal::Logger::~Logger()
         this->set_logger_thread_stop(true);
         // we need to write one more log message to wakeup the background logger
         // thread it will pop the last message from the queue.
-        this->write_log("Logger EXIT", con::LOG_LEVEL::EAL_INTERNAL, "", 0, "");
+        this->push_log_message("Logger EXIT", con::LOG_LEVEL::EAL_INTERNAL, "",
+                               0, "", 1, this->root_name);
         try {
             logger_thread.join();
         } catch (const std::system_error &ex) {
@@ -68,11 +137,244 @@ eal::Logger::~Logger()
                       << ex.what() << std::endl;
         }
     }
+    // call sites that went quiet still report what they suppressed
+    this->write_rate_reports(true);
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_rate_reports);
+        for (auto &r : this->rate_reports)
+            r.first->clear_reporter(this);
+    }
+    this->internal_flush_routine();
 }
 
 void eal::Logger::write_log(std::string msg, con::LOG_LEVEL lvl,
                             std::string file, int lnumber, std::string func)
 {
+    if (!this->will_write(lvl))
+        return;
+    this->write_log_named(this->root_name, std::move(msg), lvl,
+                          std::move(file), lnumber, std::move(func));
+}
+
+void eal::Logger::write_log(std::string msg, con::LOG_LEVEL lvl)
+{
+    this->write_log(std::move(msg), lvl, "", 0, "");
+}
+
+void eal::Logger::set_sampling(con::LOG_LEVEL lvl,
+                               eal::Sampler::SAMPLE_TYPE type,
+                               std::uint64_t value)
+{
+    LevelSampler &ls = this->level_samplers[static_cast<int>(lvl)];
+    ls.value.store(value, std::memory_order_relaxed);
+    ls.type.store(type, std::memory_order_relaxed);
+}
+
+eal::SampleStats eal::Logger::get_sample_stats(con::LOG_LEVEL lvl)
+{
+    return this->level_samplers[static_cast<int>(lvl)].sampler.get_stats();
+}
+
+eal::ChildLogger &eal::Logger::get(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_child_loggers);
+    auto it = this->child_loggers.find(name);
+    if (it != this->child_loggers.end())
+        return *(it->second);
+
+    // make sure all ancestors exist so levels can be inherited along the path
+    ChildLogger *parent = nullptr;
+    std::size_t pos = 0;
+    while (true) {
+        pos = name.find('.', pos);
+        std::string path = name.substr(0, pos);
+        std::unique_ptr<ChildLogger> &child = this->child_loggers[path];
+        if (!child) {
+            child = std::unique_ptr<ChildLogger>(
+                new ChildLogger(*this, path, parent));
+        }
+        parent = child.get();
+        if (pos == std::string::npos)
+            break;
+        pos++;
+    }
+    this->update_child_levels();
+    return *parent;
+}
+
+void eal::Logger::set_level(con::LOG_LEVEL lvl)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_child_loggers);
+    this->level.store(static_cast<int>(lvl), std::memory_order_relaxed);
+    this->update_child_levels();
+}
+
+void eal::Logger::set_level(const std::string &name, con::LOG_LEVEL lvl)
+{
+    this->get(name).set_level(lvl);
+}
+
+void eal::Logger::reset_level(const std::string &name)
+{
+    this->get(name).reset_level();
+}
+
+con::LOG_LEVEL eal::Logger::get_level()
+{
+    return static_cast<con::LOG_LEVEL>(
+        this->level.load(std::memory_order_relaxed));
+}
+
+void eal::Logger::update_child_levels()
+{
+    // std::map is sorted, a parent name is a prefix of its children's names so
+    // it is always updated first
+    int root_level = this->level.load(std::memory_order_relaxed);
+    for (const auto &child : this->child_loggers) {
+        ChildLogger &c = *(child.second);
+        int lvl = c.explicit_level;
+        if (lvl < 0) {
+            lvl = c.parent ? c.parent->effective_level.load(
+                                 std::memory_order_relaxed)
+                           : root_level;
+        }
+        c.effective_level.store(lvl, std::memory_order_relaxed);
+    }
+}
+
+void eal::Logger::update_sink_level()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_sink_level);
+    int lvl = con::LOG_LEVEL_COUNT;
+    int commit_lvl = con::LOG_LEVEL_COUNT;
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> sink_lock(*slot.mtx);
+        if (slot.active() && slot.sink->get_enabled()) {
+            lvl = std::min(lvl, static_cast<int>(slot.sink->get_lowest_lvl()));
+            commit_lvl = std::min(commit_lvl, slot.sink->get_commit_lvl());
+        }
+    }
+    this->sink_level.store(lvl, std::memory_order_relaxed);
+    this->commit_level.store(commit_lvl, std::memory_order_relaxed);
+    FlightRecorder *fr = this->recorder.load(std::memory_order_relaxed);
+    if (fr)
+        lvl = std::min(lvl, static_cast<int>(fr->get_min_lvl()));
+    this->write_level.store(lvl, std::memory_order_relaxed);
+}
+
+void eal::Logger::rebuild_dispatch()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_dispatch);
+    std::shared_ptr<std::vector<SinkSlot>> sinks =
+        std::make_shared<std::vector<SinkSlot>>();
+    for (const auto &sink_mutex : this->logger_mutex_map) {
+        std::lock_guard<std::mutex> sink_lock(*(sink_mutex.second.get()));
+        auto it = this->logger_sink_map.find(sink_mutex.first);
+        if (it != this->logger_sink_map.end())
+            sinks->push_back(
+                SinkSlot{it->second, sink_mutex.second, nullptr});
+    }
+    for (const auto &named : this->named_sinks)
+        sinks->push_back(named.second);
+    std::atomic_store(&this->dispatch,
+                      std::shared_ptr<const std::vector<SinkSlot>>(sinks));
+}
+
+void eal::Logger::write_log_named(const std::string &logger_name,
+                                  std::string msg, con::LOG_LEVEL lvl,
+                                  std::string file, int lnumber,
+                                  std::string func)
+{
+    std::uint32_t weight = 1;
+    if (!this->sample_level(lvl, weight))
+        return;
+    this->push_log_message(std::move(msg), lvl, std::move(file), lnumber,
+                           std::move(func), weight, logger_name);
+}
+
+void eal::Logger::add_rate_report(const std::string &logger_name,
+                                  CallSite &site, RateLimiter &limiter,
+                                  RateLimiter::LIMIT_TYPE type,
+                                  std::uint64_t limit, const char *func)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_rate_reports);
+    this->rate_reports.emplace(
+        &limiter, RateReport{logger_name, &site, type, limit, func});
+    limiter.set_reporter(this);
+}
+
+void eal::Logger::write_rate_reports(bool force)
+{
+    std::vector<std::shared_ptr<LogMessage>> reports;
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_rate_reports);
+        for (const auto &entry : this->rate_reports) {
+            const RateReport &r = entry.second;
+            std::uint64_t n = entry.first->take_report(r.type, r.limit, force);
+            if (n == 0)
+                continue;
+            std::shared_ptr<LogMessage> m = std::make_shared<LogMessage>(
+                r.site->level,
+                "Rate limit suppressed " + std::to_string(n) + " messages",
+                LogMessage::LOGTYPE::DEFAULT, r.site->file, r.site->line,
+                r.func);
+            if (!r.logger_name.empty())
+                m->set_logger_name(r.logger_name);
+            reports.push_back(std::move(m));
+        }
+    }
+    if (reports.empty())
+        return;
+    FlightRecorder *fr = this->recorder.load(std::memory_order_acquire);
+    for (const auto &m : reports) {
+        if (fr && static_cast<int>(m->get_severity()) >=
+                      static_cast<int>(fr->get_min_lvl()))
+            fr->record(*m);
+    }
+    this->internal_log_batch_routine(reports);
+}
+
+void eal::Logger::sync_rate_reports()
+{
+    std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    std::int64_t due = this->next_rate_report.load(std::memory_order_relaxed);
+    // one thread writes the reports of an interval
+    if (now < due || !this->next_rate_report.compare_exchange_strong(
+                         due, now + tick_interval.count(),
+                         std::memory_order_relaxed))
+        return;
+    this->write_rate_reports(false);
+}
+
+void eal::Logger::push_log_message(std::string msg, con::LOG_LEVEL lvl,
+                                   std::string file, int lnumber,
+                                   std::string func, std::uint32_t weight,
+                                   const std::string &logger_name)
+{
+    FlightRecorder *fr = this->recorder.load(std::memory_order_acquire);
+    bool record = fr && lvl != con::LOG_LEVEL::EAL_INTERNAL &&
+                  static_cast<int>(lvl) >= static_cast<int>(fr->get_min_lvl());
+    // no sink wants the message, it is only recorded. Stack traces and the
+    // internal message that stops the background thread take the usual way
+    if (static_cast<int>(lvl) <
+            this->sink_level.load(std::memory_order_relaxed) &&
+        lvl != con::LOG_LEVEL::EAL_STACK &&
+        lvl != con::LOG_LEVEL::EAL_INTERNAL) {
+        if (record) {
+            LogMessage rm(lvl, std::move(msg), LogMessage::LOGTYPE::DEFAULT,
+                          std::move(file), lnumber, std::move(func));
+            rm.set_sample_weight(weight);
+            if (!logger_name.empty())
+                rm.set_logger_name(logger_name);
+            fr->record(rm);
+        }
+        return;
+    }
+
     std::shared_ptr<LogMessage> m;
     LogMessage::LOGTYPE type = LogMessage::LOGTYPE::DEFAULT;
     if (lvl == con::LOG_LEVEL::EAL_STACK) {
@@ -88,18 +390,29 @@ void eal::Logger::write_log(std::string msg, con::LOG_LEVEL lvl,
                                          std::move(file), lnumber,
                                          std::move(func));
     }
+    m->set_sample_weight(weight);
+    if (!logger_name.empty())
+        m->set_logger_name(logger_name);
+    if (record)
+        fr->record(*m);
     if (this->async) {
-        this->log_msg_queue.push(std::move(m));
+        std::uint64_t position = this->log_msg_queue.push(std::move(m));
+        // group commit, wait for the sync that covers this message. Internal
+        // messages are excluded, the destructor uses one to stop the thread
+        if (static_cast<int>(lvl) >=
+                this->commit_level.load(std::memory_order_relaxed) &&
+            lvl != con::LOG_LEVEL::EAL_INTERNAL) {
+            std::unique_lock<std::mutex> lock(this->mtx_processed);
+            this->cond_processed.wait(lock, [this, position]() {
+                return this->processed >= position;
+            });
+        }
     } else {
         this->internal_log_routine(std::move(m));
+        this->sync_rate_reports();
     }
 }
 
-void eal::Logger::write_log(std::string msg, con::LOG_LEVEL lvl)
-{
-    this->write_log(std::move(msg), lvl, "", 0, "");
-}
-
 void eal::Logger::init_syslog_sink(bool enabled, con::LOG_LEVEL min_lvl,
                                    std::string msg_template,
                                    std::string datetime_pattern)
@@ -113,6 +426,8 @@ void eal::Logger::init_syslog_sink(bool enabled, con::LOG_LEVEL min_lvl,
                                          min_lvl);
     } catch (const std::exception &ex) {
     }
+    this->rebuild_dispatch();
+    this->update_sink_level();
 }
 void eal::Logger::init_console_sink(bool enabled, con::LOG_LEVEL min_lvl,
                                     std::string msg_template,
@@ -127,30 +442,196 @@ void eal::Logger::init_console_sink(bool enabled, con::LOG_LEVEL min_lvl,
                                           min_lvl);
     } catch (const std::exception &ex) {
     }
+    this->rebuild_dispatch();
+    this->update_sink_level();
 }
 void eal::Logger::init_file_sink(bool enabled, con::LOG_LEVEL min_lvl,
                                  std::string msg_template,
                                  std::string datetime_pattern,
                                  std::string logfile, bool flush_buffer)
+{
+    SinkFile::Options options;
+    options.flush_buffer = flush_buffer;
+    this->init_file_sink(enabled, min_lvl, std::move(msg_template),
+                         std::move(datetime_pattern), std::move(logfile),
+                         options);
+}
+
+void eal::Logger::init_file_sink(bool enabled, con::LOG_LEVEL min_lvl,
+                                 std::string msg_template,
+                                 std::string datetime_pattern,
+                                 std::string logfile,
+                                 const SinkFile::Options &options)
 {
     try {
         std::lock_guard<std::mutex> lock(
             *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_SIMPLE].get()));
         this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_SIMPLE] =
-            std::make_shared<SinkFile>(
+            std::make_shared<SinkFile>(std::move(msg_template),
+                                       std::move(datetime_pattern), enabled,
+                                       min_lvl, std::move(logfile), options);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_file_direct_sink(
+    bool enabled, con::LOG_LEVEL min_lvl, std::string msg_template,
+    std::string datetime_pattern, std::string logfile,
+    const SinkFile::Options &options, std::size_t block_size)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_DIRECT].get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_DIRECT] =
+            std::make_shared<SinkFileDirect>(
                 std::move(msg_template), std::move(datetime_pattern), enabled,
-                min_lvl, std::move(logfile), flush_buffer);
+                min_lvl, std::move(logfile), options, block_size);
     } catch (const std::exception &ex) {
     }
+    this->rebuild_dispatch();
+    this->update_sink_level();
 }
 
-// void eal::Logger::init_file_sink_rotating(bool enabled, con::LOG_LEVEL
-// min_lvl,
-// std::string msg_template,
-// std::string datetime_pattern,
-// std::string logfile)
-//{
-//}
+void eal::Logger::init_file_binary_sink(
+    bool enabled, con::LOG_LEVEL min_lvl, std::string msg_template,
+    std::string datetime_pattern, std::string logfile,
+    const SinkFile::Options &options, bool checksums)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_BINARY].get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_BINARY] =
+            std::make_shared<SinkFileBinary>(
+                std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl, std::move(logfile), options, checksums);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_file_gzip_sink(bool enabled, con::LOG_LEVEL min_lvl,
+                                      std::string msg_template,
+                                      std::string datetime_pattern,
+                                      std::string logfile,
+                                      const SinkFile::Options &options,
+                                      int compression_level)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_GZIP].get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_GZIP] =
+            std::make_shared<SinkFileGzip>(
+                std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl, std::move(logfile), options, compression_level);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_file_mmap_sink(bool enabled, con::LOG_LEVEL min_lvl,
+                                      std::string msg_template,
+                                      std::string datetime_pattern,
+                                      std::string logfile,
+                                      std::size_t segment_size)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_MMAP].get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_MMAP] =
+            std::make_shared<SinkFileMmap>(
+                std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl, std::move(logfile), segment_size);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_file_sink_rotating(
+    bool enabled, con::LOG_LEVEL min_lvl, std::string msg_template,
+    std::string datetime_pattern, std::string logfile, std::uint64_t max_size,
+    std::chrono::seconds interval, std::size_t retention,
+    SinkFileRotating::NAMING naming, const SinkFile::Options &options)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_FILE_ROTATING]
+                  .get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_FILE_ROTATING] =
+            std::make_shared<SinkFileRotating>(
+                std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl, std::move(logfile), max_size, interval, retention,
+                naming, options);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_shm_sink(bool enabled, con::LOG_LEVEL min_lvl,
+                                std::string msg_template,
+                                std::string datetime_pattern, std::string name,
+                                std::size_t capacity, ShmRing::FORMAT format)
+{
+    try {
+        std::lock_guard<std::mutex> lock(
+            *(this->logger_mutex_map[con::LOGGER_SINK::EAL_SHM].get()));
+        this->logger_sink_map[con::LOGGER_SINK::EAL_SHM] =
+            std::make_shared<SinkShm>(std::move(msg_template),
+                                      std::move(datetime_pattern), enabled,
+                                      min_lvl, std::move(name), capacity,
+                                      format);
+    } catch (const std::exception &ex) {
+    }
+    this->rebuild_dispatch();
+    this->update_sink_level();
+}
+
+void eal::Logger::init_flight_recorder(std::string path, std::size_t size,
+                                       con::LOG_LEVEL min_lvl,
+                                       std::size_t replay_bytes)
+{
+    std::unique_ptr<FlightRecorder> fr(
+        new FlightRecorder(path, size, min_lvl));
+    bool crashed = fr->previous_crashed();
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_recorder);
+        this->recorder.store(fr->is_valid() ? fr.get() : nullptr,
+                             std::memory_order_release);
+        this->recorders.push_back(std::move(fr));
+    }
+    this->update_sink_level();
+    if (!crashed)
+        return;
+
+    std::string previous = path + FlightRecorder::previous_suffix;
+    this->write_log("ealogger: the previous process did not shut down "
+                    "cleanly, its flight recorder was kept in " +
+                        previous,
+                    con::LOG_LEVEL::EAL_WARNING);
+    if (replay_bytes == 0)
+        return;
+    std::vector<std::shared_ptr<LogMessage>> messages;
+    std::uint64_t skipped = 0;
+    FlightRecorder::recover(previous, messages, skipped, replay_bytes);
+    // the messages keep their time and go to the sinks only
+    for (auto &m : messages) {
+        if (this->async)
+            this->log_msg_queue.push(std::move(m));
+        else
+            this->internal_log_routine(std::move(m));
+    }
+}
+
+void eal::Logger::discard_flight_recorder()
+{
+    this->recorder.store(nullptr, std::memory_order_release);
+    this->update_sink_level();
+}
 
 void eal::Logger::set_msg_template(con::LOGGER_SINK sink,
                                    std::string msg_template)
@@ -182,6 +663,7 @@ void eal::Logger::set_enabled(con::LOGGER_SINK sink, bool enabled)
     } catch (const std::out_of_range &ex) {
         // TODO: What do we do here if the sink does not exist?
     }
+    this->update_sink_level();
 }
 void eal::Logger::set_min_lvl(con::LOGGER_SINK sink, con::LOG_LEVEL min_level)
 {
@@ -191,6 +673,40 @@ void eal::Logger::set_min_lvl(con::LOGGER_SINK sink, con::LOG_LEVEL min_level)
     } catch (const std::out_of_range &ex) {
         // TODO: What do we do here if the sink does not exist?
     }
+    this->update_sink_level();
+}
+
+void eal::Logger::set_collapse_repeated(con::LOGGER_SINK sink, bool collapse,
+                                        std::chrono::milliseconds flush_timeout)
+{
+    try {
+        std::lock_guard<std::mutex> lock(*(this->logger_mutex_map[sink].get()));
+        this->logger_sink_map.at(sink)->set_collapse_repeated(collapse,
+                                                              flush_timeout);
+    } catch (const std::out_of_range &ex) {
+        // TODO: What do we do here if the sink does not exist?
+    }
+}
+
+void eal::Logger::set_backtrace(con::LOGGER_SINK sink, std::size_t size)
+{
+    try {
+        std::lock_guard<std::mutex> lock(*(this->logger_mutex_map[sink].get()));
+        this->logger_sink_map.at(sink)->set_backtrace(size);
+    } catch (const std::out_of_range &ex) {
+        // TODO: What do we do here if the sink does not exist?
+    }
+    this->update_sink_level();
+}
+
+eal::SinkStats eal::Logger::get_sink_stats(con::LOGGER_SINK sink)
+{
+    try {
+        std::lock_guard<std::mutex> lock(*(this->logger_mutex_map[sink].get()));
+        return this->logger_sink_map.at(sink)->get_stats();
+    } catch (const std::out_of_range &ex) {
+        return SinkStats();
+    }
 }
 
 void eal::Logger::discard_sink(con::LOGGER_SINK sink)
@@ -204,6 +720,8 @@ void eal::Logger::discard_sink(con::LOGGER_SINK sink)
     } catch (const std::exception &ex) {
         // TODO: What do we do here if the sink does not exist?
     }
+    this->rebuild_dispatch();
+    this->update_sink_level();
 }
 
 bool eal::Logger::is_initialized(con::LOGGER_SINK sink)
@@ -219,30 +737,222 @@ bool eal::Logger::is_initialized(con::LOGGER_SINK sink)
     return ret;
 }
 
+eal::SinkHandle eal::Logger::add_file_sink(const std::string &name,
+                                           std::string logfile,
+                                           con::LOG_LEVEL min_lvl,
+                                           std::string msg_template,
+                                           std::string datetime_pattern,
+                                           bool flush_buffer)
+{
+    SinkFile::Options options;
+    options.flush_buffer = flush_buffer;
+    return this->add_file_sink(name, std::move(logfile), min_lvl,
+                               std::move(msg_template),
+                               std::move(datetime_pattern), options);
+}
+
+eal::SinkHandle eal::Logger::add_file_sink(const std::string &name,
+                                           std::string logfile,
+                                           con::LOG_LEVEL min_lvl,
+                                           std::string msg_template,
+                                           std::string datetime_pattern,
+                                           const SinkFile::Options &options)
+{
+    return this->add_named_sink(
+        name, std::make_shared<SinkFile>(std::move(msg_template),
+                                         std::move(datetime_pattern), true,
+                                         min_lvl, std::move(logfile), options));
+}
+
+eal::SinkHandle eal::Logger::add_sink(const std::string &name,
+                                      std::shared_ptr<Sink> sink)
+{
+    if (!sink)
+        return SinkHandle();
+    return this->add_named_sink(name, std::move(sink));
+}
+
+eal::SinkHandle eal::Logger::get_sink(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_dispatch);
+    auto it = this->named_sinks.find(name);
+    if (it == this->named_sinks.end())
+        return SinkHandle();
+    return SinkHandle(this, name, it->second.sink, it->second.mtx);
+}
+
+bool eal::Logger::remove_sink(const std::string &name)
+{
+    std::unique_lock<std::mutex> lock(this->mtx_dispatch);
+    auto it = this->named_sinks.find(name);
+    if (it == this->named_sinks.end())
+        return false;
+    SinkSlot slot = it->second;
+    this->named_sinks.erase(it);
+    lock.unlock();
+    this->rebuild_dispatch();
+    this->update_sink_level();
+    // the background thread may still work on an older snapshot, it skips
+    // the slot once it is marked
+    std::lock_guard<std::mutex> sink_lock(*slot.mtx);
+    *slot.removed = true;
+    slot.sink->flush();
+    return true;
+}
+
+eal::SinkHandle eal::Logger::add_named_sink(const std::string &name,
+                                            std::shared_ptr<Sink> sink)
+{
+    std::unique_lock<std::mutex> lock(this->mtx_dispatch);
+    SinkSlot &slot = this->named_sinks[name];
+    // a replaced sink keeps its mutex, it may still be in use
+    if (!slot.mtx)
+        slot.mtx = std::make_shared<std::mutex>();
+    {
+        std::lock_guard<std::mutex> sink_lock(*slot.mtx);
+        if (slot.sink) {
+            *slot.removed = true;
+            slot.sink->flush();
+        }
+        slot.sink = std::move(sink);
+        slot.removed = std::make_shared<bool>(false);
+    }
+    SinkHandle handle(this, name, slot.sink, slot.mtx);
+    lock.unlock();
+    this->rebuild_dispatch();
+    this->update_sink_level();
+    return handle;
+}
+
 bool eal::Logger::queue_empty() { return this->log_msg_queue.empty(); }
 void eal::Logger::logrotate(int signo)
 {
 #ifdef __linux__
-    if (signo == SIGUSR1) {
-        eal::Logger::signal_SIGUSR1 = true;
+    if (signo == SIGUSR1 && signal_pipe[1] >= 0) {
+        int saved_errno = errno;
+        char c = 0;
+        // if the pipe is full a wakeup is pending anyway
+        ssize_t ret = write(signal_pipe[1], &c, 1);
+        (void)ret;
+        errno = saved_errno;
+    }
+#endif
+}
+
+void eal::Logger::signal_watcher()
+{
+#ifdef __linux__
+    char buf[64];
+    while (true) {
+        ssize_t n = read(signal_pipe[0], buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        reopen_generation.fetch_add(1);
+        LoggerRegistry &registry = logger_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        for (eal::Logger *logger : registry.loggers) {
+            if (logger->async) {
+                logger->log_msg_queue.wake();
+            } else {
+                logger->internal_reopen_routine();
+            }
+        }
     }
 #endif
 }
 
 void eal::Logger::thread_entry_point()
 {
+    std::chrono::steady_clock::time_point last_tick =
+        std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<LogMessage>> batch;
+    batch.reserve(eal::Logger::max_batch);
     while (!this->get_logger_thread_stop()) {
-        std::shared_ptr<LogMessage> m = this->log_msg_queue.pop();
-        this->internal_log_routine(std::move(m));
+        std::size_t n = this->log_msg_queue.pop_batch(
+            batch, eal::Logger::max_batch, eal::Logger::tick_interval);
+        if (n > 0) {
+            this->internal_log_batch_routine(batch);
+            batch.clear();
+            std::lock_guard<std::mutex> lock(this->mtx_processed);
+            this->processed += n;
+            this->cond_processed.notify_all();
+        }
+        unsigned int generation = reopen_generation.load();
+        if (generation != this->reopen_seen) {
+            this->reopen_seen = generation;
+            this->internal_reopen_routine();
+        }
+        // sinks get their tick even if the queue never runs empty
+        std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+        if (now - last_tick >= eal::Logger::tick_interval) {
+            this->write_rate_reports(false);
+            this->internal_tick_routine();
+            last_tick = now;
+        }
     }
 }
 
 void eal::Logger::internal_log_routine(std::shared_ptr<LogMessage> m)
 {
-    for (const auto &sink : logger_sink_map) {
-        std::lock_guard<std::mutex> lock(
-            *(this->logger_mutex_map[sink.first].get()));
-        sink.second->prepare_log_message(m);
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> lock(*slot.mtx);
+        if (!slot.active())
+            continue;
+        slot.sink->prepare_log_message(m);
+    }
+}
+
+void eal::Logger::internal_log_batch_routine(
+    const std::vector<std::shared_ptr<LogMessage>> &batch)
+{
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> lock(*slot.mtx);
+        if (!slot.active())
+            continue;
+        slot.sink->prepare_log_batch(batch);
+    }
+}
+
+void eal::Logger::internal_tick_routine()
+{
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> lock(*slot.mtx);
+        if (!slot.active())
+            continue;
+        slot.sink->tick();
+    }
+}
+
+void eal::Logger::internal_flush_routine()
+{
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> lock(*slot.mtx);
+        if (!slot.active())
+            continue;
+        slot.sink->flush();
+    }
+}
+
+void eal::Logger::internal_reopen_routine()
+{
+    std::shared_ptr<const std::vector<SinkSlot>> sinks =
+        std::atomic_load(&this->dispatch);
+    for (const auto &slot : *sinks) {
+        std::lock_guard<std::mutex> lock(*slot.mtx);
+        if (!slot.active())
+            continue;
+        slot.sink->reopen();
     }
 }
 
@@ -258,4 +968,126 @@ void eal::Logger::set_logger_thread_stop(bool stop)
     this->logger_thread_stop = stop;
 }
 
-bool eal::Logger::signal_SIGUSR1 = false;
+const std::chrono::milliseconds eal::Logger::tick_interval =
+    std::chrono::milliseconds(250);
+const std::size_t eal::Logger::max_batch;
+
+eal::SinkHandle::SinkHandle() : logger(nullptr) {}
+eal::SinkHandle::SinkHandle(Logger *logger, std::string name,
+                            std::shared_ptr<Sink> sink,
+                            std::shared_ptr<std::mutex> mtx)
+    : logger(logger),
+      name(std::move(name)),
+      sink(std::move(sink)),
+      mtx(std::move(mtx))
+{
+}
+
+bool eal::SinkHandle::is_valid() const { return this->sink != nullptr; }
+const std::string &eal::SinkHandle::get_name() const { return this->name; }
+void eal::SinkHandle::set_enabled(bool enabled)
+{
+    if (!this->sink)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(*this->mtx);
+        this->sink->set_enabled(enabled);
+    }
+    this->logger->update_sink_level();
+}
+
+void eal::SinkHandle::set_min_lvl(con::LOG_LEVEL min_level)
+{
+    if (!this->sink)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(*this->mtx);
+        this->sink->set_min_lvl(min_level);
+    }
+    this->logger->update_sink_level();
+}
+
+void eal::SinkHandle::set_msg_template(std::string msg_template)
+{
+    if (!this->sink)
+        return;
+    std::lock_guard<std::mutex> lock(*this->mtx);
+    this->sink->set_msg_template(std::move(msg_template));
+}
+
+void eal::SinkHandle::set_datetime_pattern(std::string datetime_pattern)
+{
+    if (!this->sink)
+        return;
+    std::lock_guard<std::mutex> lock(*this->mtx);
+    this->sink->set_datetime_pattern(std::move(datetime_pattern));
+}
+
+void eal::SinkHandle::set_backtrace(std::size_t size)
+{
+    if (!this->sink)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(*this->mtx);
+        this->sink->set_backtrace(size);
+    }
+    this->logger->update_sink_level();
+}
+
+eal::SinkStats eal::SinkHandle::get_stats()
+{
+    if (!this->sink)
+        return SinkStats();
+    std::lock_guard<std::mutex> lock(*this->mtx);
+    return this->sink->get_stats();
+}
+
+eal::ChildLogger::ChildLogger(Logger &root, std::string name,
+                              ChildLogger *parent)
+    : root(root),
+      name(std::move(name)),
+      parent(parent),
+      explicit_level(-1),
+      effective_level(static_cast<int>(con::LOG_LEVEL::EAL_DEBUG))
+{
+}
+
+void eal::ChildLogger::write_log(std::string msg, con::LOG_LEVEL lvl,
+                                 std::string file, int lnumber,
+                                 std::string func)
+{
+    if (!this->is_enabled(lvl))
+        return;
+    this->root.write_log_named(this->name, std::move(msg), lvl,
+                               std::move(file), lnumber, std::move(func));
+}
+
+void eal::ChildLogger::write_log(std::string msg, con::LOG_LEVEL lvl)
+{
+    this->write_log(std::move(msg), lvl, "", 0, "");
+}
+
+eal::ChildLogger &eal::ChildLogger::get(const std::string &name)
+{
+    return this->root.get(this->name + "." + name);
+}
+
+void eal::ChildLogger::set_level(con::LOG_LEVEL lvl)
+{
+    std::lock_guard<std::mutex> lock(this->root.mtx_child_loggers);
+    this->explicit_level = static_cast<int>(lvl);
+    this->root.update_child_levels();
+}
+
+void eal::ChildLogger::reset_level()
+{
+    std::lock_guard<std::mutex> lock(this->root.mtx_child_loggers);
+    this->explicit_level = -1;
+    this->root.update_child_levels();
+}
+
+con::LOG_LEVEL eal::ChildLogger::get_level()
+{
+    return static_cast<con::LOG_LEVEL>(
+        this->effective_level.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,351 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <ealogger/flight_recorder.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include <ealogger/binlog.h>
+#include <ealogger/shm_ring.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+namespace bl = ealogger::binlog;
+namespace sr = ealogger::shm_ring;
+
+/**
+ * @brief Header at the start of the recorder file, in native byte order
+ */
+struct eal::FlightRecorder::Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t clean; /**< 1 after the recorder was closed */
+    std::uint64_t capacity;
+    /** Position behind the last reserved record */
+    alignas(64) std::atomic<std::uint64_t> head;
+};
+
+const std::size_t eal::FlightRecorder::header_size;
+const char *const eal::FlightRecorder::previous_suffix = ".prev";
+
+namespace
+{
+const char magic[8] = {'E', 'A', 'L', 'F', 'L', 'T', '\r', '\n'};
+const std::uint32_t version = 1;
+/** Size, checksum, position and type in front of every record body */
+const std::size_t prefix_size = 17;
+/** Type of a record that fills the end of a lap */
+const std::uint8_t type_padding = 0;
+
+std::uint64_t align_record(std::uint64_t n) { return (n + 7) & ~UINT64_C(7); }
+/**
+ * @brief Checksum of the first \p len bytes of a record without the checksum
+ * field
+ */
+std::uint32_t record_crc(const char *rec, std::size_t len)
+{
+    return eal::crc32c::extend(eal::crc32c::value(rec, 4), rec + 8, len - 8);
+}
+
+/**
+ * @brief Check whether an intact record of position \p pos starts at \p rec
+ *
+ * @param rec
+ * @param tail Bytes up to the end of the ring
+ * @param pos
+ * @param size Set to the size of the record
+ * @param type Set to the type of the record
+ */
+bool check_record(const char *rec, std::uint64_t tail, std::uint64_t pos,
+                  std::uint32_t &size, std::uint8_t &type)
+{
+    size = bl::get<std::uint32_t>(rec);
+    type = bl::get<std::uint8_t>(rec + 16);
+    if (bl::get<std::uint64_t>(rec + 8) != pos || size < prefix_size ||
+        size > tail)
+        return false;
+    // padding has no body, its size is the space it fills
+    std::size_t len = type == type_padding ? prefix_size : size;
+    return record_crc(rec, len) == bl::get<std::uint32_t>(rec + 4);
+}
+
+/**
+ * @brief Decode the records from \p start up to \p head
+ */
+void read_ring(const char *data, std::uint64_t capacity, std::uint64_t start,
+               std::uint64_t head,
+               std::vector<std::shared_ptr<eal::LogMessage>> &messages,
+               std::uint64_t &skipped)
+{
+    // the first record may have been overwritten partially, search for the
+    // first intact one. Everything after that is counted if it is torn
+    bool synced = false;
+    std::uint64_t expected = start;
+    std::uint64_t p = start;
+    while (p < head) {
+        std::uint64_t off = p & (capacity - 1);
+        std::uint64_t tail = capacity - off;
+        if (tail < prefix_size) {
+            // too small for padding, the writer skipped it
+            if (p == expected)
+                expected += tail;
+            p += tail;
+            continue;
+        }
+        std::uint32_t size = 0;
+        std::uint8_t type = 0;
+        if (head - p < prefix_size ||
+            !check_record(data + off, tail, p, size, type)) {
+            p += 8;
+            continue;
+        }
+        if (synced)
+            skipped += p - expected;
+        synced = true;
+        if (type == type_padding) {
+            p += size;
+        } else {
+            std::shared_ptr<eal::LogMessage> m;
+            if (sr::get_message(data + off + prefix_size - 1,
+                                size - prefix_size + 1, m))
+                messages.push_back(std::move(m));
+            else
+                skipped += size;
+            p += align_record(size);
+        }
+        expected = p;
+    }
+    // a record at the end was torn or is still being written
+    if (synced && head > expected)
+        skipped += head - expected;
+}
+}
+
+eal::FlightRecorder::FlightRecorder(std::string path, std::size_t size,
+                                    con::LOG_LEVEL min_lvl)
+    : path(std::move(path)),
+      min_lvl(min_lvl),
+      crashed(false),
+      fd(-1),
+      header(nullptr),
+      data(nullptr),
+      capacity(0)
+{
+#ifndef _WIN32
+    std::uint64_t cap = 64 * 1024;
+    while (cap < size)
+        cap <<= 1;
+    this->keep_previous();
+    if (!this->create(cap) && this->fd >= 0) {
+        close(this->fd);
+        this->fd = -1;
+    }
+#else
+    (void)size;
+#endif
+}
+
+eal::FlightRecorder::~FlightRecorder()
+{
+#ifndef _WIN32
+    if (this->header) {
+        this->header->clean = 1;
+        munmap(this->header, header_size + this->capacity);
+    }
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+}
+
+bool eal::FlightRecorder::is_valid() const { return this->header != nullptr; }
+con::LOG_LEVEL eal::FlightRecorder::get_min_lvl() const
+{
+    return this->min_lvl;
+}
+
+bool eal::FlightRecorder::previous_crashed() const { return this->crashed; }
+void eal::FlightRecorder::record(LogMessage &m)
+{
+    if (!this->header)
+        return;
+    // one encoding buffer per thread, its memory is reused
+    thread_local std::string buf;
+    buf.assign(prefix_size - 1, '\0');
+    buf.push_back(static_cast<char>(sr::RECORD::MESSAGE));
+    sr::put_message(buf, m, 0);
+    std::uint64_t size = buf.size();
+    std::uint64_t need = align_record(size);
+    if (need > this->capacity / 2)
+        return;
+
+    Header *h = this->header;
+    std::uint64_t p = h->head.load(std::memory_order_relaxed);
+    std::uint64_t start = 0;
+    std::uint64_t tail = 0;
+    do {
+        tail = this->capacity - (p & (this->capacity - 1));
+        // records do not wrap around the end of the ring
+        start = need <= tail ? p : p + tail;
+    } while (!h->head.compare_exchange_weak(p, start + need,
+                                            std::memory_order_relaxed));
+    if (start != p && tail >= prefix_size) {
+        char pad[prefix_size];
+        bl::set<std::uint32_t>(pad, static_cast<std::uint32_t>(tail));
+        bl::set<std::uint64_t>(pad + 8, p);
+        pad[16] = static_cast<char>(type_padding);
+        bl::set<std::uint32_t>(pad + 4, record_crc(pad, prefix_size));
+        std::memcpy(this->data + (p & (this->capacity - 1)), pad,
+                    prefix_size);
+    }
+    char *b = &buf[0];
+    bl::set<std::uint32_t>(b, static_cast<std::uint32_t>(size));
+    bl::set<std::uint64_t>(b + 8, start);
+    // the position is the sequence number of the message
+    bl::set<std::uint64_t>(b + prefix_size + 8, start);
+    bl::set<std::uint32_t>(b + 4, record_crc(b, size));
+    std::memcpy(this->data + (start & (this->capacity - 1)), b, size);
+}
+
+bool eal::FlightRecorder::recover(
+    const std::string &path, std::vector<std::shared_ptr<LogMessage>> &messages,
+    std::uint64_t &skipped, std::uint64_t max_bytes)
+{
+    skipped = 0;
+#ifndef _WIN32
+    int f = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f < 0)
+        return false;
+    struct stat st;
+    std::uint64_t len = 0;
+    void *map = MAP_FAILED;
+    if (fstat(f, &st) == 0 &&
+        static_cast<std::uint64_t>(st.st_size) > header_size) {
+        len = static_cast<std::uint64_t>(st.st_size);
+        map = mmap(nullptr, len, PROT_READ, MAP_SHARED, f, 0);
+    }
+    close(f);
+    if (map == MAP_FAILED)
+        return false;
+
+    const Header *h = static_cast<const Header *>(map);
+    std::uint64_t cap = len - header_size;
+    bool valid = std::memcmp(h->magic, magic, sizeof(magic)) == 0 &&
+                 h->version == version && h->capacity == cap &&
+                 (cap & (cap - 1)) == 0;
+    if (valid) {
+        std::uint64_t head = h->head.load(std::memory_order_acquire);
+        std::uint64_t start = head > cap ? head - cap : 0;
+        if (max_bytes > 0 && head - start > max_bytes)
+            start = align_record(head - max_bytes);
+        read_ring(static_cast<const char *>(map) + header_size, cap, start,
+                  head, messages, skipped);
+    }
+    munmap(map, len);
+    return valid;
+#else
+    (void)path;
+    (void)messages;
+    (void)max_bytes;
+    return false;
+#endif
+}
+
+void eal::FlightRecorder::keep_previous()
+{
+#ifndef _WIN32
+    int f = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f < 0)
+        return;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(f, &st) == 0 &&
+        static_cast<std::uint64_t>(st.st_size) >= header_size)
+        map = mmap(nullptr, header_size, PROT_READ, MAP_SHARED, f, 0);
+    close(f);
+    if (map == MAP_FAILED)
+        return;
+    const Header *h = static_cast<const Header *>(map);
+    if (std::memcmp(h->magic, magic, sizeof(magic)) == 0 &&
+        h->head.load(std::memory_order_relaxed) > 0) {
+        this->crashed = h->clean == 0;
+        std::rename(this->path.c_str(),
+                    (this->path + previous_suffix).c_str());
+    }
+    munmap(map, header_size);
+#endif
+}
+
+bool eal::FlightRecorder::create(std::uint64_t size)
+{
+#ifndef _WIN32
+    static_assert(sizeof(Header) <= header_size,
+                  "the recorder header has to fit into the first page");
+    // never overwrite a file that is no recorder file
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    this->fd = open(this->path.c_str(), flags | O_EXCL, 0644);
+    if (this->fd < 0) {
+        this->fd = open(this->path.c_str(), flags, 0644);
+        char buf[sizeof(magic)];
+        if (this->fd < 0 ||
+            (pread(this->fd, buf, sizeof(buf), 0) > 0 &&
+             std::memcmp(buf, magic, sizeof(magic)) != 0))
+            return false;
+    }
+    std::uint64_t len = header_size + size;
+    if (ftruncate(this->fd, 0) != 0 ||
+        ftruncate(this->fd, static_cast<off_t>(len)) != 0)
+        return false;
+#ifdef __linux__
+    // allocate the blocks now instead of on the first lap. Without them a
+    // full disk kills the process with SIGBUS when a record is written.
+    int err = posix_fallocate(this->fd, 0, static_cast<off_t>(len));
+    if (err != 0 && err != EOPNOTSUPP && err != EINVAL)
+        return false;
+#endif
+    int map_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    map_flags |= MAP_POPULATE;
+#endif
+    void *p =
+        mmap(nullptr, len, PROT_READ | PROT_WRITE, map_flags, this->fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    // the file is filled with zeros
+    Header *h = new (p) Header;
+    h->version = version;
+    h->clean = 0;
+    h->capacity = size;
+    h->head.store(0, std::memory_order_relaxed);
+    std::memcpy(h->magic, magic, sizeof(magic));
+    this->header = h;
+    this->data = static_cast<char *>(p) + header_size;
+    this->capacity = size;
+    return true;
+#else
+    (void)size;
+    return false;
+#endif
+}
@@ -0,0 +1,186 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/log_index.h>
+
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <fstream>
+#include <io.h>
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+namespace bl = ealogger::binlog;
+
+namespace
+{
+std::int64_t to_ns(std::chrono::system_clock::time_point tp)
+{
+    // min and max would overflow if the clock is not counting nanoseconds
+    if (tp == std::chrono::system_clock::time_point::min())
+        return std::numeric_limits<std::int64_t>::min();
+    if (tp == std::chrono::system_clock::time_point::max())
+        return std::numeric_limits<std::int64_t>::max();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               tp.time_since_epoch())
+        .count();
+}
+}
+
+const char eal::LogIndex::magic[8] = {'E', 'A', 'L', 'I', 'D', 'X', '\r', '\n'};
+const char *const eal::LogIndex::suffix = ".idx";
+const std::uint32_t eal::LogIndex::version;
+const std::size_t eal::LogIndex::header_size;
+const std::size_t eal::LogIndex::entry_size;
+
+void eal::LogIndex::put_header(std::string &out, std::uint32_t block_size)
+{
+    out.append(magic, sizeof(magic));
+    bl::put<std::uint32_t>(out, version);
+    bl::put<std::uint32_t>(out, block_size);
+}
+
+void eal::LogIndex::put_entry(std::string &out, const Entry &entry)
+{
+    bl::put<std::uint64_t>(out, entry.offset);
+    bl::put<std::int64_t>(out, entry.first_ns);
+    bl::put<std::int64_t>(out, entry.last_ns);
+    bl::put<std::uint32_t>(out, entry.bytes);
+    bl::put<std::uint32_t>(out, entry.messages);
+    bl::put<std::uint32_t>(out, entry.levels);
+    bl::put<std::uint32_t>(out, 0);
+}
+
+eal::LogIndex::LogIndex(const std::string &log_file)
+    : fd(-1), data(nullptr), len(0), entries(0), valid(false)
+{
+    std::string path = log_file + suffix;
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return;
+    this->contents.assign(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+    this->data = this->contents.data();
+    this->len = this->contents.size();
+#else
+    this->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (this->fd < 0 || fstat(this->fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < header_size)
+        return;
+    void *p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ,
+                   MAP_SHARED, this->fd, 0);
+    if (p == MAP_FAILED)
+        return;
+    // the binary search jumps around, do not read ahead
+    madvise(p, static_cast<std::size_t>(st.st_size), MADV_RANDOM);
+    this->data = static_cast<const char *>(p);
+    this->len = static_cast<std::size_t>(st.st_size);
+#endif
+    this->valid = this->len >= header_size &&
+                  std::memcmp(this->data, magic, sizeof(magic)) == 0 &&
+                  bl::get<std::uint32_t>(this->data + sizeof(magic)) == version;
+    if (this->valid)
+        this->entries = (this->len - header_size) / entry_size;
+}
+
+eal::LogIndex::~LogIndex()
+{
+#ifdef _WIN32
+    (void)this->fd;
+#else
+    if (this->data)
+        munmap(const_cast<char *>(this->data), this->len);
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+}
+
+bool eal::LogIndex::is_valid() const { return this->valid; }
+std::size_t eal::LogIndex::size() const { return this->entries; }
+eal::LogIndex::Entry eal::LogIndex::get(std::size_t i) const
+{
+    const char *p = this->data + header_size + i * entry_size;
+    Entry e;
+    e.offset = bl::get<std::uint64_t>(p);
+    e.first_ns = bl::get<std::int64_t>(p + 8);
+    e.last_ns = bl::get<std::int64_t>(p + 16);
+    e.bytes = bl::get<std::uint32_t>(p + 24);
+    e.messages = bl::get<std::uint32_t>(p + 28);
+    e.levels = bl::get<std::uint32_t>(p + 32);
+    return e;
+}
+
+std::vector<eal::LogIndex::Range> eal::LogIndex::query(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to, con::LOG_LEVEL min_lvl) const
+{
+    const std::uint64_t open_end = std::numeric_limits<std::uint64_t>::max();
+    std::vector<Range> ranges;
+    if (!this->valid) {
+        ranges.push_back({0, open_end});
+        return ranges;
+    }
+    std::int64_t from_ns = to_ns(from);
+    std::int64_t to_ns_ = to_ns(to);
+    std::uint32_t mask = ~((1u << static_cast<int>(min_lvl)) - 1);
+
+    // first block whose messages may reach from, last_ns never decreases
+    std::size_t lo = 0;
+    std::size_t hi = this->entries;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (this->get(mid).last_ns < from_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    auto add = [&ranges](std::uint64_t begin, std::uint64_t end) {
+        if (!ranges.empty() && ranges.back().end == begin) {
+            ranges.back().end = end;
+        } else {
+            ranges.push_back({begin, end});
+        }
+    };
+    std::uint64_t prev_end = 0;
+    if (lo > 0) {
+        Entry prev = this->get(lo - 1);
+        prev_end = prev.offset + prev.bytes;
+    }
+    for (std::size_t i = lo; i < this->entries; i++) {
+        Entry e = this->get(i);
+        // data without an entry, e.g. the last block of a crashed process
+        if (e.offset > prev_end)
+            add(prev_end, e.offset);
+        prev_end = e.offset + e.bytes;
+        if (e.first_ns >= to_ns_)
+            return ranges;
+        if (e.messages > 0 && (e.levels & mask) != 0)
+            add(e.offset, prev_end);
+    }
+    // the block that is currently written is not in the index yet
+    add(prev_end, open_end);
+    return ranges;
+}
@@ -17,14 +17,15 @@
 
 namespace eal = ealogger;
 
-eal::LogQueue::LogQueue() {}
-void eal::LogQueue::push(std::shared_ptr<eal::LogMessage> m)
+eal::LogQueue::LogQueue() : woken(false), pushed(0) {}
+std::uint64_t eal::LogQueue::push(std::shared_ptr<eal::LogMessage> m)
 {
     // acquire the lock on the mutex and push a message object in the queue
     std::lock_guard<std::mutex> lock(this->mtx);
     this->msg_queue.push(std::move(m));
     // notify logger thread to wake up and pop latest message
     this->cond_var_queue.notify_one();
+    return ++this->pushed;
 }
 
 std::shared_ptr<eal::LogMessage> eal::LogQueue::pop()
@@ -43,6 +44,35 @@ std::shared_ptr<eal::LogMessage> eal::LogQueue::pop()
     return lmessage;
 }
 
+std::size_t eal::LogQueue::pop_batch(
+    std::vector<std::shared_ptr<eal::LogMessage>> &batch, std::size_t max,
+    std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(this->mtx);
+
+    if (!this->cond_var_queue.wait_for(lock, timeout, [this]() {
+            return !this->msg_queue.empty() || this->woken;
+        })) {
+        return 0;
+    }
+    this->woken = false;
+
+    std::size_t n = 0;
+    while (n < max && !this->msg_queue.empty()) {
+        batch.push_back(std::move(this->msg_queue.front()));
+        this->msg_queue.pop();
+        n++;
+    }
+    return n;
+}
+
+void eal::LogQueue::wake()
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->woken = true;
+    this->cond_var_queue.notify_one();
+}
+
 bool eal::LogQueue::empty()
 {
     std::lock_guard<std::mutex> lock(this->mtx);
@@ -0,0 +1,63 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <ealogger/ratelimit.h>
+
+namespace eal = ealogger;
+
+const std::int64_t eal::RateLimiter::report_interval_ms;
+
+std::uint64_t eal::RateLimiter::get_suppressed(LIMIT_TYPE type,
+                                               std::uint64_t limit) const
+{
+    std::uint64_t h = this->hits.load(std::memory_order_relaxed);
+    switch (type) {
+    case LIMIT_TYPE::EVERY_N:
+        if (limit <= 1)
+            return 0;
+        // messages 0, n, 2n ... have passed
+        return h - (h + limit - 1) / limit;
+    case LIMIT_TYPE::FIRST_N:
+        return h > limit ? h - limit : 0;
+    case LIMIT_TYPE::PER_SECOND: {
+        std::uint64_t wh = this->window_hits.load(std::memory_order_relaxed);
+        return this->window_suppressed.load(std::memory_order_relaxed) +
+               (wh > limit ? wh - limit : 0);
+    }
+    }
+    return 0;
+}
+
+std::uint64_t eal::RateLimiter::take_report(LIMIT_TYPE type, std::uint64_t limit,
+                                            bool force)
+{
+    std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    std::int64_t last = this->last_report.load(std::memory_order_relaxed);
+    if (!force && now - last < report_interval_ms)
+        return 0;
+
+    std::uint64_t total = this->get_suppressed(type, limit);
+    if (total <= this->reported.load(std::memory_order_relaxed))
+        return 0;
+    // only one thread gets to write the report for this interval
+    if (!this->last_report.compare_exchange_strong(last, now,
+                                                   std::memory_order_relaxed))
+        return 0;
+
+    std::uint64_t prev = this->reported.exchange(total, std::memory_order_relaxed);
+    return total > prev ? total - prev : 0;
+}
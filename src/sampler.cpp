@@ -0,0 +1,40 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <functional>
+#include <thread>
+
+#include <ealogger/sampler.h>
+
+namespace eal = ealogger;
+
+const std::uint64_t eal::Sampler::threshold_all;
+
+std::uint64_t eal::Sampler::random()
+{
+    // xorshift64*, seeded once per thread
+    static thread_local std::uint64_t state = 0;
+    if (state == 0) {
+        state = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                static_cast<std::uint64_t>(
+                    std::chrono::steady_clock::now().time_since_epoch().count());
+        if (state == 0)
+            state = 0x9E3779B97F4A7C15ULL;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (state * 0x2545F4914F6CDD1DULL) >> 32;
+}
@@ -0,0 +1,59 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <ealogger/shm_reader.h>
+
+namespace eal = ealogger;
+namespace sr = ealogger::shm_ring;
+
+eal::ShmReader::ShmReader(std::string name)
+    : name(std::move(name)), ring(new ShmRing(this->name)), skipped(0)
+{
+}
+
+bool eal::ShmReader::is_valid() const { return this->ring->is_valid(); }
+bool eal::ShmReader::refresh()
+{
+    if (this->ring->is_valid() &&
+        (this->ring->get_pending() > 0 || !this->ring->is_replaced()))
+        return false;
+    std::unique_ptr<ShmRing> attached(new ShmRing(this->name));
+    if (!attached->is_valid())
+        return false;
+    this->ring = std::move(attached);
+    return true;
+}
+
+bool eal::ShmReader::next(std::shared_ptr<LogMessage> &m)
+{
+    while (this->ring->read(this->record)) {
+        if (sr::get_message(this->record.data(), this->record.size(), m))
+            return true;
+        this->skipped++;
+    }
+    return false;
+}
+
+eal::ShmRing::FORMAT eal::ShmReader::get_format() const
+{
+    return this->ring->get_format();
+}
+
+std::uint64_t eal::ShmReader::get_dropped() const
+{
+    return this->ring->get_dropped();
+}
+
+std::uint64_t eal::ShmReader::get_skipped() const { return this->skipped; }
@@ -0,0 +1,398 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <ealogger/shm_ring.h>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include <ealogger/binlog.h>
+
+#include "config.h"
+
+#ifdef EALOGGER_SHM
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+namespace bl = ealogger::binlog;
+namespace sr = ealogger::shm_ring;
+
+/**
+ * @brief Header at the start of the shared memory object
+ * @details
+ * The atomics have to be lock free to work across processes, which they are
+ * on every platform with shm_open.
+ */
+struct eal::ShmRing::Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint64_t capacity;
+    // producer and consumer write to different cache lines
+    alignas(64) std::atomic<std::uint64_t> write_pos;
+    alignas(64) std::atomic<std::uint64_t> read_pos;
+    alignas(64) std::atomic<std::uint64_t> dropped;
+};
+
+namespace
+{
+std::uint64_t align_record(std::uint64_t n) { return (n + 7) & ~UINT64_C(7); }
+}
+
+void sr::put_message(std::string &out, LogMessage &m, std::uint64_t sequence)
+{
+    bl::put<std::int64_t>(
+        out, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 m.get_time().time_since_epoch())
+                 .count());
+    bl::put<std::uint64_t>(out, sequence);
+    bl::put<std::uint64_t>(out, m.get_thread_id());
+    bl::put<std::int32_t>(out, m.get_call_file_line());
+    bl::put<std::uint32_t>(out, m.get_sample_weight());
+    bl::put<std::uint8_t>(out, static_cast<std::uint8_t>(m.get_severity()));
+    bl::put<std::uint8_t>(out, static_cast<std::uint8_t>(m.get_log_type()));
+    bl::put<std::uint32_t>(
+        out, static_cast<std::uint32_t>(m.get_call_file().size()));
+    bl::put<std::uint32_t>(
+        out, static_cast<std::uint32_t>(m.get_call_func().size()));
+    bl::put<std::uint32_t>(
+        out, static_cast<std::uint32_t>(m.get_logger_name().size()));
+    out.append(m.get_call_file());
+    out.append(m.get_call_func());
+    out.append(m.get_logger_name());
+    if (m.get_log_type() == LogMessage::LOGTYPE::STACK) {
+        for (LogMessage::msg_vec_it it = m.get_msg_vec_begin();
+             it != m.get_msg_vec_end(); it++) {
+            bl::put<std::uint32_t>(out, static_cast<std::uint32_t>(it->size()));
+            out.append(*it);
+        }
+    } else {
+        out.append(m.get_message());
+    }
+}
+
+bool sr::get_message(const char *rec, std::size_t len,
+                     std::shared_ptr<LogMessage> &m)
+{
+    if (len < 2)
+        return false;
+    RECORD type = static_cast<RECORD>(rec[0]);
+    const char *body = rec + 1;
+    len--;
+    if (type == RECORD::LINE) {
+        std::uint8_t lvl = bl::get<std::uint8_t>(body);
+        if (lvl >= con::LOG_LEVEL_COUNT)
+            return false;
+        m = std::make_shared<LogMessage>(
+            static_cast<con::LOG_LEVEL>(lvl), std::string(body + 1, len - 1),
+            LogMessage::LOGTYPE::DEFAULT, "", 0, "");
+        return true;
+    }
+    if (type != RECORD::MESSAGE || len < message_header_size)
+        return false;
+
+    std::uint8_t lvl = bl::get<std::uint8_t>(body + 32);
+    std::uint8_t log_type = bl::get<std::uint8_t>(body + 33);
+    std::uint64_t flen = bl::get<std::uint32_t>(body + 34);
+    std::uint64_t fnlen = bl::get<std::uint32_t>(body + 38);
+    std::uint64_t llen = bl::get<std::uint32_t>(body + 42);
+    if (lvl >= con::LOG_LEVEL_COUNT ||
+        flen + fnlen + llen > len - message_header_size)
+        return false;
+    const char *strings = body + message_header_size;
+    std::string file(strings, flen);
+    std::string func(strings + flen, fnlen);
+    const char *payload = strings + flen + fnlen + llen;
+    std::size_t payload_len =
+        len - message_header_size - static_cast<std::size_t>(flen + fnlen +
+                                                             llen);
+    int line = bl::get<std::int32_t>(body + 24);
+    if (log_type == LogMessage::LOGTYPE::STACK) {
+        std::vector<std::string> elements;
+        std::size_t p = 0;
+        while (payload_len - p >= 4) {
+            std::uint32_t elen = bl::get<std::uint32_t>(payload + p);
+            if (elen > payload_len - p - 4)
+                break;
+            elements.emplace_back(payload + p + 4, elen);
+            p += 4 + elen;
+        }
+        m = std::make_shared<LogMessage>(
+            static_cast<con::LOG_LEVEL>(lvl), std::move(elements),
+            LogMessage::LOGTYPE::STACK, std::move(file), line,
+            std::move(func));
+    } else {
+        m = std::make_shared<LogMessage>(
+            static_cast<con::LOG_LEVEL>(lvl),
+            std::string(payload, payload_len), LogMessage::LOGTYPE::DEFAULT,
+            std::move(file), line, std::move(func));
+    }
+    m->set_time(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(bl::get<std::int64_t>(body)))));
+    m->set_thread_id(bl::get<std::uint64_t>(body + 16));
+    m->set_sample_weight(bl::get<std::uint32_t>(body + 28));
+    if (llen > 0)
+        m->set_logger_name(std::string(strings + flen + fnlen, llen));
+    return true;
+}
+
+eal::ShmRing::ShmRing(std::string name, std::size_t capacity, FORMAT format)
+    : name(std::move(name)),
+      fd(-1),
+      dev(0),
+      ino(0),
+      header(nullptr),
+      data(nullptr),
+      capacity(0)
+{
+#ifdef EALOGGER_SHM
+    std::uint64_t size = 4096;
+    while (size < capacity)
+        size <<= 1;
+    this->fd = shm_open(this->name.c_str(), O_RDWR, 0);
+    if (this->fd >= 0) {
+        // keep the records of a ring with the same settings
+        if (this->map() && this->capacity == size &&
+            this->header->format == static_cast<std::uint32_t>(format))
+            return;
+        this->unmap();
+        shm_unlink(this->name.c_str());
+    }
+    if (!this->create(size, format))
+        this->unmap();
+#else
+    (void)capacity;
+    (void)format;
+#endif
+}
+
+eal::ShmRing::ShmRing(std::string name)
+    : name(std::move(name)),
+      fd(-1),
+      dev(0),
+      ino(0),
+      header(nullptr),
+      data(nullptr),
+      capacity(0)
+{
+#ifdef EALOGGER_SHM
+    this->fd = shm_open(this->name.c_str(), O_RDWR, 0);
+    if (this->fd >= 0 && !this->map())
+        this->unmap();
+#endif
+}
+
+eal::ShmRing::~ShmRing() { this->unmap(); }
+bool eal::ShmRing::is_valid() const { return this->header != nullptr; }
+bool eal::ShmRing::is_replaced() const
+{
+#ifdef EALOGGER_SHM
+    int f = shm_open(this->name.c_str(), O_RDONLY, 0);
+    if (f < 0)
+        return true;
+    struct stat st;
+    bool replaced = fstat(f, &st) != 0 ||
+                    static_cast<std::uint64_t>(st.st_dev) != this->dev ||
+                    static_cast<std::uint64_t>(st.st_ino) != this->ino;
+    close(f);
+    return replaced;
+#else
+    return true;
+#endif
+}
+
+eal::ShmRing::FORMAT eal::ShmRing::get_format() const
+{
+    return this->header ? static_cast<FORMAT>(this->header->format)
+                        : FORMAT::LINES;
+}
+
+std::uint64_t eal::ShmRing::get_capacity() const { return this->capacity; }
+std::uint64_t eal::ShmRing::get_dropped() const
+{
+    return this->header ? this->header->dropped.load(std::memory_order_relaxed)
+                        : 0;
+}
+
+std::uint64_t eal::ShmRing::get_pending() const
+{
+    if (!this->header)
+        return 0;
+    return this->header->write_pos.load(std::memory_order_acquire) -
+           this->header->read_pos.load(std::memory_order_relaxed);
+}
+
+bool eal::ShmRing::write(sr::RECORD type, const char *body, std::size_t len)
+{
+    if (!this->header)
+        return false;
+    Header *h = this->header;
+    std::uint64_t need = align_record(4 + 1 + len);
+    std::uint64_t w = h->write_pos.load(std::memory_order_relaxed);
+    std::uint64_t r = h->read_pos.load(std::memory_order_acquire);
+    std::uint64_t off = w & (this->capacity - 1);
+    std::uint64_t tail = this->capacity - off;
+    // a record does not wrap around, the rest of the data area is skipped
+    std::uint64_t total = need <= tail ? need : tail + need;
+    // a damaged read position counts as a full ring
+    if (r > w || w - r > this->capacity || this->capacity - (w - r) < total) {
+        h->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (need > tail) {
+        bl::set<std::uint32_t>(this->data + off, sr::wrap_marker);
+        w += tail;
+        off = 0;
+    }
+    char *p = this->data + off;
+    bl::set<std::uint32_t>(p, static_cast<std::uint32_t>(1 + len));
+    p[4] = static_cast<char>(type);
+    std::memcpy(p + 5, body, len);
+    // publish the record after it was copied completely
+    h->write_pos.store(w + need, std::memory_order_release);
+    return true;
+}
+
+bool eal::ShmRing::read(std::string &rec)
+{
+    if (!this->header)
+        return false;
+    Header *h = this->header;
+    std::uint64_t r = h->read_pos.load(std::memory_order_relaxed);
+    std::uint64_t w = h->write_pos.load(std::memory_order_acquire);
+    bool found = false;
+    while (r != w) {
+        std::uint64_t off = r & (this->capacity - 1);
+        std::uint64_t tail = this->capacity - off;
+        if (w - r > this->capacity) {
+            r = w;
+            break;
+        }
+        std::uint32_t size = bl::get<std::uint32_t>(this->data + off);
+        if (size == sr::wrap_marker) {
+            r += tail;
+            continue;
+        }
+        if (size == 0 || size > tail - 4 || align_record(4 + size) > w - r) {
+            // the ring is damaged, skip everything written so far
+            r = w;
+            break;
+        }
+        rec.assign(this->data + off + 4, size);
+        r += align_record(4 + size);
+        found = true;
+        break;
+    }
+    // the producer may reuse the space once the record is copied
+    h->read_pos.store(r, std::memory_order_release);
+    return found;
+}
+
+bool eal::ShmRing::remove(const std::string &name)
+{
+#ifdef EALOGGER_SHM
+    return shm_unlink(name.c_str()) == 0;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+bool eal::ShmRing::map()
+{
+#ifdef EALOGGER_SHM
+    struct stat st;
+    if (fstat(this->fd, &st) != 0 ||
+        static_cast<std::uint64_t>(st.st_size) <= sr::header_size)
+        return false;
+    std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   this->fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    this->header = static_cast<Header *>(p);
+    this->data = static_cast<char *>(p) + sr::header_size;
+    this->capacity = size - sr::header_size;
+    this->dev = static_cast<std::uint64_t>(st.st_dev);
+    this->ino = static_cast<std::uint64_t>(st.st_ino);
+    // a producer that is still creating the ring writes the magic last
+    const Header *h = this->header;
+    return std::memcmp(h->magic, sr::magic, sizeof(sr::magic)) == 0 &&
+           h->version == sr::version && h->capacity == this->capacity &&
+           (this->capacity & (this->capacity - 1)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool eal::ShmRing::create(std::uint64_t size, FORMAT format)
+{
+    static_assert(sizeof(Header) <= sr::header_size,
+                  "the ring header has to fit into the first page");
+#ifdef EALOGGER_SHM
+    this->fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (this->fd < 0 ||
+        ftruncate(this->fd, static_cast<off_t>(sr::header_size + size)) != 0)
+        return false;
+    void *p = mmap(nullptr, sr::header_size + size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, this->fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    struct stat st;
+    if (fstat(this->fd, &st) == 0) {
+        this->dev = static_cast<std::uint64_t>(st.st_dev);
+        this->ino = static_cast<std::uint64_t>(st.st_ino);
+    }
+    // the new object is filled with zeros
+    Header *h = new (p) Header;
+    h->version = sr::version;
+    h->format = static_cast<std::uint32_t>(format);
+    h->capacity = size;
+    h->write_pos.store(0, std::memory_order_relaxed);
+    h->read_pos.store(0, std::memory_order_relaxed);
+    h->dropped.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(h->magic, sr::magic, sizeof(sr::magic));
+    this->header = h;
+    this->data = static_cast<char *>(p) + sr::header_size;
+    this->capacity = size;
+    return true;
+#else
+    (void)size;
+    (void)format;
+    return false;
+#endif
+}
+
+void eal::ShmRing::unmap()
+{
+#ifdef EALOGGER_SHM
+    if (this->header)
+        munmap(this->header, sr::header_size + this->capacity);
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+    this->header = nullptr;
+    this->data = nullptr;
+    this->capacity = 0;
+    this->fd = -1;
+}
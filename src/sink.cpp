@@ -22,8 +22,15 @@ eal::Sink::Sink(std::string msg_template, std::string datetime_pattern,
                 bool enabled, con::LOG_LEVEL min_lvl)
     : msg_template(std::move(msg_template)),
       datetime_pattern(std::move(datetime_pattern)),
+      datetime_cache_time(-1),
       enabled(enabled),
-      min_level(min_lvl)
+      min_level(min_lvl),
+      collapse_repeated(false),
+      collapse_timeout(std::chrono::milliseconds(30000)),
+      repeat_count(0),
+      backtrace_next(0),
+      backtrace_count(0),
+      batch_active(false)
 {
     this->fill_conv_patterns(true);
     this->loglevel_lookup = {{con::LOG_LEVEL::EAL_DEBUG, "DEBUG"},
@@ -35,6 +42,25 @@ eal::Sink::Sink(std::string msg_template, std::string datetime_pattern,
                              {con::LOG_LEVEL::EAL_INTERNAL, "INTERNAL"}};
 }
 eal::Sink::~Sink() {}
+
+namespace
+{
+/**
+ * @brief Check if two messages are repetitions of each other
+ */
+bool is_repeat(eal::LogMessage &previous, eal::LogMessage &current)
+{
+    // cheap comparisons first
+    return previous.get_call_file_line() == current.get_call_file_line() &&
+           previous.get_severity() == current.get_severity() &&
+           current.get_log_type() == eal::LogMessage::LOGTYPE::DEFAULT &&
+           previous.get_log_type() == eal::LogMessage::LOGTYPE::DEFAULT &&
+           previous.get_message() == current.get_message() &&
+           previous.get_call_file() == current.get_call_file() &&
+           previous.get_call_func() == current.get_call_func();
+}
+}
+
 void eal::Sink::set_msg_template(std::string msg_template)
 {
     std::lock_guard<std::mutex> lock(this->mtx_msg_template);
@@ -46,6 +72,7 @@ void eal::Sink::set_datetime_pattern(std::string datetime_pattern)
 {
     std::lock_guard<std::mutex> lock(this->mtx_datetime_pattern);
     this->datetime_pattern = std::move(datetime_pattern);
+    this->datetime_cache_time = -1;
 }
 
 void eal::Sink::set_enabled(bool enabled)
@@ -66,9 +93,27 @@ void eal::Sink::set_min_lvl(con::LOG_LEVEL min_lvl)
     this->min_level = min_lvl;
 }
 
+con::LOG_LEVEL eal::Sink::get_lowest_lvl()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_backtrace);
+        if (!this->backtrace_ring.empty())
+            return con::LOG_LEVEL::EAL_DEBUG;
+    }
+    std::lock_guard<std::mutex> lock(this->mtx_min_lvl);
+    return this->min_level;
+}
+
 void eal::Sink::prepare_log_message(
     const std::shared_ptr<LogMessage> &log_message)
 {
+    if (this->wants_log_messages()) {
+        if (this->accept_log_message(log_message) && !this->drop_message()) {
+            this->write_log_messages(
+                std::vector<std::shared_ptr<LogMessage>>(1, log_message));
+        }
+        return;
+    }
     // TODO: Is it a good idea to check whether this Sink is enabled here or
     // should we check in Logger?
     if (!this->get_enabled())
@@ -78,8 +123,19 @@ void eal::Sink::prepare_log_message(
 
     std::unique_lock<std::mutex> min_level_lock(this->mtx_min_lvl);
     if (msg_lvl < this->min_level &&
-        log_message->get_log_type() == LogMessage::LOGTYPE::DEFAULT)
+        log_message->get_log_type() == LogMessage::LOGTYPE::DEFAULT) {
+        min_level_lock.unlock();
+        // keep the message for a later error, it is rendered only then
+        std::lock_guard<std::mutex> lock(this->mtx_backtrace);
+        if (!this->backtrace_ring.empty()) {
+            this->backtrace_ring[this->backtrace_next] = log_message;
+            this->backtrace_next =
+                (this->backtrace_next + 1) % this->backtrace_ring.size();
+            if (this->backtrace_count < this->backtrace_ring.size())
+                this->backtrace_count++;
+        }
         return;
+    }
     min_level_lock.unlock();
 
 #ifndef EALOGGER_PRINT_INTERNAL
@@ -89,6 +145,118 @@ void eal::Sink::prepare_log_message(
     }
 #endif
 
+    if (this->drop_message())
+        return;
+
+    std::unique_lock<std::mutex> collapse_lock(this->mtx_collapse);
+    if ((msg_lvl == con::LOG_LEVEL::EAL_ERROR ||
+         msg_lvl == con::LOG_LEVEL::EAL_FATAL) &&
+        this->write_backtrace()) {
+        // the error follows its context and must not be collapsed
+        this->last_message.reset();
+    }
+    if (this->collapse_repeated) {
+        if (this->last_message && is_repeat(*this->last_message, *log_message)) {
+            std::chrono::steady_clock::time_point now =
+                std::chrono::steady_clock::now();
+            if (this->repeat_count == 0)
+                this->repeat_since = now;
+            this->repeat_count++;
+            if (now - this->repeat_since >= this->collapse_timeout)
+                this->write_repeat_count();
+            return;
+        }
+        this->write_repeat_count();
+        this->last_message = log_message;
+    }
+    collapse_lock.unlock();
+
+    // here the sinks have to write the message
+    this->emit_message(log_message);
+}
+
+void eal::Sink::prepare_log_batch(
+    const std::vector<std::shared_ptr<LogMessage>> &batch)
+{
+    if (this->wants_log_messages()) {
+        std::vector<std::shared_ptr<LogMessage>> accepted;
+        accepted.reserve(batch.size());
+        for (const auto &m : batch) {
+            if (this->accept_log_message(m) && !this->drop_message())
+                accepted.push_back(m);
+        }
+        if (!accepted.empty())
+            this->write_log_messages(accepted);
+        return;
+    }
+    this->batch_active = true;
+    for (const auto &m : batch)
+        this->prepare_log_message(m);
+    this->batch_active = false;
+    if (!this->batch_lines.empty()) {
+        this->write_batch(this->batch_lines);
+        this->batch_lines.clear();
+    }
+}
+
+bool eal::Sink::accept_log_message(
+    const std::shared_ptr<LogMessage> &log_message)
+{
+    if (!this->get_enabled())
+        return false;
+    con::LOG_LEVEL msg_lvl = log_message->get_severity();
+#ifndef EALOGGER_PRINT_INTERNAL
+    if (msg_lvl == con::LOG_LEVEL::EAL_INTERNAL)
+        return false;
+#endif
+    std::lock_guard<std::mutex> lock(this->mtx_min_lvl);
+    return msg_lvl >= this->min_level ||
+           log_message->get_log_type() != LogMessage::LOGTYPE::DEFAULT;
+}
+
+void eal::Sink::set_collapse_repeated(bool collapse,
+                                      std::chrono::milliseconds flush_timeout)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_collapse);
+    this->write_repeat_count();
+    this->collapse_repeated = collapse;
+    this->collapse_timeout = flush_timeout;
+    this->last_message.reset();
+}
+
+void eal::Sink::set_backtrace(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_backtrace);
+    this->backtrace_ring.clear();
+    this->backtrace_ring.resize(size);
+    this->backtrace_ring.shrink_to_fit();
+    this->backtrace_next = 0;
+    this->backtrace_count = 0;
+}
+
+void eal::Sink::tick()
+{
+    std::unique_lock<std::mutex> lock(this->mtx_collapse);
+    if (this->repeat_count > 0 &&
+        std::chrono::steady_clock::now() - this->repeat_since >=
+            this->collapse_timeout) {
+        this->write_repeat_count();
+    }
+    lock.unlock();
+    this->buffer_tick();
+}
+
+void eal::Sink::flush()
+{
+    std::unique_lock<std::mutex> lock(this->mtx_collapse);
+    this->write_repeat_count();
+    lock.unlock();
+    this->buffer_flush();
+}
+
+std::string eal::Sink::render_message(
+    const std::shared_ptr<LogMessage> &log_message)
+{
     std::string msg = "";
     // TODO: Large if else blocks are not nice. We could move the ConversionPattern
     // for loop to a different location
@@ -99,45 +267,60 @@ void eal::Sink::prepare_log_message(
             msg += *it + "\n";
         }
     } else {
-        std::unique_lock<std::mutex> msg_template_lock(this->mtx_msg_template);
-        msg = this->msg_template;
-        msg_template_lock.unlock();
+        // the patterns are the parts of the template in order, so the message
+        // is built in one pass
         std::lock_guard<std::mutex> vec_conv_patterns_lock(
             this->mtx_conv_pattern);
+        msg.reserve(128 + log_message->get_message().size());
         for (const auto &cp : this->vec_conv_patterns) {
             switch (cp.get_pattern_type()) {
+            case ConversionPattern::PATTERN_TYPE::TEXT:
+                msg += cp.get_conv_pattern();
+                break;
             case ConversionPattern::PATTERN_TYPE::DT: {
                 std::unique_lock<std::mutex> datetime_pattern_lock(
                     this->mtx_datetime_pattern);
-                cp.replace_conversion_pattern(
-                    msg,
-                    eal::utility::format_time_to_string(
-                        log_message->get_timepoint(), this->datetime_pattern));
+                // most messages share their second with the previous one
+                std::time_t t = log_message->get_timepoint();
+                if (t != this->datetime_cache_time) {
+                    this->datetime_cache = eal::utility::format_time_to_string(
+                        t, this->datetime_pattern);
+                    this->datetime_cache_time = t;
+                }
+                msg += this->datetime_cache;
+            } break;
+            case ConversionPattern::PATTERN_TYPE::FILE: {
+                const std::string &file = log_message->get_call_file();
+                std::size_t pos = file.find_last_of("/\\");
+                msg.append(file, pos == std::string::npos ? 0 : pos + 1,
+                           std::string::npos);
             } break;
-            case ConversionPattern::PATTERN_TYPE::FILE:
-                cp.replace_conversion_pattern(
-                    msg,
-                    eal::utility::get_file_name(log_message->get_call_file()));
-                break;
             case ConversionPattern::PATTERN_TYPE::FILE_ABSOLUTE:
-                cp.replace_conversion_pattern(msg, log_message->get_call_file());
+                msg += log_message->get_call_file();
                 break;
             case ConversionPattern::PATTERN_TYPE::LINE:
-                cp.replace_conversion_pattern(msg,
-                                              log_message->get_call_file_line());
+                msg += std::to_string(log_message->get_call_file_line());
                 break;
             case ConversionPattern::PATTERN_TYPE::FUNC:
-                cp.replace_conversion_pattern(msg, log_message->get_call_func());
+                msg += log_message->get_call_func();
                 break;
             case ConversionPattern::PATTERN_TYPE::HOST:
-                cp.replace_conversion_pattern(msg, eal::utility::get_hostname());
+                msg += eal::utility::get_hostname();
+                break;
+            case ConversionPattern::PATTERN_TYPE::THREADID:
+                msg += std::to_string(log_message->get_thread_id());
                 break;
             case ConversionPattern::PATTERN_TYPE::MSG:
-                cp.replace_conversion_pattern(msg, log_message->get_message());
+                msg += log_message->get_message();
                 break;
             case ConversionPattern::PATTERN_TYPE::LVL:
-                cp.replace_conversion_pattern(
-                    msg, this->loglevel_lookup.at(log_message->get_severity()));
+                msg += this->loglevel_lookup.at(log_message->get_severity());
+                break;
+            case ConversionPattern::PATTERN_TYPE::WEIGHT:
+                msg += std::to_string(log_message->get_sample_weight());
+                break;
+            case ConversionPattern::PATTERN_TYPE::LOGGER_NAME:
+                msg += log_message->get_logger_name();
                 break;
             default:
                 break;
@@ -145,8 +328,58 @@ void eal::Sink::prepare_log_message(
         }
     }
 
-    // here the sinks have to write the message
-    this->write_message(msg);
+    return msg;
+}
+
+void eal::Sink::write_repeat_count()
+{
+    if (this->repeat_count == 0)
+        return;
+    std::shared_ptr<LogMessage> m = std::make_shared<LogMessage>(
+        this->last_message->get_severity(),
+        "Last message repeated " + std::to_string(this->repeat_count) +
+            " times",
+        LogMessage::LOGTYPE::DEFAULT, this->last_message->get_call_file(),
+        this->last_message->get_call_file_line(),
+        this->last_message->get_call_func());
+    this->repeat_count = 0;
+    this->emit_message(m);
+}
+
+void eal::Sink::emit_message(const std::shared_ptr<LogMessage> &log_message)
+{
+    if (this->batch_active) {
+        this->batch_lines.emplace_back(this->render_message(log_message),
+                                       log_message->get_severity(),
+                                       log_message->get_time());
+    } else {
+        this->write_message(this->render_message(log_message),
+                            log_message->get_severity(),
+                            log_message->get_time());
+    }
+}
+
+bool eal::Sink::write_backtrace()
+{
+    std::vector<std::shared_ptr<LogMessage>> messages;
+    std::unique_lock<std::mutex> lock(this->mtx_backtrace);
+    if (this->backtrace_count == 0)
+        return false;
+    std::size_t size = this->backtrace_ring.size();
+    std::size_t first =
+        (this->backtrace_next + size - this->backtrace_count) % size;
+    messages.reserve(this->backtrace_count);
+    for (std::size_t i = 0; i < this->backtrace_count; i++) {
+        messages.push_back(
+            std::move(this->backtrace_ring[(first + i) % size]));
+    }
+    this->backtrace_count = 0;
+    lock.unlock();
+
+    this->write_repeat_count();
+    for (const auto &m : messages)
+        this->emit_message(m);
+    return true;
 }
 
 void eal::Sink::fill_conv_patterns(bool lock)
@@ -166,40 +399,40 @@ void eal::Sink::fill_conv_patterns(bool lock)
         msgp = this->msg_template;
     }
 
-    if (msgp.find("%d") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%d", ConversionPattern::PATTERN_TYPE::DT));
-    }
-    if (msgp.find("%f") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%f", ConversionPattern::PATTERN_TYPE::FILE));
-    }
-    if (msgp.find("%F") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(ConversionPattern(
-            "%F", ConversionPattern::PATTERN_TYPE::FILE_ABSOLUTE));
-    }
-    if (msgp.find("%l") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%l", ConversionPattern::PATTERN_TYPE::LINE));
-    }
-    if (msgp.find("%u") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%u", ConversionPattern::PATTERN_TYPE::FUNC));
-    }
-    if (msgp.find("%h") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%h", ConversionPattern::PATTERN_TYPE::HOST));
-    }
-    if (msgp.find("%t") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%t", ConversionPattern::PATTERN_TYPE::THREADID));
-    }
-    if (msgp.find("%m") != std::string::npos) {
-        this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%m", ConversionPattern::PATTERN_TYPE::MSG));
+    static const std::map<char, ConversionPattern::PATTERN_TYPE> types = {
+        {'d', ConversionPattern::PATTERN_TYPE::DT},
+        {'f', ConversionPattern::PATTERN_TYPE::FILE},
+        {'F', ConversionPattern::PATTERN_TYPE::FILE_ABSOLUTE},
+        {'l', ConversionPattern::PATTERN_TYPE::LINE},
+        {'u', ConversionPattern::PATTERN_TYPE::FUNC},
+        {'h', ConversionPattern::PATTERN_TYPE::HOST},
+        {'t', ConversionPattern::PATTERN_TYPE::THREADID},
+        {'m', ConversionPattern::PATTERN_TYPE::MSG},
+        {'s', ConversionPattern::PATTERN_TYPE::LVL},
+        {'w', ConversionPattern::PATTERN_TYPE::WEIGHT},
+        {'c', ConversionPattern::PATTERN_TYPE::LOGGER_NAME}};
+
+    // split the template into text and conversion patterns
+    std::string text;
+    for (std::size_t i = 0; i < msgp.size(); i++) {
+        if (msgp[i] == '%' && i + 1 < msgp.size()) {
+            auto it = types.find(msgp[i + 1]);
+            if (it != types.end()) {
+                if (!text.empty()) {
+                    this->vec_conv_patterns.emplace_back(
+                        text, ConversionPattern::PATTERN_TYPE::TEXT);
+                    text.clear();
+                }
+                this->vec_conv_patterns.emplace_back(msgp.substr(i, 2),
+                                                     it->second);
+                i++;
+                continue;
+            }
+        }
+        text.push_back(msgp[i]);
     }
-    if (msgp.find("%s") != std::string::npos) {
+    if (!text.empty()) {
         this->vec_conv_patterns.emplace_back(
-            ConversionPattern("%s", ConversionPattern::PATTERN_TYPE::LVL));
+            text, ConversionPattern::PATTERN_TYPE::TEXT);
     }
 }
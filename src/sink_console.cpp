@@ -30,4 +30,19 @@ void eal::SinkConsole::write_message(const std::string &msg)
     std::cout << msg << std::endl;
 }
 
+void eal::SinkConsole::write_batch(const rendered_batch &lines)
+{
+#ifdef _WIN32
+    eal::Sink::write_batch(lines);
+#else
+    std::lock_guard<std::mutex> lock(this->mtx_console);
+    // everything that is still in the stream buffer has to come first
+    std::cout.flush();
+    std::vector<struct iovec> iov;
+    iov.reserve(lines.size() * 2);
+    eal::utility::append_lines_iovec(iov, lines);
+    eal::utility::write_vectored(STDOUT_FILENO, iov);
+#endif
+}
+
 void eal::SinkConsole::config_changed() {}
@@ -13,24 +13,230 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 
+
 #include <ealogger/sink_file.h>
 
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace eal = ealogger;
 namespace con = ealogger::constants;
 
+namespace
+{
+int open_append(const std::string &path)
+{
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+/**
+ * @brief Open the index of a log file, \p truncate starts a new one
+ */
+int open_index_file(const std::string &path, bool truncate)
+{
+#ifdef _WIN32
+    return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY |
+                                   (truncate ? _O_TRUNC : 0),
+                 _S_IREAD | _S_IWRITE);
+#else
+    return open(path.c_str(),
+                O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC |
+                    (truncate ? O_TRUNC : 0),
+                0644);
+#endif
+}
+
+/**
+ * @brief Read \p len bytes at \p offset of \p fd
+ */
+bool read_at(int fd, char *data, std::size_t len, std::int64_t offset)
+{
+#ifdef _WIN32
+    if (_lseeki64(fd, offset, SEEK_SET) != offset)
+        return false;
+    return _read(fd, data, static_cast<unsigned int>(len)) ==
+           static_cast<int>(len);
+#else
+    return pread(fd, data, len, static_cast<off_t>(offset)) ==
+           static_cast<ssize_t>(len);
+#endif
+}
+
+bool truncate_fd(int fd, std::uint64_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+#else
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * @brief Open a file for positioned writes, the io_uring tracks the offset
+ */
+int open_positioned(const std::string &path)
+{
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+}
+#endif
+
+/**
+ * @brief Write all of \p len bytes, retrying on partial writes and EINTR
+ */
+bool write_all(int fd, const char *data, std::size_t len)
+{
+    while (len > 0) {
+#ifdef _WIN32
+        int n = _write(fd, data, static_cast<unsigned int>(len));
+#else
+        ssize_t n = write(fd, data, len);
+#endif
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Flush written data of \p fd to stable storage
+ */
+bool sync_fd(int fd)
+{
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#elif defined(__APPLE__)
+    return fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+void close_fd(int fd)
+{
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+}
+
+namespace
+{
+eal::SinkFile::Options flush_options(bool flush_buffer)
+{
+    eal::SinkFile::Options options;
+    options.flush_buffer = flush_buffer;
+    return options;
+}
+}
+
 eal::SinkFile::SinkFile(std::string msg_template, std::string datetime_pattern,
                         bool enabled, con::LOG_LEVEL min_lvl,
                         std::string log_file, bool flush_buffer)
+    : eal::SinkFile(std::move(msg_template), std::move(datetime_pattern),
+                    enabled, min_lvl, std::move(log_file),
+                    flush_options(flush_buffer))
+{
+}
+
+eal::SinkFile::SinkFile(std::string msg_template, std::string datetime_pattern,
+                        bool enabled, con::LOG_LEVEL min_lvl,
+                        std::string log_file, const Options &options)
     : eal::Sink(std::move(msg_template), std::move(datetime_pattern), enabled,
                 min_lvl),
-      log_file(log_file), flush_buffer(flush_buffer)
+      fd(-1),
+      log_file(log_file),
+      file_size(0),
+      flush_buffer(options.flush_buffer),
+      buffer_size(options.buffer_size),
+      flush_interval(options.flush_interval),
+      flush_level(options.flush_lvl),
+      last_write(std::chrono::steady_clock::now()),
+      durability(options.durability),
+      sync_interval(options.sync_interval),
+      last_sync(std::chrono::steady_clock::now()),
+      unsynced(false),
+      buffered_lines(0),
+      degraded(false),
+      last_error(0),
+      write_errors(0),
+      dropped(0),
+      dropped_unreported(0),
+      index_block(options.index_block),
+      index_fd(-1),
+      index_entry(),
+      index_started(false),
+      index_last_ns(std::numeric_limits<std::int64_t>::min())
 {
+    this->buffer.reserve(this->buffer_size);
+    if (options.io_uring_depth > 0) {
+        this->uring = std::unique_ptr<UringWriter>(new UringWriter(
+            options.io_uring_depth,
+            std::max<std::size_t>(this->buffer_size, 4096)));
+        if (!this->uring->is_active())
+            this->uring.reset();
+    }
     if (this->get_enabled()) {
         this->open_file();
     }
 }
 
 eal::SinkFile::~SinkFile() { this->close_file(); }
+const std::chrono::milliseconds eal::SinkFile::retry_interval =
+    std::chrono::milliseconds(1000);
+
+eal::SinkStats eal::SinkFile::get_stats()
+{
+    SinkStats stats;
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->uring)
+        this->uring->fill_stats(stats);
+    stats.degraded = this->degraded;
+    stats.write_errors = this->write_errors;
+    stats.messages_dropped = this->dropped;
+    stats.last_error = this->last_error;
+    return stats;
+}
+
+void eal::SinkFile::reopen()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    // a new file may have fixed the problem, retry with the next message
+    if (this->degraded)
+        this->next_retry = std::chrono::steady_clock::now();
+    if (this->fd < 0)
+        return;
+    this->close_file(false);
+    this->open_file(false);
+}
+
+int eal::SinkFile::get_commit_lvl()
+{
+    if (this->durability != DURABILITY::GROUP_COMMIT || !this->get_enabled())
+        return con::LOG_LEVEL_COUNT;
+    return static_cast<int>(this->flush_level);
+}
+
 void eal::SinkFile::set_log_file(std::string log_file)
 {
     std::lock_guard<std::mutex> lock(this->mtx_log_file);
@@ -38,62 +244,491 @@ void eal::SinkFile::set_log_file(std::string log_file)
     // TODO: If this is the same filename?
     this->close_file();
     this->open_file();
+    std::lock_guard<std::mutex> file_lock(this->mtx_file);
+    if (this->degraded)
+        this->next_retry = std::chrono::steady_clock::now();
 }
 
 void eal::SinkFile::write_message(const std::string &msg)
 {
-    std::lock_guard<std::mutex> lock(this->mtx_file_stream);
-    try {
-        if (this->file_stream.is_open()) {
-            this->file_stream << msg << "\n";
-            if (this->flush_buffer) {
-                this->file_stream.flush();
-            }
+    this->write_message(msg, con::LOG_LEVEL::EAL_DEBUG);
+}
+
+void eal::SinkFile::write_message(const std::string &msg, con::LOG_LEVEL lvl)
+{
+    this->write_message(msg, lvl, std::chrono::system_clock::now());
+}
+
+void eal::SinkFile::write_message(const std::string &msg, con::LOG_LEVEL lvl,
+                                  std::chrono::system_clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->index_block_due())
+        this->start_index_block();
+    this->append(msg.data(), msg.size(), true, lvl, true, time);
+}
+
+void eal::SinkFile::append_record(const char *data, std::size_t len,
+                                  con::LOG_LEVEL lvl, bool message,
+                                  std::chrono::system_clock::time_point time)
+{
+    this->append(data, len, false, lvl, message, time);
+}
+
+bool eal::SinkFile::truncate_file(std::uint64_t size)
+{
+    if (this->fd < 0 || !truncate_fd(this->fd, size))
+        return false;
+    this->file_size = size;
+#ifndef _WIN32
+    if (this->uring)
+        this->uring->set_file(this->fd, static_cast<std::int64_t>(size));
+#endif
+    if (this->index_fd >= 0) {
+        this->close_index();
+        this->open_index();
+    }
+    return true;
+}
+
+bool eal::SinkFile::index_block_due() const
+{
+    return this->index_fd >= 0 &&
+           (!this->index_started ||
+            this->file_size - this->index_entry.offset >= this->index_block);
+}
+
+void eal::SinkFile::start_index_block()
+{
+    if (this->index_fd < 0)
+        return;
+    this->finish_index_block();
+    this->index_entry = LogIndex::Entry();
+    this->index_entry.offset = this->file_size;
+    this->index_entry.first_ns = std::numeric_limits<std::int64_t>::max();
+    this->index_started = true;
+}
+
+void eal::SinkFile::append(const char *data, std::size_t len, bool newline,
+                           con::LOG_LEVEL lvl, bool message,
+                           std::chrono::system_clock::time_point time)
+{
+    if (this->uring) {
+        this->uring->reap();
+        this->check_uring();
+    }
+    if (this->fd >= 0 && !this->degraded)
+        this->prepare_append(len);
+    if (this->fd < 0 || this->degraded) {
+        if (message) {
+            this->dropped++;
+            this->dropped_unreported++;
+        }
+        return;
+    }
+    std::size_t total = newline ? len + 1 : len;
+    if (!this->buffer.empty() &&
+        this->buffer.size() + total > this->buffer_size)
+        this->write_buffer();
+    this->buffer.append(data, len);
+    if (newline)
+        this->buffer.push_back('\n');
+    if (message) {
+        this->buffered_lines++;
+        if (this->index_started) {
+            std::int64_t ns =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    time.time_since_epoch())
+                    .count();
+            LogIndex::Entry &e = this->index_entry;
+            e.first_ns = std::min(e.first_ns, ns);
+            this->index_last_ns = std::max(this->index_last_ns, ns);
+            e.messages++;
+            e.levels |= 1u << static_cast<int>(lvl);
         }
-    } catch (const std::exception &ex) {
-        // TODO: And now?
+    }
+    this->file_size += total;
+    this->unsynced = true;
+    // the intervals are checked here as well, there is no background thread
+    // calling Sink::tick in synchronous mode
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if ((this->durability == DURABILITY::GROUP_COMMIT &&
+         lvl >= this->flush_level) ||
+        (this->durability == DURABILITY::PERIODIC &&
+         now - this->last_sync >= this->sync_interval)) {
+        this->commit();
+    } else if (this->flush_buffer || lvl >= this->flush_level ||
+               this->buffer.size() >= this->buffer_size ||
+               now - this->last_write >= this->flush_interval) {
+        this->write_buffer();
     }
 }
 
+void eal::SinkFile::write_batch(const rendered_batch &lines)
+{
+#ifdef _WIN32
+    eal::Sink::write_batch(lines);
+#else
+    if (this->uring || this->index_block > 0) {
+        // io_uring writes need the data in one of its buffers anyway, the
+        // index needs the offset of every line
+        eal::Sink::write_batch(lines);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->fd < 0 || this->degraded) {
+        this->dropped += lines.size();
+        this->dropped_unreported += lines.size();
+        return;
+    }
+    std::size_t bytes = this->buffer.size();
+    bool flush = this->flush_buffer;
+    bool sync = false;
+    for (const auto &line : lines) {
+        bytes += line.text.size() + 1;
+        if (line.lvl >= this->flush_level) {
+            flush = true;
+            sync = this->durability == DURABILITY::GROUP_COMMIT;
+        }
+    }
+    this->file_size += bytes - this->buffer.size();
+    this->unsynced = true;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (this->durability == DURABILITY::PERIODIC &&
+        now - this->last_sync >= this->sync_interval)
+        flush = sync = true;
+    if (!flush && bytes < this->buffer_size &&
+        now - this->last_write < this->flush_interval) {
+        for (const auto &line : lines) {
+            this->buffer.append(line.text);
+            this->buffer.push_back('\n');
+        }
+        this->buffered_lines += lines.size();
+        return;
+    }
+
+    // the batch is written anyway, so do not copy it into the buffer
+    std::vector<struct iovec> iov;
+    iov.reserve(lines.size() * 2 + 1);
+    if (!this->buffer.empty())
+        iov.push_back({&this->buffer[0], this->buffer.size()});
+    eal::utility::append_lines_iovec(iov, lines);
+    if (!eal::utility::write_vectored(this->fd, iov)) {
+        this->write_failed(errno, lines.size(), bytes);
+        return;
+    }
+    this->buffer.clear();
+    this->buffered_lines = 0;
+    this->last_write = now;
+    // one sync covers the whole batch
+    if (sync)
+        this->commit();
+#endif
+}
+
+void eal::SinkFile::buffer_tick()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->uring) {
+        this->uring->reap();
+        this->check_uring();
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (this->degraded) {
+        if (now >= this->next_retry)
+            this->retry_writes();
+        return;
+    }
+    if (this->durability == DURABILITY::PERIODIC && this->unsynced &&
+        now - this->last_sync >= this->sync_interval) {
+        this->commit();
+    } else if (!this->buffer.empty() &&
+               now - this->last_write >= this->flush_interval) {
+        this->write_buffer();
+    }
+}
+
+void eal::SinkFile::buffer_flush()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->durability != DURABILITY::NONE && this->unsynced) {
+        this->commit();
+        return;
+    }
+    this->write_buffer();
+}
+
+bool eal::SinkFile::drop_message()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (!this->degraded)
+        return false;
+    // synchronous loggers have no thread calling buffer_tick, retry here
+    if (std::chrono::steady_clock::now() >= this->next_retry &&
+        this->retry_writes())
+        return false;
+    this->dropped++;
+    this->dropped_unreported++;
+    return true;
+}
+
 void eal::SinkFile::config_changed()
 {
     // we can access enabled directly here because this is called from
     // set_enabled and the coresponding mutex is already locked
-    if (this->enabled && this->file_stream.is_open()) {
+    if (!this->enabled) {
         this->close_file();
         return;
     }
-    if (this->enabled && !this->file_stream.is_open()) {
-        this->open_file();
+    this->open_file();
+}
+
+void eal::SinkFile::prepare_append(std::size_t len) { (void)len; }
+
+void eal::SinkFile::open_file(bool lock)
+{
+    std::unique_lock<std::mutex> file_lock(this->mtx_file, std::defer_lock);
+    if (lock)
+        file_lock.lock();
+    if (this->fd >= 0)
+        return;
+    this->last_write = std::chrono::steady_clock::now();
+#ifndef _WIN32
+    if (this->uring) {
+        this->fd = open_positioned(this->log_file);
+        if (this->fd >= 0) {
+            off_t end = lseek(this->fd, 0, SEEK_END);
+            this->file_size = end > 0 ? static_cast<std::uint64_t>(end) : 0;
+            this->uring->set_file(this->fd, end);
+            this->open_index();
+            if (!this->file_opened())
+                this->reject_file();
+        } else {
+            this->write_failed(errno, 0, 0);
+        }
+        return;
+    }
+#endif
+    this->fd = open_append(this->log_file);
+    if (this->fd >= 0) {
+#ifdef _WIN32
+        long end = _lseek(this->fd, 0, SEEK_END);
+#else
+        off_t end = lseek(this->fd, 0, SEEK_END);
+#endif
+        this->file_size = end > 0 ? static_cast<std::uint64_t>(end) : 0;
+        this->open_index();
+        if (!this->file_opened())
+            this->reject_file();
+    } else {
+        this->write_failed(errno, 0, 0);
+    }
+}
+
+void eal::SinkFile::reject_file()
+{
+    // nothing was written yet, the file is left as it is
+    this->close_index();
+    close_fd(this->fd);
+    this->fd = -1;
+    this->buffer.clear();
+    this->buffered_lines = 0;
+    this->write_failed(EINVAL, 0, 0);
+}
+
+void eal::SinkFile::close_file(bool lock)
+{
+    std::unique_lock<std::mutex> file_lock(this->mtx_file, std::defer_lock);
+    if (lock)
+        file_lock.lock();
+    if (this->fd >= 0) {
+        if (this->durability != DURABILITY::NONE && this->unsynced)
+            this->commit();
+        this->write_buffer();
+        if (this->uring)
+            this->uring->wait_all();
+        this->close_index();
+        close_fd(this->fd);
+        this->fd = -1;
+    }
+}
+
+void eal::SinkFile::write_buffer()
+{
+    this->last_write = std::chrono::steady_clock::now();
+    if (this->buffer.empty() || this->fd < 0)
+        return;
+    if (this->uring) {
+        this->uring->write(this->buffer.data(), this->buffer.size());
+        this->buffer.clear();
+        this->buffered_lines = 0;
+        return;
+    }
+    if (!write_all(this->fd, this->buffer.data(), this->buffer.size())) {
+        this->write_failed(errno, 0, this->buffer.size());
         return;
     }
+    this->buffer.clear();
+    this->buffered_lines = 0;
 }
 
-void eal::SinkFile::open_file()
+void eal::SinkFile::commit()
 {
-    std::lock_guard<std::mutex> lock(this->mtx_file_stream);
-    try {
-        if (!this->file_stream.is_open()) {
-            std::unique_lock<std::mutex> lock_log_file(this->mtx_log_file);
-            this->file_stream.open(this->log_file,
-                                   std::ios::out | std::ios::app);
-            if (!this->file_stream)
-                throw std::runtime_error("Can not open logfile: " +
-                                         this->log_file);
-            lock_log_file.unlock();
+    this->write_buffer();
+    this->last_sync = std::chrono::steady_clock::now();
+    this->unsynced = false;
+    if (this->fd < 0)
+        return;
+    // the sync has to cover writes that are still in flight
+    if (this->uring) {
+        this->uring->wait_all();
+        this->check_uring();
+    }
+    if (!sync_fd(this->fd)) {
+        // the data may still reach the disk later, keep writing
+        this->write_errors++;
+        this->last_error = errno;
+    }
+}
 
-            // set exception mask for the file stream
-            this->file_stream.exceptions(std::ifstream::badbit |
-                                         std::ifstream::failbit);
+void eal::SinkFile::write_failed(int err, std::uint64_t lost,
+                                 std::uint64_t bytes)
+{
+    this->write_errors++;
+    this->last_error = err;
+    this->dropped += this->buffered_lines + lost;
+    this->dropped_unreported += this->buffered_lines + lost;
+    this->buffer.clear();
+    this->buffered_lines = 0;
+    this->degraded = true;
+    // a partial write leaves a torn line behind, cut the file back to where
+    // the write started so the lost messages are not in it at all. The next
+    // block of the index has to start at the real end.
+    if (this->fd >= 0 && !this->uring) {
+        std::uint64_t start = this->file_size - bytes;
+        if (bytes <= this->file_size && truncate_fd(this->fd, start)) {
+            this->file_size = start;
+        } else {
+#ifdef _WIN32
+            long end = _lseek(this->fd, 0, SEEK_END);
+#else
+            off_t end = lseek(this->fd, 0, SEEK_END);
+#endif
+            if (end >= 0)
+                this->file_size = static_cast<std::uint64_t>(end);
         }
-    } catch (const std::exception &ex) {
     }
+    this->finish_index_block();
+    this->next_retry = std::chrono::steady_clock::now() + retry_interval;
 }
-void eal::SinkFile::close_file()
+
+void eal::SinkFile::check_uring()
 {
-    std::lock_guard<std::mutex> lock(this->mtx_file_stream);
-    if (this->file_stream.is_open()) {
-        this->file_stream.flush();
-        this->file_stream.close();
+    std::uint64_t lines = 0;
+    int err = this->uring->take_error(lines);
+    if (err != 0)
+        this->write_failed(err, lines, 0);
+}
+
+bool eal::SinkFile::retry_writes()
+{
+    this->next_retry = std::chrono::steady_clock::now() + retry_interval;
+    if (this->fd < 0) {
+        this->open_file(false);
+        if (this->fd < 0)
+            return false;
+    }
+    this->degraded = false;
+    this->report_dropped(this->dropped_unreported, this->last_error);
+    this->write_buffer();
+    if (this->uring) {
+        this->uring->wait_all();
+        this->check_uring();
     }
+    if (this->degraded)
+        return false;
+    this->dropped_unreported = 0;
+    return true;
+}
+
+void eal::SinkFile::report_dropped(std::uint64_t count, int err)
+{
+    // the report is no message, it must not be counted if it is lost
+    std::string report = "ealogger: " + std::to_string(count) +
+                         " messages dropped after write error: " +
+                         std::strerror(err);
+    this->append(report.data(), report.size(), true,
+                 con::LOG_LEVEL::EAL_DEBUG, false,
+                 std::chrono::system_clock::time_point());
+}
+
+void eal::SinkFile::open_index()
+{
+    if (this->index_block == 0)
+        return;
+    this->index_started = false;
+    this->index_fd = open_index_file(this->log_file + LogIndex::suffix,
+                                     this->file_size == 0);
+    if (this->index_fd < 0)
+        return;
+#ifdef _WIN32
+    std::int64_t end = _lseeki64(this->index_fd, 0, SEEK_END);
+#else
+    std::int64_t end = lseek(this->index_fd, 0, SEEK_END);
+#endif
+    const std::int64_t header =
+        static_cast<std::int64_t>(LogIndex::header_size);
+    const std::int64_t entry_size =
+        static_cast<std::int64_t>(LogIndex::entry_size);
+    if (end < 0)
+        return;
+    if (end < header) {
+        truncate_fd(this->index_fd, 0);
+        this->index_record.clear();
+        LogIndex::put_header(this->index_record,
+                             static_cast<std::uint32_t>(this->index_block));
+        write_all(this->index_fd, this->index_record.data(),
+                  this->index_record.size());
+        return;
+    }
+    // drop a torn entry and the blocks the log file does not have anymore
+    std::int64_t n = (end - header) / entry_size;
+    char entry[LogIndex::entry_size];
+    while (n > 0 &&
+           read_at(this->index_fd, entry, sizeof(entry),
+                   header + (n - 1) * entry_size) &&
+           binlog::get<std::uint64_t>(entry) +
+                   binlog::get<std::uint32_t>(entry + 24) >
+               this->file_size)
+        n--;
+    std::int64_t valid = header + n * entry_size;
+    if (valid != end)
+        truncate_fd(this->index_fd, static_cast<std::uint64_t>(valid));
+}
+
+void eal::SinkFile::close_index()
+{
+    if (this->index_fd < 0)
+        return;
+    this->finish_index_block();
+    close_fd(this->index_fd);
+    this->index_fd = -1;
+}
+
+void eal::SinkFile::finish_index_block()
+{
+    if (!this->index_started)
+        return;
+    this->index_started = false;
+    LogIndex::Entry &e = this->index_entry;
+    if (e.messages == 0 || this->file_size <= e.offset)
+        return;
+    e.bytes = static_cast<std::uint32_t>(std::min<std::uint64_t>(
+        this->file_size - e.offset, std::numeric_limits<std::uint32_t>::max()));
+    e.last_ns = this->index_last_ns;
+    this->index_record.clear();
+    LogIndex::put_entry(this->index_record, e);
+    // the index is only a shortcut, a lost entry is no reason to stop logging
+    write_all(this->index_fd, this->index_record.data(),
+              this->index_record.size());
 }
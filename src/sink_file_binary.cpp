@@ -0,0 +1,219 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/sink_file_binary.h>
+
+#include <cstring>
+
+#include <ealogger/binlog_reader.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+eal::SinkFileBinary::SinkFileBinary(
+    std::string msg_template, std::string datetime_pattern, bool enabled,
+    con::LOG_LEVEL min_lvl, std::string log_file, const Options &options,
+    bool checksums)
+    : eal::SinkFile(std::move(msg_template), std::move(datetime_pattern),
+                    enabled, min_lvl, std::move(log_file), options),
+      sequence(0),
+      checksums(checksums),
+      framed(checksums)
+{
+    // the SinkFile constructor can not call our file_opened
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->fd >= 0 && !this->file_opened())
+        this->reject_file();
+}
+
+bool eal::SinkFileBinary::file_opened()
+{
+    this->framed = this->checksums;
+    std::uint64_t torn = 0;
+    // records appended to a text log would corrupt it
+    if (this->file_size > 0 && !this->recover(torn))
+        return false;
+    // the header is part of the first block
+    this->start_index_block();
+    if (this->file_size == 0) {
+        this->record.clear();
+        binlog::put_file_header(this->record,
+                                this->framed ? binlog::flag_checksum : 0);
+        this->append_record(this->record.data(), this->record.size(),
+                            con::LOG_LEVEL::EAL_DEBUG, false);
+    }
+    this->call_sites.clear();
+    this->loggers.clear();
+    this->append_format();
+    if (torn > 0) {
+        LogMessage m(con::LOG_LEVEL::EAL_WARNING,
+                     "ealogger: removed " + std::to_string(torn) +
+                         " bytes of a torn record at the end of " +
+                         this->log_file,
+                     LogMessage::LOGTYPE::DEFAULT, "", 0, "");
+        this->append_message(m);
+    }
+    return true;
+}
+
+bool eal::SinkFileBinary::recover(std::uint64_t &torn)
+{
+    torn = 0;
+    // only the last block of the index can contain a torn record
+    std::uint64_t from = 0;
+    LogIndex index(this->log_file);
+    if (index.is_valid() && index.size() > 0)
+        from = index.get(index.size() - 1).offset;
+
+    BinlogReader reader(this->log_file);
+    std::uint64_t end = 0;
+    // not a binary log file, leave it alone
+    if (!reader.find_valid_end(end, from))
+        return false;
+    if (end > 0)
+        this->framed = reader.has_checksums();
+    std::uint64_t size = this->file_size;
+    if (end < size && this->truncate_file(end))
+        torn = size - end;
+    return true;
+}
+
+void eal::SinkFileBinary::report_dropped(std::uint64_t count, int err)
+{
+    this->restart_dictionary();
+    LogMessage m(con::LOG_LEVEL::EAL_WARNING,
+                 "ealogger: " + std::to_string(count) +
+                     " messages dropped after write error: " +
+                     std::strerror(err),
+                 LogMessage::LOGTYPE::DEFAULT, "", 0, "");
+    this->append_message(m);
+}
+
+void eal::SinkFileBinary::write_log_messages(
+    const std::vector<std::shared_ptr<LogMessage>> &messages)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    for (const auto &m : messages)
+        this->append_message(*m);
+}
+
+void eal::SinkFileBinary::append_message(LogMessage &m)
+{
+    if (this->index_block_due())
+        this->restart_dictionary();
+    std::uint32_t site = this->get_call_site(m);
+    std::uint32_t logger = this->get_logger(m);
+
+    std::string &r = this->record;
+    r.clear();
+    std::size_t pos = binlog::begin_record(r, binlog::RECORD::MESSAGE);
+    binlog::put<std::int64_t>(
+        r, std::chrono::duration_cast<std::chrono::nanoseconds>(
+               m.get_time().time_since_epoch())
+               .count());
+    binlog::put<std::uint64_t>(r, this->sequence++);
+    binlog::put<std::uint64_t>(r, m.get_thread_id());
+    binlog::put<std::uint32_t>(r, site);
+    binlog::put<std::uint32_t>(r, logger);
+    binlog::put<std::uint32_t>(r, m.get_sample_weight());
+    binlog::put<std::uint8_t>(r, static_cast<std::uint8_t>(m.get_severity()));
+    binlog::put<std::uint8_t>(r, static_cast<std::uint8_t>(m.get_log_type()));
+    if (m.get_log_type() == LogMessage::LOGTYPE::STACK) {
+        for (LogMessage::msg_vec_it it = m.get_msg_vec_begin();
+             it != m.get_msg_vec_end(); it++) {
+            binlog::put<std::uint32_t>(r, static_cast<std::uint32_t>(it->size()));
+            r.append(*it);
+        }
+    } else {
+        r.append(m.get_message());
+    }
+    binlog::finish_record(r, pos, this->framed);
+    this->append_record(r.data(), r.size(), m.get_severity(), true,
+                        m.get_time());
+}
+
+void eal::SinkFileBinary::append_format()
+{
+    std::string &r = this->record;
+    r.clear();
+    std::size_t pos = binlog::begin_record(r, binlog::RECORD::FORMAT);
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_msg_template);
+        binlog::put<std::uint32_t>(
+            r, static_cast<std::uint32_t>(this->msg_template.size()));
+        r.append(this->msg_template);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_datetime_pattern);
+        r.append(this->datetime_pattern);
+    }
+    binlog::finish_record(r, pos, this->framed);
+    this->append_record(r.data(), r.size(), con::LOG_LEVEL::EAL_DEBUG, false);
+}
+
+void eal::SinkFileBinary::restart_dictionary()
+{
+    this->start_index_block();
+    this->call_sites.clear();
+    this->loggers.clear();
+    this->append_format();
+}
+
+std::uint32_t eal::SinkFileBinary::get_call_site(LogMessage &m)
+{
+    this->lookup.file = m.get_call_file();
+    this->lookup.func = m.get_call_func();
+    this->lookup.line = m.get_call_file_line();
+    auto it = this->call_sites.find(this->lookup);
+    if (it != this->call_sites.end())
+        return it->second;
+
+    std::uint32_t id = static_cast<std::uint32_t>(this->call_sites.size());
+    this->call_sites.emplace(this->lookup, id);
+    std::string &r = this->record;
+    r.clear();
+    std::size_t pos = binlog::begin_record(r, binlog::RECORD::CALL_SITE);
+    binlog::put<std::uint32_t>(r, id);
+    binlog::put<std::int32_t>(r, this->lookup.line);
+    binlog::put<std::uint32_t>(
+        r, static_cast<std::uint32_t>(this->lookup.file.size()));
+    r.append(this->lookup.file);
+    r.append(this->lookup.func);
+    binlog::finish_record(r, pos, this->framed);
+    this->append_record(r.data(), r.size(), con::LOG_LEVEL::EAL_DEBUG, false);
+    return id;
+}
+
+std::uint32_t eal::SinkFileBinary::get_logger(LogMessage &m)
+{
+    const std::string &name = m.get_logger_name();
+    if (name.empty())
+        return 0;
+    auto it = this->loggers.find(name);
+    if (it != this->loggers.end())
+        return it->second;
+
+    std::uint32_t id = static_cast<std::uint32_t>(this->loggers.size() + 1);
+    this->loggers.emplace(name, id);
+    std::string &r = this->record;
+    r.clear();
+    std::size_t pos = binlog::begin_record(r, binlog::RECORD::LOGGER);
+    binlog::put<std::uint32_t>(r, id);
+    r.append(name);
+    binlog::finish_record(r, pos, this->framed);
+    this->append_record(r.data(), r.size(), con::LOG_LEVEL::EAL_DEBUG, false);
+    return id;
+}
@@ -0,0 +1,343 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/sink_file_direct.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+eal::SinkFileDirect::SinkFileDirect(std::string msg_template,
+                                    std::string datetime_pattern, bool enabled,
+                                    con::LOG_LEVEL min_lvl,
+                                    std::string log_file,
+                                    const SinkFile::Options &options,
+                                    std::size_t block_size)
+    : eal::Sink(std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl),
+      fd(-1),
+      direct(false),
+      log_file(std::move(log_file)),
+      buffer(nullptr),
+      block_size(std::max<std::size_t>(block_size, 512)),
+      used(0),
+      offset(0),
+      dirty(false),
+      file_end(0),
+      pending_lines(0),
+      degraded(false),
+      last_error(0),
+      write_errors(0),
+      dropped(0),
+      dropped_unreported(0),
+      flush_interval(options.flush_interval),
+      flush_level(options.flush_lvl),
+      last_write(std::chrono::steady_clock::now())
+{
+    // whole blocks only, at least one for the lines besides the tail block
+    this->buffer_size =
+        std::max<std::size_t>(
+            (options.buffer_size + this->block_size - 1) / this->block_size,
+            2) *
+        this->block_size;
+    void *mem = nullptr;
+    int err = ENOMEM;
+#ifndef _WIN32
+    err = posix_memalign(&mem, this->block_size, this->buffer_size);
+    if (err != 0)
+        mem = nullptr;
+#endif
+    this->buffer = static_cast<char *>(mem);
+    // without a buffer every message is dropped and counted
+    if (this->buffer == nullptr)
+        this->write_failed(err);
+    if (this->get_enabled()) {
+        std::lock_guard<std::mutex> lock(this->mtx_file);
+        this->open_file();
+    }
+}
+
+eal::SinkFileDirect::~SinkFileDirect()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_file);
+        this->close_file();
+    }
+    std::free(this->buffer);
+}
+
+const std::chrono::milliseconds eal::SinkFileDirect::retry_interval =
+    std::chrono::milliseconds(1000);
+
+bool eal::SinkFileDirect::is_direct()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    return this->fd >= 0 && this->direct;
+}
+
+eal::SinkStats eal::SinkFileDirect::get_stats()
+{
+    SinkStats stats;
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    stats.degraded = this->degraded;
+    stats.write_errors = this->write_errors;
+    stats.messages_dropped = this->dropped;
+    stats.last_error = this->last_error;
+    return stats;
+}
+
+void eal::SinkFileDirect::reopen()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    // a new file may have fixed the problem, retry with the next message
+    if (this->degraded)
+        this->next_retry = std::chrono::steady_clock::now();
+    if (this->fd < 0)
+        return;
+    this->close_file();
+    this->open_file();
+}
+
+void eal::SinkFileDirect::write_message(const std::string &msg)
+{
+    this->write_message(msg, con::LOG_LEVEL::EAL_DEBUG);
+}
+
+void eal::SinkFileDirect::write_message(const std::string &msg,
+                                        con::LOG_LEVEL lvl)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->fd < 0 && !this->degraded)
+        return;
+    if ((this->degraded && !this->retry_writes()) ||
+        !this->append_line(msg.data(), msg.size())) {
+        this->dropped++;
+        this->dropped_unreported++;
+        return;
+    }
+    this->pending_lines++;
+    if (lvl >= this->flush_level ||
+        std::chrono::steady_clock::now() - this->last_write >=
+            this->flush_interval)
+        this->write_buffer();
+}
+
+void eal::SinkFileDirect::buffer_tick()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->degraded) {
+        this->retry_writes();
+        return;
+    }
+    if (this->dirty && std::chrono::steady_clock::now() - this->last_write >=
+                           this->flush_interval)
+        this->write_buffer();
+}
+
+void eal::SinkFileDirect::buffer_flush()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (this->degraded) {
+        this->retry_writes();
+        return;
+    }
+    this->write_buffer();
+}
+
+void eal::SinkFileDirect::config_changed()
+{
+    // we can access enabled directly here because this is called from
+    // set_enabled and the coresponding mutex is already locked
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    if (!this->enabled) {
+        this->close_file();
+        return;
+    }
+    this->open_file();
+}
+
+bool eal::SinkFileDirect::append_line(const char *data, std::size_t len)
+{
+    // a written buffer keeps less than a block, the rest is for the line
+    len = std::min(len, this->buffer_size - this->block_size);
+    if (this->used + len + 1 > this->buffer_size && !this->write_buffer())
+        return false;
+    std::memcpy(this->buffer + this->used, data, len);
+    this->used += len;
+    this->buffer[this->used++] = '\n';
+    this->dirty = true;
+    return true;
+}
+
+void eal::SinkFileDirect::write_failed(int err)
+{
+    this->write_errors++;
+    this->last_error = err;
+    this->degraded = true;
+    this->next_retry = std::chrono::steady_clock::now() + retry_interval;
+}
+
+bool eal::SinkFileDirect::retry_writes()
+{
+    if (std::chrono::steady_clock::now() < this->next_retry)
+        return false;
+    this->next_retry = std::chrono::steady_clock::now() + retry_interval;
+    if (this->fd < 0) {
+        this->open_file();
+        if (this->fd < 0)
+            return false;
+    }
+    if (!this->write_buffer())
+        return false;
+    this->degraded = false;
+    if (this->dropped_unreported > 0) {
+        // the report is kept in the buffer like any other line, it is
+        // written with the next messages if this write fails
+        std::string report = "ealogger: " +
+                             std::to_string(this->dropped_unreported) +
+                             " messages dropped after write error: " +
+                             std::strerror(this->last_error);
+        if (this->append_line(report.data(), report.size())) {
+            this->dropped_unreported = 0;
+            this->write_buffer();
+        }
+    }
+    return !this->degraded;
+}
+
+#ifdef __linux__
+
+void eal::SinkFileDirect::open_file()
+{
+    if (this->fd >= 0 || this->buffer == nullptr)
+        return;
+    this->last_write = std::chrono::steady_clock::now();
+    this->direct = true;
+    this->fd = open(this->log_file.c_str(),
+                    O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+    if (this->fd < 0 && errno == EINVAL) {
+        this->direct = false;
+        this->fd = open(this->log_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+                        0644);
+    }
+    if (this->fd < 0) {
+        this->write_failed(errno);
+        return;
+    }
+    struct stat st;
+    std::uint64_t size = 0;
+    if (fstat(this->fd, &st) == 0)
+        size = static_cast<std::uint64_t>(st.st_size);
+    // the incomplete last block has to be rewritten with the new messages
+    this->offset = size / this->block_size * this->block_size;
+    this->used = static_cast<std::size_t>(size - this->offset);
+    this->dirty = false;
+    this->file_end = size;
+    this->pending_lines = 0;
+    if (this->used > 0) {
+        ssize_t n = pread(this->fd, this->buffer, this->block_size,
+                          static_cast<off_t>(this->offset));
+        if (n < static_cast<ssize_t>(this->used)) {
+            // never overwrite what we could not read, start a new block
+            this->offset += this->block_size;
+            this->used = 0;
+            this->file_end = this->offset;
+        }
+    }
+}
+
+void eal::SinkFileDirect::close_file()
+{
+    if (this->fd < 0)
+        return;
+    // last chance for the buffered lines and the report of dropped messages
+    if (this->degraded)
+        this->next_retry = std::chrono::steady_clock::now();
+    if (this->degraded ? !this->retry_writes() : !this->write_buffer()) {
+        this->dropped += this->pending_lines;
+        this->dropped_unreported += this->pending_lines;
+    }
+    // remove the padding of the last block and whatever a failed write left
+    // behind
+    if (ftruncate(this->fd, static_cast<off_t>(this->file_end)) != 0) {
+        // the messages are complete, only NUL bytes follow them
+        this->write_errors++;
+        this->last_error = errno;
+    }
+    close(this->fd);
+    this->fd = -1;
+    this->used = 0;
+    this->dirty = false;
+    this->pending_lines = 0;
+}
+
+bool eal::SinkFileDirect::write_buffer()
+{
+    this->last_write = std::chrono::steady_clock::now();
+    if (!this->dirty)
+        return true;
+    if (this->fd < 0)
+        return false;
+    std::size_t len = (this->used + this->block_size - 1) / this->block_size *
+                      this->block_size;
+    std::memset(this->buffer + this->used, 0, len - this->used);
+    std::size_t written = 0;
+    while (written < len) {
+        ssize_t n = pwrite(this->fd, this->buffer + written, len - written,
+                           static_cast<off_t>(this->offset + written));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // keep buffer and offset, the next attempt writes them again
+            this->write_failed(errno);
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    this->file_end = this->offset + this->used;
+    this->pending_lines = 0;
+    // keep the incomplete block at the start of the buffer
+    std::size_t full = this->used / this->block_size * this->block_size;
+    if (full > 0) {
+        std::memmove(this->buffer, this->buffer + full, this->used - full);
+        this->offset += full;
+        this->used -= full;
+    }
+    this->dirty = false;
+    return true;
+}
+
+#else
+
+void eal::SinkFileDirect::open_file() {}
+void eal::SinkFileDirect::close_file() {}
+bool eal::SinkFileDirect::write_buffer()
+{
+    this->dirty = false;
+    return true;
+}
+
+#endif
@@ -0,0 +1,362 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/sink_file_gzip.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "config.h"
+
+#ifdef EALOGGER_ZLIB
+#include <zlib.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+int open_append(const std::string &path)
+{
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+bool write_all(int fd, const char *data, std::size_t len)
+{
+    while (len > 0) {
+#ifdef _WIN32
+        int n = _write(fd, data, static_cast<unsigned int>(len));
+#else
+        ssize_t n = write(fd, data, len);
+#endif
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Append a frame, a partially written frame is cut off again
+ *
+ * @details
+ * A torn gzip member in the middle of the file would make every member
+ * behind it unreadable.
+ */
+bool write_frame(int fd, const char *data, std::size_t len)
+{
+#ifdef _WIN32
+    return write_all(fd, data, len);
+#else
+    off_t start = lseek(fd, 0, SEEK_END);
+    if (write_all(fd, data, len))
+        return true;
+    int err = errno;
+    if (start >= 0 && ftruncate(fd, start) != 0) {
+        // nothing else we can do, the error of the write is reported
+    }
+    errno = err;
+    return false;
+#endif
+}
+
+void close_fd(int fd)
+{
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+}
+
+const std::size_t eal::SinkFileGzip::max_pending_frames;
+const std::chrono::milliseconds eal::SinkFileGzip::retry_interval =
+    std::chrono::milliseconds(1000);
+
+eal::SinkFileGzip::SinkFileGzip(std::string msg_template,
+                                std::string datetime_pattern, bool enabled,
+                                con::LOG_LEVEL min_lvl, std::string log_file,
+                                const SinkFile::Options &options,
+                                int compression_level)
+    : eal::Sink(std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl),
+      frame_size(options.buffer_size),
+      flush_interval(options.flush_interval),
+      frame_start(std::chrono::steady_clock::now()),
+      fd(-1),
+      log_file(std::move(log_file)),
+      compression_level(compression_level),
+      degraded(false),
+      last_error(0),
+      write_errors(0),
+      dropped(0),
+      dropped_unreported(0),
+      compressing(false),
+      stop(false)
+{
+#ifndef EALOGGER_ZLIB
+    // the frames are written uncompressed, the name must not promise gzip
+    const std::string gz = ".gz";
+    if (this->log_file.size() > gz.size() &&
+        this->log_file.compare(this->log_file.size() - gz.size(), gz.size(),
+                               gz) == 0)
+        this->log_file.erase(this->log_file.size() - gz.size());
+#endif
+    this->frame.reserve(this->frame_size);
+    if (this->get_enabled()) {
+        this->open_file();
+    }
+    this->compressor = std::thread(&eal::SinkFileGzip::compress_loop, this);
+}
+
+eal::SinkFileGzip::~SinkFileGzip()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_frame);
+        this->submit_frame();
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_queue);
+        this->stop = true;
+        this->cond_queue.notify_one();
+    }
+    // the compressor writes all queued frames before it exits
+    this->compressor.join();
+    this->close_file();
+}
+
+void eal::SinkFileGzip::reopen()
+{
+    this->buffer_flush();
+    this->close_file();
+    if (this->get_enabled())
+        this->open_file();
+}
+
+eal::SinkStats eal::SinkFileGzip::get_stats()
+{
+    SinkStats stats;
+    std::lock_guard<std::mutex> lock(this->mtx_fd);
+    stats.degraded = this->degraded;
+    stats.write_errors = this->write_errors;
+    stats.messages_dropped = this->dropped;
+    stats.last_error = this->last_error;
+    return stats;
+}
+
+void eal::SinkFileGzip::write_message(const std::string &msg)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_frame);
+    if (this->frame.empty())
+        this->frame_start = std::chrono::steady_clock::now();
+    this->frame.append(msg);
+    this->frame.push_back('\n');
+    if (this->frame.size() >= this->frame_size ||
+        std::chrono::steady_clock::now() - this->frame_start >=
+            this->flush_interval)
+        this->submit_frame();
+}
+
+void eal::SinkFileGzip::buffer_tick()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_frame);
+    if (!this->frame.empty() &&
+        std::chrono::steady_clock::now() - this->frame_start >=
+            this->flush_interval)
+        this->submit_frame();
+}
+
+void eal::SinkFileGzip::buffer_flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx_frame);
+        this->submit_frame();
+    }
+    this->wait_frames();
+}
+
+void eal::SinkFileGzip::config_changed()
+{
+    // we can access enabled directly here because this is called from
+    // set_enabled and the coresponding mutex is already locked
+    if (!this->enabled) {
+        this->buffer_flush();
+        this->close_file();
+        return;
+    }
+    this->open_file();
+}
+
+void eal::SinkFileGzip::submit_frame()
+{
+    if (this->frame.empty())
+        return;
+    std::unique_lock<std::mutex> lock(this->mtx_queue);
+    this->cond_done.wait(lock, [this]() {
+        return this->frames.size() < eal::SinkFileGzip::max_pending_frames;
+    });
+    this->frames.push_back(std::move(this->frame));
+    this->cond_queue.notify_one();
+    lock.unlock();
+    this->frame = std::string();
+    this->frame.reserve(this->frame_size);
+}
+
+void eal::SinkFileGzip::wait_frames()
+{
+    std::unique_lock<std::mutex> lock(this->mtx_queue);
+    this->cond_done.wait(lock, [this]() {
+        return this->frames.empty() && !this->compressing;
+    });
+}
+
+void eal::SinkFileGzip::compress_loop()
+{
+#ifdef EALOGGER_ZLIB
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    // 15 + 16 selects the gzip wrapper, every reset starts a new member
+    bool zlib_ok = deflateInit2(&zs, this->compression_level, Z_DEFLATED,
+                                15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    std::string out;
+#endif
+    std::unique_lock<std::mutex> lock(this->mtx_queue);
+    while (true) {
+        this->cond_queue.wait(
+            lock, [this]() { return this->stop || !this->frames.empty(); });
+        if (this->frames.empty())
+            break;
+        std::string data = std::move(this->frames.front());
+        this->frames.pop_front();
+        this->compressing = true;
+        this->cond_done.notify_all();
+        lock.unlock();
+
+        std::uint64_t lines = static_cast<std::uint64_t>(
+            std::count(data.begin(), data.end(), '\n'));
+        {
+            std::lock_guard<std::mutex> fd_lock(this->mtx_fd);
+            // frames are dropped until the next attempt is due
+            bool due = !this->degraded ||
+                       std::chrono::steady_clock::now() >= this->next_retry;
+            if (!due) {
+                this->dropped += lines;
+                this->dropped_unreported += lines;
+            } else {
+                if (this->degraded) {
+                    if (this->fd < 0)
+                        this->fd = open_append(this->log_file);
+                    // the report is no message, it is not counted if it is
+                    // lost
+                    data.insert(0, "ealogger: " +
+                                       std::to_string(this->dropped_unreported) +
+                                       " messages dropped after write error: " +
+                                       std::strerror(this->last_error) + "\n");
+                }
+                const char *bytes = data.data();
+                std::size_t len = data.size();
+                int err = 0;
+#ifdef EALOGGER_ZLIB
+                // never write uncompressed data into a gzip file
+                err = EIO;
+                if (zlib_ok && deflateReset(&zs) == Z_OK) {
+                    out.resize(
+                        deflateBound(&zs, static_cast<uLong>(data.size())));
+                    zs.next_in = reinterpret_cast<Bytef *>(
+                        const_cast<char *>(data.data()));
+                    zs.avail_in = static_cast<uInt>(data.size());
+                    zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+                    zs.avail_out = static_cast<uInt>(out.size());
+                    if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+                        bytes = out.data();
+                        len = out.size() - zs.avail_out;
+                        err = 0;
+                    }
+                }
+#endif
+                if (err == 0 && this->fd < 0)
+                    err = this->last_error != 0 ? this->last_error : EBADF;
+                if (err == 0 && !write_frame(this->fd, bytes, len))
+                    err = errno;
+                if (err != 0) {
+                    this->write_failed(err, lines);
+                } else if (this->degraded) {
+                    this->degraded = false;
+                    this->dropped_unreported = 0;
+                }
+            }
+        }
+
+        lock.lock();
+        this->compressing = false;
+        this->cond_done.notify_all();
+    }
+#ifdef EALOGGER_ZLIB
+    if (zlib_ok)
+        deflateEnd(&zs);
+#endif
+}
+
+void eal::SinkFileGzip::open_file()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_fd);
+    if (this->fd >= 0)
+        return;
+    this->fd = open_append(this->log_file);
+    // frames are dropped and counted until the file can be opened
+    if (this->fd < 0)
+        this->write_failed(errno, 0);
+}
+
+void eal::SinkFileGzip::write_failed(int err, std::uint64_t lost)
+{
+    this->write_errors++;
+    this->last_error = err;
+    this->dropped += lost;
+    this->dropped_unreported += lost;
+    this->degraded = true;
+    this->next_retry = std::chrono::steady_clock::now() + retry_interval;
+}
+
+void eal::SinkFileGzip::close_file()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_fd);
+    if (this->fd >= 0) {
+        close_fd(this->fd);
+        this->fd = -1;
+    }
+}
@@ -0,0 +1,214 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/sink_file_mmap.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+eal::SinkFileMmap::SinkFileMmap(std::string msg_template,
+                                std::string datetime_pattern, bool enabled,
+                                con::LOG_LEVEL min_lvl, std::string log_file,
+                                std::size_t segment_size)
+    : eal::Sink(std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl),
+      log_file(std::move(log_file)),
+      segment_size(segment_size),
+      next_index(0)
+{
+#ifndef _WIN32
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    this->segment_size = std::max(page, (segment_size + page - 1) / page * page);
+#endif
+    if (this->get_enabled()) {
+        this->open_segments();
+    }
+}
+
+eal::SinkFileMmap::~SinkFileMmap() { this->close_segments(); }
+const std::chrono::milliseconds eal::SinkFileMmap::retry_interval =
+    std::chrono::milliseconds(1000);
+
+void eal::SinkFileMmap::reopen()
+{
+    if (!this->get_enabled())
+        return;
+    this->close_segments();
+    this->open_segments();
+}
+
+eal::SinkStats eal::SinkFileMmap::get_stats()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_segment);
+    SinkStats s = this->stats;
+    s.degraded = this->get_enabled() && !this->current.data;
+    return s;
+}
+
+void eal::SinkFileMmap::write_message(const std::string &msg)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_segment);
+    if (!this->current.data) {
+        // the segment could not be created, try again now and then
+        std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+        if (now < this->next_retry || !this->map_segment(this->current)) {
+            this->next_retry = std::max(this->next_retry, now + retry_interval);
+            this->stats.messages_dropped++;
+            return;
+        }
+        this->map_segment(this->spare);
+    }
+    // a line that does not fit a segment of its own is cut off
+    std::size_t len = std::min(msg.size(), this->segment_size - 1);
+    // every segment holds whole lines
+    if (this->current.used + len + 1 > this->segment_size) {
+        this->roll();
+        if (!this->current.data) {
+            this->stats.messages_dropped++;
+            return;
+        }
+    }
+    std::memcpy(this->current.data + this->current.used, msg.data(), len);
+    this->current.used += len;
+    this->current.data[this->current.used++] = '\n';
+}
+
+void eal::SinkFileMmap::config_changed()
+{
+    // we can access enabled directly here because this is called from
+    // set_enabled and the coresponding mutex is already locked
+    if (!this->enabled) {
+        this->close_segments();
+        return;
+    }
+    this->open_segments();
+}
+
+void eal::SinkFileMmap::open_segments()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_segment);
+    if (this->current.data)
+        return;
+    if (this->map_segment(this->current))
+        this->map_segment(this->spare);
+}
+
+void eal::SinkFileMmap::close_segments()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_segment);
+    this->unmap_segment(this->current);
+    // the prepared segment has never been used
+    if (this->spare.fd >= 0) {
+        std::string path = this->spare.path;
+        this->unmap_segment(this->spare);
+#ifndef _WIN32
+        unlink(path.c_str());
+#endif
+        this->next_index--;
+    }
+}
+
+void eal::SinkFileMmap::roll()
+{
+    this->unmap_segment(this->current);
+    std::swap(this->current, this->spare);
+    if (!this->current.data) {
+        // preparing the segment failed before, try again
+        if (!this->map_segment(this->current))
+            return;
+    }
+    this->map_segment(this->spare);
+}
+
+#ifndef _WIN32
+
+bool eal::SinkFileMmap::map_segment(Segment &seg)
+{
+    // do not overwrite segments of an earlier run
+    struct stat st;
+    std::string path;
+    do {
+        path = this->log_file + "." + std::to_string(this->next_index++);
+    } while (stat(path.c_str(), &st) == 0);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        this->stats.write_errors++;
+        this->stats.last_error = errno;
+        return false;
+    }
+    off_t size = static_cast<off_t>(this->segment_size);
+    int ret = -1;
+    errno = EOPNOTSUPP;
+#ifdef __linux__
+    ret = fallocate(fd, 0, 0, size);
+#endif
+    // only a file system without fallocate gets a sparse segment. On a full
+    // disk the first store into an unbacked page would raise SIGBUS
+    if (ret != 0 && (errno == EOPNOTSUPP || errno == ENOSYS))
+        ret = ftruncate(fd, size);
+    void *data = MAP_FAILED;
+    if (ret == 0)
+        data = mmap(nullptr, this->segment_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        this->stats.write_errors++;
+        this->stats.last_error = errno;
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+    seg.fd = fd;
+    seg.data = static_cast<char *>(data);
+    seg.used = 0;
+    seg.path = std::move(path);
+    return true;
+}
+
+void eal::SinkFileMmap::unmap_segment(Segment &seg)
+{
+    if (seg.data)
+        munmap(seg.data, this->segment_size);
+    if (seg.fd >= 0) {
+        // remove the preallocated tail. If that fails the tail stays NUL
+        // bytes like after a crash, the messages before it are intact
+        if (ftruncate(seg.fd, static_cast<off_t>(seg.used)) != 0) {
+            this->stats.write_errors++;
+            this->stats.last_error = errno;
+        }
+        close(seg.fd);
+    }
+    seg = Segment();
+}
+
+#else
+
+bool eal::SinkFileMmap::map_segment(Segment &) { return false; }
+void eal::SinkFileMmap::unmap_segment(Segment &seg) { seg = Segment(); }
+
+#endif
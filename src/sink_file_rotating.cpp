@@ -0,0 +1,185 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/sink_file_rotating.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#include <ealogger/utility.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+bool file_exists(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+eal::SinkFile::Options rotating_options(const eal::SinkFile::Options &options)
+{
+    eal::SinkFile::Options opts = options;
+    // the index would describe the file that was renamed
+    opts.index_block = 0;
+    return opts;
+}
+}
+
+eal::SinkFileRotating::SinkFileRotating(
+    std::string msg_template, std::string datetime_pattern, bool enabled,
+    con::LOG_LEVEL min_lvl, std::string log_file, std::uint64_t max_size,
+    std::chrono::seconds interval, std::size_t retention, NAMING naming,
+    const Options &options)
+    : eal::SinkFile(std::move(msg_template), std::move(datetime_pattern),
+                    enabled, min_lvl, std::move(log_file),
+                    rotating_options(options)),
+      max_size(max_size),
+      interval(interval),
+      retention(retention),
+      naming(naming),
+      period(-1),
+      rotations(0)
+{
+}
+
+eal::SinkFileRotating::~SinkFileRotating() {}
+std::uint64_t eal::SinkFileRotating::get_rotations()
+{
+    std::lock_guard<std::mutex> lock(this->mtx_file);
+    return this->rotations;
+}
+
+void eal::SinkFileRotating::prepare_append(std::size_t len)
+{
+    bool due = this->max_size > 0 && this->file_size > 0 &&
+               this->file_size + len + 1 > this->max_size;
+    if (this->interval.count() > 0) {
+        std::int64_t now = this->get_period(std::chrono::system_clock::now());
+        if (this->period < 0)
+            this->period = now;
+        if (now != this->period) {
+            this->period = now;
+            due = this->file_size > 0 || due;
+        }
+    }
+    if (due)
+        this->rotate();
+}
+
+void eal::SinkFileRotating::write_batch(const rendered_batch &lines)
+{
+    eal::Sink::write_batch(lines);
+}
+
+std::int64_t
+eal::SinkFileRotating::get_period(std::chrono::system_clock::time_point now)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               now.time_since_epoch())
+               .count() /
+           this->interval.count();
+}
+
+void eal::SinkFileRotating::rotate()
+{
+    this->close_file(false);
+    bool renamed = this->naming == NAMING::INDEX ? this->rotate_index()
+                                                 : this->rotate_datetime();
+    this->open_file(false);
+    if (renamed) {
+        this->rotations++;
+        if (this->naming == NAMING::DATETIME)
+            this->remove_expired();
+    } else {
+        // appending to the old file again, try the next rotation after
+        // another max_size bytes instead of on every message
+        this->file_size = 0;
+    }
+}
+
+bool eal::SinkFileRotating::rotate_index()
+{
+    std::size_t last = this->retention;
+    if (last == 0) {
+        // keep everything, find the oldest file that has to be shifted
+        last = 1;
+        while (file_exists(this->log_file + "." + std::to_string(last)))
+            last++;
+    } else {
+        std::remove((this->log_file + "." + std::to_string(last)).c_str());
+    }
+    for (std::size_t i = last; i > 1; i--) {
+        std::string from = this->log_file + "." + std::to_string(i - 1);
+        if (file_exists(from))
+            std::rename(from.c_str(),
+                        (this->log_file + "." + std::to_string(i)).c_str());
+    }
+    return std::rename(this->log_file.c_str(),
+                       (this->log_file + ".1").c_str()) == 0;
+}
+
+bool eal::SinkFileRotating::rotate_datetime()
+{
+    std::string target =
+        this->log_file + "." +
+        eal::utility::format_time_to_string("%Y%m%d-%H%M%S");
+    // more than one rotation per second
+    std::string name = target;
+    for (unsigned int i = 1; file_exists(name); i++)
+        name = target + "-" + std::to_string(i);
+    return std::rename(this->log_file.c_str(), name.c_str()) == 0;
+}
+
+void eal::SinkFileRotating::remove_expired()
+{
+#ifndef _WIN32
+    if (this->retention == 0)
+        return;
+    std::string dir = "";
+    std::string prefix = this->log_file + ".";
+    std::string::size_type slash = this->log_file.rfind('/');
+    if (slash != std::string::npos) {
+        dir = this->log_file.substr(0, slash + 1);
+        prefix = this->log_file.substr(slash + 1) + ".";
+    }
+    DIR *d = opendir(dir.empty() ? "." : dir.c_str());
+    if (d == nullptr)
+        return;
+    std::vector<std::string> files;
+    while (struct dirent *entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.size() > prefix.size() &&
+            name.compare(0, prefix.size(), prefix) == 0)
+            files.push_back(std::move(name));
+    }
+    closedir(d);
+    if (files.size() <= this->retention)
+        return;
+    // the timestamp format sorts chronologically
+    std::sort(files.begin(), files.end());
+    for (std::size_t i = 0; i < files.size() - this->retention; i++)
+        std::remove((dir + files[i]).c_str());
+#endif
+}
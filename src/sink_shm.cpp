@@ -0,0 +1,72 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <ealogger/sink_shm.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+namespace sr = ealogger::shm_ring;
+
+eal::SinkShm::SinkShm(std::string msg_template, std::string datetime_pattern,
+                      bool enabled, con::LOG_LEVEL min_lvl, std::string name,
+                      std::size_t capacity, ShmRing::FORMAT format)
+    : eal::Sink(std::move(msg_template), std::move(datetime_pattern), enabled,
+                min_lvl),
+      ring(std::move(name), capacity, format),
+      format(format),
+      sequence(0)
+{
+}
+
+eal::SinkStats eal::SinkShm::get_stats()
+{
+    SinkStats stats;
+    stats.degraded = !this->ring.is_valid();
+    stats.messages_dropped = this->ring.get_dropped();
+    return stats;
+}
+
+void eal::SinkShm::write_message(const std::string &msg)
+{
+    this->write_message(msg, con::LOG_LEVEL::EAL_INFO);
+}
+
+void eal::SinkShm::write_message(const std::string &msg, con::LOG_LEVEL lvl)
+{
+    std::string &r = this->record;
+    r.clear();
+    r.push_back(static_cast<char>(lvl));
+    r.append(msg);
+    this->ring.write(sr::RECORD::LINE, r.data(), r.size());
+}
+
+bool eal::SinkShm::drop_message() { return !this->ring.is_valid(); }
+bool eal::SinkShm::wants_log_messages() const
+{
+    return this->format == ShmRing::FORMAT::MESSAGES;
+}
+
+void eal::SinkShm::write_log_messages(
+    const std::vector<std::shared_ptr<LogMessage>> &messages)
+{
+    for (const auto &m : messages) {
+        this->record.clear();
+        sr::put_message(this->record, *m, this->sequence++);
+        this->ring.write(sr::RECORD::MESSAGE, this->record.data(),
+                         this->record.size());
+    }
+}
+
+void eal::SinkShm::config_changed() {}
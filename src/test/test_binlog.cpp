@@ -0,0 +1,277 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <ealogger/binlog_reader.h>
+#include <ealogger/sink_file_binary.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+/**
+ * @brief A sink that stores rendered messages in a vector
+ */
+class SinkLines : public eal::Sink
+{
+public:
+    SinkLines(std::string msg_template)
+        : eal::Sink(std::move(msg_template), "%F %T", true,
+                    con::LOG_LEVEL::EAL_DEBUG)
+    {
+    }
+
+    std::vector<std::string> lines;
+
+private:
+    void write_message(const std::string &msg) { this->lines.push_back(msg); }
+    void config_changed() {}
+};
+
+std::shared_ptr<eal::LogMessage> make_msg(con::LOG_LEVEL lvl, std::string msg,
+                                          int line)
+{
+    return std::make_shared<eal::LogMessage>(
+        lvl, std::move(msg), eal::LogMessage::LOGTYPE::DEFAULT, "/src/file.cpp",
+        line, "func");
+}
+}
+
+TEST_CASE("Binary log files render like live messages", "[binlog]")
+{
+    const std::string path = "ealogger_test_binlog.eal";
+    const std::string tmpl = "%d %s [%f:%l] %u %t %m";
+    std::remove(path.c_str());
+
+    std::vector<std::shared_ptr<eal::LogMessage>> batch;
+    for (int i = 0; i < 100; i++)
+        batch.push_back(make_msg(static_cast<con::LOG_LEVEL>(i % 5),
+                                 "message " + std::to_string(i), i % 7));
+    batch[42]->set_logger_name("child");
+
+    SinkLines live(tmpl);
+    live.prepare_log_batch(batch);
+    {
+        eal::SinkFileBinary sink(tmpl, "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                                 path);
+        sink.prepare_log_batch(batch);
+    }
+
+    eal::BinlogReader reader(path);
+    REQUIRE(reader.is_valid());
+    SinkLines decoded("%m");
+    std::shared_ptr<eal::LogMessage> m;
+    while (reader.next(m)) {
+        decoded.set_msg_template(reader.get_msg_template());
+        decoded.prepare_log_message(m);
+    }
+    REQUIRE(reader.is_valid());
+    REQUIRE(reader.get_sequence() == 99);
+    REQUIRE(reader.get_format_count() == 1);
+    REQUIRE(decoded.lines == live.lines);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Binary log reader follows a growing file", "[binlog]")
+{
+    const std::string path = "ealogger_test_binlog_follow.eal";
+    std::remove(path.c_str());
+
+    eal::SinkFileBinary sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                             path);
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "one", 1));
+    sink.flush();
+
+    eal::BinlogReader reader(path);
+    std::shared_ptr<eal::LogMessage> m;
+    REQUIRE(reader.next(m));
+    REQUIRE(m->get_message() == "one");
+    REQUIRE(!reader.next(m));
+    REQUIRE(!reader.refresh());
+
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "two", 2));
+    sink.flush();
+    REQUIRE(reader.refresh());
+    REQUIRE(reader.next(m));
+    REQUIRE(m->get_message() == "two");
+    REQUIRE(m->get_call_file_line() == 2);
+    REQUIRE(!reader.next(m));
+
+    // a replaced file is read from the beginning
+    sink.set_log_file(path + ".new");
+    std::rename((path + ".new").c_str(), path.c_str());
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "three", 3));
+    sink.flush();
+    REQUIRE(reader.refresh());
+    REQUIRE(reader.next(m));
+    REQUIRE(m->get_message() == "three");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Binary log reader starts over after a truncate", "[binlog]")
+{
+    const std::string path = "ealogger_test_binlog_truncate.eal";
+    std::remove(path.c_str());
+
+    eal::SinkFileBinary sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                             path);
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "one", 1));
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "two", 2));
+    sink.flush();
+
+    eal::BinlogReader reader(path);
+    std::shared_ptr<eal::LogMessage> m;
+    REQUIRE(reader.next(m));
+    REQUIRE(m->get_message() == "one");
+
+    // logrotate copytruncate, the unread message is gone
+    std::ofstream(path, std::ios::trunc);
+    REQUIRE(!reader.refresh());
+    REQUIRE(!reader.next(m));
+
+    sink.reopen();
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "three", 3));
+    sink.flush();
+    REQUIRE(reader.refresh());
+    REQUIRE(reader.next(m));
+    REQUIRE(m->get_message() == "three");
+    REQUIRE(m->get_call_file_line() == 3);
+    REQUIRE(!reader.next(m));
+    REQUIRE(reader.is_valid());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Binary log files with checksums recover from torn writes",
+          "[binlog]")
+{
+    const std::string path = "ealogger_test_binlog_crc.eal";
+    std::remove(path.c_str());
+
+    auto write = [&path](int first, int count, bool checksums) {
+        eal::SinkFile::Options options;
+        options.flush_lvl = con::LOG_LEVEL::EAL_FATAL;
+        eal::SinkFileBinary sink("%m", "%F %T", true,
+                                 con::LOG_LEVEL::EAL_DEBUG, path, options,
+                                 checksums);
+        for (int i = first; i < first + count; i++)
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO,
+                                              "message " + std::to_string(i),
+                                              i));
+    };
+    auto read_all = [&path](std::uint64_t &skipped) {
+        eal::BinlogReader reader(path);
+        std::vector<std::string> messages;
+        std::shared_ptr<eal::LogMessage> m;
+        while (reader.next(m))
+            messages.push_back(m->get_message());
+        REQUIRE(reader.is_valid());
+        skipped = reader.get_skipped();
+        return messages;
+    };
+    write(0, 100, true);
+
+    std::string content;
+    {
+        std::ifstream in(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+    }
+    std::size_t intact = content.size();
+    {
+        // half a record and the zeros a power loss leaves behind
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(content.data() + intact - 40, 20);
+        out.write(std::string(300, '\0').data(), 300);
+    }
+
+    // the sink follows the flags of the existing file
+    write(100, 1, false);
+    std::uint64_t skipped = 0;
+    std::vector<std::string> messages = read_all(skipped);
+    REQUIRE(skipped == 0);
+    REQUIRE(messages.size() == 102);
+    REQUIRE(messages[99] == "message 99");
+    REQUIRE(messages[100] == "ealogger: removed 320 bytes of a torn record "
+                             "at the end of " +
+                                 path);
+    REQUIRE(messages[101] == "message 100");
+
+    // a damaged record in the middle is skipped
+    {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        std::size_t pos = content.find("message 50");
+        REQUIRE(pos != std::string::npos);
+        f.seekp(static_cast<std::streamoff>(pos));
+        f.put('X');
+    }
+    messages = read_all(skipped);
+    REQUIRE(skipped > 0);
+    REQUIRE(messages.size() == 101);
+    REQUIRE(std::find(messages.begin(), messages.end(), "message 50") ==
+            messages.end());
+    REQUIRE(messages[50] == "message 51");
+    std::remove(path.c_str());
+
+    // files without checksums lose the incomplete record as well
+    write(0, 10, false);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x40\x00\x00\x00\x04garbage", 12);
+    }
+    write(10, 1, false);
+    messages = read_all(skipped);
+    REQUIRE(messages.size() == 12);
+    REQUIRE(messages.back() == "message 10");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Binary file sink does not write into other files", "[binlog]")
+{
+    const std::string path = "ealogger_test_binlog_foreign.log";
+    const std::string text = "plain text line one\nline two\n";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << text;
+    }
+    {
+        eal::SinkFileBinary sink("%m", "%F %T", true,
+                                 con::LOG_LEVEL::EAL_DEBUG, path);
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "one", 1));
+        // reopening does not change anything
+        sink.reopen();
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "two", 2));
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.last_error == EINVAL);
+        REQUIRE(stats.messages_dropped == 2);
+    }
+    std::ifstream in(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+    REQUIRE(content == text);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,111 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "catch.hpp"
+
+#include <ealogger/callsite.h>
+#include <ealogger/utility.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+TEST_CASE("Glob patterns", "[callsite]")
+{
+    REQUIRE(eal::utility::glob_match("*", "anything"));
+    REQUIRE(eal::utility::glob_match("net*.cpp", "net/http.cpp"));
+    REQUIRE(eal::utility::glob_match("h?tp", "http"));
+    REQUIRE(!eal::utility::glob_match("h?tp", "htp"));
+    REQUIRE(!eal::utility::glob_match("*.h", "file.cpp"));
+}
+
+TEST_CASE("Call site queries", "[callsite]")
+{
+    eal::CallSiteQuery query;
+    REQUIRE(query.matches("/src/main.cpp", "main", 10,
+                          con::LOG_LEVEL::EAL_DEBUG));
+
+    query.file_pattern = "net/*.cpp";
+    REQUIRE(query.matches("/home/me/src/net/http.cpp", "get", 1,
+                          con::LOG_LEVEL::EAL_DEBUG));
+    REQUIRE(!query.matches("/home/me/src/db/sql.cpp", "get", 1,
+                           con::LOG_LEVEL::EAL_DEBUG));
+
+    query.match_level = true;
+    query.level = con::LOG_LEVEL::EAL_INFO;
+    REQUIRE(!query.matches("/home/me/src/net/http.cpp", "get", 1,
+                           con::LOG_LEVEL::EAL_DEBUG));
+
+    query.func_pattern = "get";
+    query.line = 5;
+    REQUIRE(query.matches("/home/me/src/net/http.cpp", "get", 5,
+                          con::LOG_LEVEL::EAL_INFO));
+    REQUIRE(!query.matches("/home/me/src/net/http.cpp", "post", 5,
+                           con::LOG_LEVEL::EAL_INFO));
+}
+
+TEST_CASE("Call sites can be switched at runtime", "[callsite]")
+{
+    eal::CallSiteRegistry &registry = eal::CallSiteRegistry::instance();
+    static eal::CallSite first("test/callsite_a.cpp", 1,
+                               con::LOG_LEVEL::EAL_DEBUG);
+    static eal::CallSite second("test/callsite_a.cpp", 2,
+                                con::LOG_LEVEL::EAL_ERROR);
+
+    REQUIRE(first.is_enabled("func_a"));
+    REQUIRE(registry.set_enabled("callsite_a.cpp", false) == 1);
+    REQUIRE(!first.is_enabled("func_a"));
+
+    // the rule is applied to call sites that register later
+    REQUIRE(!second.is_enabled("func_b"));
+
+    REQUIRE(registry.set_enabled("callsite_a.cpp", con::LOG_LEVEL::EAL_ERROR,
+                                 true) == 1);
+    REQUIRE(!first.is_enabled("func_a"));
+    REQUIRE(second.is_enabled("func_b"));
+
+    bool found = false;
+    for (const auto &info : registry.get_call_sites()) {
+        if (info.file == "test/callsite_a.cpp" && info.line == 2) {
+            found = true;
+            REQUIRE(info.func == "func_b");
+            REQUIRE(info.enabled);
+        }
+    }
+    REQUIRE(found);
+
+    registry.set_enabled("callsite_a.cpp", true);
+    REQUIRE(first.is_enabled("func_a"));
+}
+
+TEST_CASE("Debug messages can be limited to some files", "[callsite]")
+{
+    eal::CallSiteRegistry &registry = eal::CallSiteRegistry::instance();
+    static eal::CallSite net("src/net/callsite_net.cpp", 1,
+                             con::LOG_LEVEL::EAL_DEBUG);
+    static eal::CallSite other("src/callsite_other.cpp", 1,
+                               con::LOG_LEVEL::EAL_DEBUG);
+    static eal::CallSite warning("src/callsite_other.cpp", 2,
+                                 con::LOG_LEVEL::EAL_WARNING);
+
+    registry.set_enabled("*", con::LOG_LEVEL::EAL_DEBUG, false);
+    registry.set_enabled("src/net*", con::LOG_LEVEL::EAL_DEBUG, true);
+    REQUIRE(net.is_enabled("func_net"));
+    REQUIRE(!other.is_enabled("func_other"));
+    REQUIRE(warning.is_enabled("func_other"));
+
+    // do not disable the debug call sites of other tests
+    registry.set_enabled("*", con::LOG_LEVEL::EAL_DEBUG, true);
+    REQUIRE(other.is_enabled("func_other"));
+}
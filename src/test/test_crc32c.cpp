@@ -0,0 +1,61 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+
+#include <cstdint>
+#include <string>
+
+#include "catch.hpp"
+
+#include <ealogger/crc32c.h>
+
+namespace eal = ealogger;
+
+namespace
+{
+/**
+ * @brief Bitwise CRC-32C as a reference
+ */
+std::uint32_t crc_reference(const std::string &data)
+{
+    std::uint32_t crc = 0xffffffff;
+    for (unsigned char c : data) {
+        crc ^= c;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0x82f63b78 & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+}
+
+TEST_CASE("CRC-32C matches the reference", "[crc32c]")
+{
+    REQUIRE(eal::crc32c::value("", 0) == 0);
+    REQUIRE(eal::crc32c::value("123456789", 9) == 0xe3069283);
+    std::string zeros(32, '\0');
+    REQUIRE(eal::crc32c::value(zeros.data(), zeros.size()) == 0x8a9136aa);
+
+    std::string data;
+    for (int i = 0; i < 200; i++) {
+        // every length and alignment of the tail
+        REQUIRE(eal::crc32c::value(data.data(), data.size()) ==
+                crc_reference(data));
+        data.push_back(static_cast<char>(i * 37 + 11));
+    }
+    std::uint32_t first = eal::crc32c::value(data.data(), 77);
+    REQUIRE(eal::crc32c::extend(first, data.data() + 77, data.size() - 77) ==
+            crc_reference(data));
+}
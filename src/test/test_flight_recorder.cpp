@@ -0,0 +1,220 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ealogger/ealogger.h>
+#include <ealogger/flight_recorder.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+/**
+ * @brief A sink that stores rendered messages in a vector
+ */
+class SinkLines : public eal::Sink
+{
+public:
+    SinkLines(con::LOG_LEVEL min_lvl)
+        : eal::Sink("%s %m", "%F %T", true, min_lvl)
+    {
+    }
+
+    std::vector<std::string> lines;
+
+private:
+    void write_message(const std::string &msg) { this->lines.push_back(msg); }
+    void config_changed() {}
+};
+
+std::vector<std::string> recover(const std::string &path,
+                                 std::uint64_t &skipped,
+                                 std::uint64_t max_bytes = 0)
+{
+    std::vector<std::shared_ptr<eal::LogMessage>> messages;
+    REQUIRE(eal::FlightRecorder::recover(path, messages, skipped, max_bytes));
+    std::vector<std::string> texts;
+    for (const auto &m : messages)
+        texts.push_back(m->get_message());
+    return texts;
+}
+}
+
+TEST_CASE("Flight recorder keeps the newest messages of every level",
+          "[recorder]")
+{
+    const std::string path = "ealogger_test_recorder.rec";
+    std::remove(path.c_str());
+    std::remove((path + eal::FlightRecorder::previous_suffix).c_str());
+    std::shared_ptr<SinkLines> sink =
+        std::make_shared<SinkLines>(con::LOG_LEVEL::EAL_ERROR);
+    {
+        eal::Logger logger(true);
+        logger.add_sink("lines", sink);
+        REQUIRE_FALSE(logger.will_write(con::LOG_LEVEL::EAL_DEBUG));
+        logger.init_flight_recorder(path, 64 * 1024);
+        REQUIRE(logger.will_write(con::LOG_LEVEL::EAL_DEBUG));
+        for (int i = 0; i < 5000; i++) {
+            std::string msg = "message " + std::to_string(i) +
+                              std::string(static_cast<std::size_t>(i % 50), 'x');
+            if (i % 1000 == 999)
+                logger.eal_error(msg);
+            else
+                logger.eal_debug(msg);
+        }
+    }
+    // the sink got only the errors
+    REQUIRE(sink->lines.size() == 5);
+
+    std::uint64_t skipped = 0;
+    std::vector<std::string> texts = recover(path, skipped);
+    REQUIRE(skipped == 0);
+    // the ring wrapped, it holds an unbroken sequence up to the last message
+    REQUIRE(texts.size() > 100);
+    REQUIRE(texts.size() < 5000);
+    int first = 5000 - static_cast<int>(texts.size());
+    for (std::size_t i = 0; i < texts.size(); i++) {
+        int n = first + static_cast<int>(i);
+        REQUIRE(texts[i] == "message " + std::to_string(n) +
+                                std::string(static_cast<std::size_t>(n % 50),
+                                            'x'));
+    }
+
+    std::vector<std::string> last = recover(path, skipped, 4096);
+    REQUIRE(skipped == 0);
+    REQUIRE(last.size() < texts.size() / 4);
+    REQUIRE(last.back() == texts.back());
+
+    // a new process keeps the file of the last one
+    {
+        eal::FlightRecorder recorder(path, 64 * 1024,
+                                     con::LOG_LEVEL::EAL_DEBUG);
+        REQUIRE(recorder.is_valid());
+        REQUIRE_FALSE(recorder.previous_crashed());
+    }
+    REQUIRE(recover(path + eal::FlightRecorder::previous_suffix, skipped) ==
+            texts);
+    REQUIRE(recover(path, skipped).empty());
+    std::remove(path.c_str());
+    std::remove((path + eal::FlightRecorder::previous_suffix).c_str());
+}
+
+TEST_CASE("Flight recorder records from many threads", "[recorder]")
+{
+    const std::string path = "ealogger_test_recorder_threads.rec";
+    std::remove(path.c_str());
+    const int threads = 4;
+    const int count = 20000;
+    {
+        // the ring does not wrap, late copies can not tear newer records
+        eal::FlightRecorder recorder(path, 16 * 1024 * 1024,
+                                     con::LOG_LEVEL::EAL_DEBUG);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&recorder, t, count]() {
+                for (int i = 0; i < count; i++) {
+                    eal::LogMessage m(con::LOG_LEVEL::EAL_INFO,
+                                      std::to_string(t) + " " +
+                                          std::to_string(i),
+                                      eal::LogMessage::LOGTYPE::DEFAULT,
+                                      "file.cpp", i, "func");
+                    recorder.record(m);
+                }
+            });
+        }
+        for (auto &w : workers)
+            w.join();
+    }
+    std::uint64_t skipped = 0;
+    std::vector<std::string> texts = recover(path, skipped);
+    REQUIRE(skipped == 0);
+    REQUIRE(texts.size() == threads * count);
+    // the messages of every thread are in order
+    std::vector<int> next(threads, -1);
+    for (const auto &text : texts) {
+        int t = std::stoi(text.substr(0, 1));
+        int i = std::stoi(text.substr(2));
+        REQUIRE(i == next[t] + 1);
+        next[t] = i;
+    }
+    for (int t = 0; t < threads; t++)
+        REQUIRE(next[t] == count - 1);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Flight recorder of a crashed process is recovered", "[recorder]")
+{
+    const std::string path = "ealogger_test_recorder_crash.rec";
+    const std::string previous = path + eal::FlightRecorder::previous_suffix;
+    std::remove(path.c_str());
+    std::remove(previous.c_str());
+
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+        eal::Logger logger(true);
+        logger.init_flight_recorder(path, 64 * 1024);
+        for (int i = 0; i < 100; i++)
+            logger.eal_debug("before the crash " + std::to_string(i));
+        // no destructor runs
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    std::shared_ptr<SinkLines> sink =
+        std::make_shared<SinkLines>(con::LOG_LEVEL::EAL_DEBUG);
+    {
+        eal::Logger logger(false);
+        logger.add_sink("lines", sink);
+        logger.init_flight_recorder(path, 64 * 1024, con::LOG_LEVEL::EAL_DEBUG,
+                                    1024 * 1024);
+    }
+    REQUIRE(sink->lines.size() == 101);
+    REQUIRE(sink->lines[0] ==
+            "WARNING ealogger: the previous process did not shut down "
+            "cleanly, its flight recorder was kept in " +
+                previous);
+    REQUIRE(sink->lines[1] == "DEBUG before the crash 0");
+    REQUIRE(sink->lines[100] == "DEBUG before the crash 99");
+
+    // a torn record is skipped, the others are intact
+    {
+        std::fstream f(previous,
+                       std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(static_cast<std::streamoff>(eal::FlightRecorder::header_size +
+                                            1000));
+        f.write("garbage", 7);
+    }
+    std::uint64_t skipped = 0;
+    std::vector<std::string> texts = recover(previous, skipped);
+    REQUIRE(skipped > 0);
+    REQUIRE(texts.size() == 99);
+    REQUIRE(texts.back() == "before the crash 99");
+    std::remove(path.c_str());
+    std::remove(previous.c_str());
+}
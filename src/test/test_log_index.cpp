@@ -0,0 +1,203 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <ealogger/binlog_reader.h>
+#include <ealogger/log_index.h>
+#include <ealogger/sink_file_binary.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+std::shared_ptr<eal::LogMessage> make_msg(
+    con::LOG_LEVEL lvl, std::string msg,
+    std::chrono::system_clock::time_point t)
+{
+    auto m = std::make_shared<eal::LogMessage>(
+        lvl, std::move(msg), eal::LogMessage::LOGTYPE::DEFAULT, "/src/file.cpp",
+        1, "func");
+    m->set_time(t);
+    return m;
+}
+
+/**
+ * @brief Decode the matching messages in \p ranges
+ *
+ * @details
+ * \p decoded counts every message that was decoded
+ */
+std::vector<std::string> read_ranges(
+    eal::BinlogReader &reader, const std::vector<eal::LogIndex::Range> &ranges,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to, con::LOG_LEVEL min_lvl,
+    int &decoded)
+{
+    std::vector<std::string> found;
+    std::shared_ptr<eal::LogMessage> m;
+    for (const auto &r : ranges) {
+        reader.seek(r.begin);
+        while (reader.get_offset() < r.end && reader.next(m)) {
+            decoded++;
+            if (m->get_time() >= from && m->get_time() < to &&
+                m->get_severity() >= min_lvl)
+                found.push_back(m->get_message());
+        }
+    }
+    return found;
+}
+}
+
+TEST_CASE("Binary log index finds time ranges and errors", "[index]")
+{
+    const std::string path = "ealogger_test_index.eal";
+    std::remove(path.c_str());
+    std::remove((path + eal::LogIndex::suffix).c_str());
+
+    const auto t0 = std::chrono::system_clock::now();
+    {
+        eal::SinkFile::Options options;
+        options.buffer_size = 1024 * 1024;
+        options.flush_lvl = con::LOG_LEVEL::EAL_FATAL;
+        options.index_block = 4096;
+        eal::SinkFileBinary sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                                 path, options);
+        std::vector<std::shared_ptr<eal::LogMessage>> batch;
+        for (int i = 0; i < 2000; i++) {
+            batch.push_back(make_msg(i % 500 == 250 ? con::LOG_LEVEL::EAL_ERROR
+                                                    : con::LOG_LEVEL::EAL_INFO,
+                                     "message " + std::to_string(i),
+                                     t0 + std::chrono::seconds(i)));
+        }
+        sink.prepare_log_batch(batch);
+    }
+
+    eal::LogIndex index(path);
+    REQUIRE(index.is_valid());
+    REQUIRE(index.size() > 20);
+    REQUIRE(index.get(0).offset == 0);
+    REQUIRE(index.get(0).first_ns ==
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                t0.time_since_epoch())
+                .count());
+
+    eal::BinlogReader reader(path);
+    int decoded = 0;
+    auto from = t0 + std::chrono::seconds(1000);
+    auto to = t0 + std::chrono::seconds(1100);
+    std::vector<std::string> found =
+        read_ranges(reader, index.query(from, to, con::LOG_LEVEL::EAL_DEBUG),
+                    from, to, con::LOG_LEVEL::EAL_DEBUG, decoded);
+    REQUIRE(found.size() == 100);
+    REQUIRE(found.front() == "message 1000");
+    REQUIRE(found.back() == "message 1099");
+    // only the blocks around the range are decoded
+    REQUIRE(decoded < 300);
+
+    decoded = 0;
+    auto all_from = std::chrono::system_clock::time_point::min();
+    auto all_to = std::chrono::system_clock::time_point::max();
+    found = read_ranges(
+        reader, index.query(all_from, all_to, con::LOG_LEVEL::EAL_ERROR),
+        all_from, all_to, con::LOG_LEVEL::EAL_ERROR, decoded);
+    REQUIRE(found == std::vector<std::string>({"message 250", "message 750",
+                                               "message 1250",
+                                               "message 1750"}));
+    REQUIRE(decoded < 500);
+
+    // without an index the whole file is returned
+    std::remove((path + eal::LogIndex::suffix).c_str());
+    eal::LogIndex missing(path);
+    REQUIRE(!missing.is_valid());
+    std::vector<eal::LogIndex::Range> ranges =
+        missing.query(all_from, all_to, con::LOG_LEVEL::EAL_ERROR);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].begin == 0);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Text log index finds time ranges and errors", "[index]")
+{
+    const std::string path = "ealogger_test_index.log";
+    std::remove(path.c_str());
+    std::remove((path + eal::LogIndex::suffix).c_str());
+
+    const auto t0 = std::chrono::system_clock::now();
+    {
+        eal::SinkFile::Options options;
+        options.flush_lvl = con::LOG_LEVEL::EAL_FATAL;
+        options.index_block = 1024;
+        eal::SinkFile sink("%s %m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                           path, options);
+        std::vector<std::shared_ptr<eal::LogMessage>> batch;
+        for (int i = 0; i < 1000; i++) {
+            batch.push_back(make_msg(i == 600 ? con::LOG_LEVEL::EAL_ERROR
+                                              : con::LOG_LEVEL::EAL_INFO,
+                                     "message " + std::to_string(i),
+                                     t0 + std::chrono::seconds(i)));
+        }
+        sink.prepare_log_batch(batch);
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+    eal::LogIndex index(path);
+    REQUIRE(index.is_valid());
+    // the last block is written when the file is closed
+    eal::LogIndex::Entry last = index.get(index.size() - 1);
+    REQUIRE(last.offset + last.bytes == content.size());
+    // the blocks hold the timestamps of the messages
+    REQUIRE(index.get(0).first_ns ==
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                t0.time_since_epoch())
+                .count());
+    std::vector<eal::LogIndex::Range> ranges =
+        index.query(t0 + std::chrono::seconds(500),
+                    t0 + std::chrono::seconds(501), con::LOG_LEVEL::EAL_DEBUG);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(content.substr(ranges[0].begin, ranges[0].end - ranges[0].begin)
+                .find("INFO message 500\n") != std::string::npos);
+    REQUIRE(ranges[0].end - ranges[0].begin < 2400);
+
+    ranges =
+        index.query(std::chrono::system_clock::time_point::min(),
+                    std::chrono::system_clock::time_point::max(),
+                    con::LOG_LEVEL::EAL_ERROR);
+    REQUIRE(ranges.size() == 2);
+    std::string block =
+        content.substr(ranges[0].begin, ranges[0].end - ranges[0].begin);
+    REQUIRE(block.size() < 1200);
+    // blocks start and end with whole lines
+    REQUIRE(content[ranges[0].begin - 1] == '\n');
+    REQUIRE(block.back() == '\n');
+    REQUIRE(block.find("ERROR message 600\n") != std::string::npos);
+    // the unindexed end of the file is always part of the result
+    REQUIRE(ranges[1].begin == content.size());
+    std::remove(path.c_str());
+    std::remove((path + eal::LogIndex::suffix).c_str());
+}
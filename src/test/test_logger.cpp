@@ -0,0 +1,488 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <ealogger/ealogger.h>
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+/**
+ * @brief A user defined sink that keeps the LogMessage objects
+ */
+class SinkCollect : public eal::Sink
+{
+public:
+    SinkCollect() : eal::Sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_INFO) {}
+
+    std::vector<std::string> lines;
+    std::vector<std::string> messages;
+    std::size_t batches = 0;
+    bool raw = false;
+
+    /**
+     * @brief Copy of the lines while an asynchronous Logger may still write
+     */
+    std::vector<std::string> get_lines()
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        return this->lines;
+    }
+
+private:
+    std::mutex mtx;
+
+    void write_message(const std::string &msg)
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->lines.push_back(msg);
+    }
+    void config_changed() {}
+    bool wants_log_messages() const { return this->raw; }
+    void write_log_messages(
+        const std::vector<std::shared_ptr<eal::LogMessage>> &msgs)
+    {
+        this->batches++;
+        for (const auto &m : msgs)
+            this->messages.push_back(m->get_message());
+    }
+};
+
+/**
+ * @brief A sink that holds its lines until it is flushed and counts how often
+ * the Logger calls it
+ */
+class SinkHeld : public eal::Sink
+{
+public:
+    SinkHeld() : eal::Sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_INFO)
+    {
+        this->calls.store(0);
+    }
+
+    std::atomic<int> calls;
+    std::vector<std::string> held;
+    std::vector<std::string> written;
+
+private:
+    void write_message(const std::string &msg)
+    {
+        this->calls++;
+        this->held.push_back(msg);
+    }
+    void buffer_tick() { this->calls++; }
+    void buffer_flush()
+    {
+        this->calls++;
+        this->written.insert(this->written.end(), this->held.begin(),
+                             this->held.end());
+        this->held.clear();
+    }
+    void config_changed() {}
+};
+
+/**
+ * @brief One rate limited call site shared by all Loggers of a test
+ */
+void warn_first_two(eal::Logger &logger, int i)
+{
+    logger.eal_warn_first_n(2, "first " + std::to_string(i));
+}
+}
+
+TEST_CASE("Child loggers inherit levels", "[logger]")
+{
+    eal::Logger logger(false);
+    eal::ChildLogger &http = logger.get("net.http");
+    eal::ChildLogger &net = logger.get("net");
+
+    SECTION("Ancestors are created and names are hierarchical")
+    {
+        REQUIRE(http.get_name() == "net.http");
+        REQUIRE(&http.get("client") == &logger.get("net.http.client"));
+        REQUIRE(&logger.get("net.http") == &http);
+    }
+
+    SECTION("Levels propagate to children without an explicit level")
+    {
+        logger.set_level(con::LOG_LEVEL::EAL_WARNING);
+        REQUIRE(!http.is_enabled(con::LOG_LEVEL::EAL_INFO));
+        REQUIRE(http.is_enabled(con::LOG_LEVEL::EAL_ERROR));
+
+        logger.set_level("net", con::LOG_LEVEL::EAL_DEBUG);
+        REQUIRE(http.is_enabled(con::LOG_LEVEL::EAL_DEBUG));
+        REQUIRE(!logger.is_enabled(con::LOG_LEVEL::EAL_DEBUG));
+
+        http.set_level(con::LOG_LEVEL::EAL_ERROR);
+        logger.set_level("net", con::LOG_LEVEL::EAL_INFO);
+        REQUIRE(net.get_level() == con::LOG_LEVEL::EAL_INFO);
+        REQUIRE(http.get_level() == con::LOG_LEVEL::EAL_ERROR);
+
+        http.reset_level();
+        REQUIRE(http.get_level() == con::LOG_LEVEL::EAL_INFO);
+        net.reset_level();
+        REQUIRE(http.get_level() == con::LOG_LEVEL::EAL_WARNING);
+    }
+
+    SECTION("Children created later inherit the current level")
+    {
+        logger.set_level("net", con::LOG_LEVEL::EAL_FATAL);
+        REQUIRE(logger.get("net.dns").get_level() == con::LOG_LEVEL::EAL_FATAL);
+    }
+}
+
+TEST_CASE("Message arguments are evaluated lazily", "[logger]")
+{
+    eal::Logger logger(false);
+    int evaluated = 0;
+    auto expensive = [&evaluated]() -> std::string {
+        evaluated++;
+        return "dump";
+    };
+
+    SECTION("Nothing is evaluated without a sink")
+    {
+        logger.eal_error(expensive());
+        logger.eal_error_stream("state " << expensive());
+        REQUIRE(evaluated == 0);
+    }
+
+    SECTION("Messages below all sink levels are not evaluated")
+    {
+        logger.init_console_sink(true, con::LOG_LEVEL::EAL_FATAL);
+        REQUIRE(logger.will_write(con::LOG_LEVEL::EAL_FATAL));
+        REQUIRE(!logger.will_write(con::LOG_LEVEL::EAL_ERROR));
+        logger.eal_debug(expensive());
+        logger.get("net").eal_info_stream(expensive() << 42);
+        logger.eal_warn_every_n(1, expensive());
+        REQUIRE(evaluated == 0);
+
+        logger.set_enabled(con::LOGGER_SINK::EAL_CONSOLE, false);
+        REQUIRE(!logger.will_write(con::LOG_LEVEL::EAL_FATAL));
+        logger.set_enabled(con::LOGGER_SINK::EAL_CONSOLE, true);
+        logger.set_backtrace(con::LOGGER_SINK::EAL_CONSOLE, 8);
+        REQUIRE(logger.will_write(con::LOG_LEVEL::EAL_DEBUG));
+    }
+
+    SECTION("Messages dropped by the level sampler are not evaluated")
+    {
+        std::shared_ptr<SinkCollect> sink = std::make_shared<SinkCollect>();
+        logger.add_sink("lines", sink);
+        logger.set_sampling(con::LOG_LEVEL::EAL_INFO,
+                            eal::Sampler::SAMPLE_TYPE::ONE_IN_N, 1000);
+        for (int i = 0; i < 10000; i++) {
+            logger.eal_info(expensive());
+            logger.get("net").eal_info_stream(expensive() << i);
+            logger.eal_info_every_n(1, expensive());
+        }
+        eal::SampleStats stats =
+            logger.get_sample_stats(con::LOG_LEVEL::EAL_INFO);
+        REQUIRE(stats.seen == 30000);
+        REQUIRE(static_cast<std::uint64_t>(evaluated) == stats.emitted);
+        REQUIRE(sink->lines.size() == stats.emitted);
+        REQUIRE(evaluated < 100);
+    }
+
+    SECTION("Stream expressions are formatted on demand")
+    {
+        REQUIRE(EAL_STREAM("id " << 7 << '/' << expensive())() == "id 7/dump");
+        REQUIRE(evaluated == 1);
+    }
+}
+
+TEST_CASE("Group commit returns after errors are written", "[logger]")
+{
+    const std::string path = "ealogger_test_logger_commit.log";
+    std::remove(path.c_str());
+    {
+        eal::Logger logger(true);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        eal::SinkFile::Options options;
+        options.flush_interval = std::chrono::milliseconds(60000);
+        options.durability = eal::SinkFile::DURABILITY::GROUP_COMMIT;
+        logger.init_file_sink(true, con::LOG_LEVEL::EAL_DEBUG, "%m", "%F %T",
+                              path, options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&logger, t]() {
+                for (int i = 0; i < 50; i++)
+                    logger.write_log("info " + std::to_string(t),
+                                     con::LOG_LEVEL::EAL_INFO);
+                logger.write_log("error " + std::to_string(t),
+                                 con::LOG_LEVEL::EAL_ERROR);
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        // all errors and the messages logged before them are on disk
+        std::ifstream in(path);
+        std::string line;
+        int lines = 0;
+        while (std::getline(in, line))
+            lines++;
+        REQUIRE(lines == 4 * 51);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Named sinks write to separate files", "[logger]")
+{
+    const std::string all = "ealogger_test_logger_all.log";
+    const std::string errors = "ealogger_test_logger_errors.log";
+    std::remove(all.c_str());
+    std::remove(errors.c_str());
+    {
+        eal::Logger logger(false);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        eal::SinkHandle all_sink =
+            logger.add_file_sink("all", all, con::LOG_LEVEL::EAL_DEBUG, "%m");
+        eal::SinkHandle error_sink =
+            logger.add_file_sink("errors", errors, con::LOG_LEVEL::EAL_ERROR,
+                                 "%s: %m");
+        REQUIRE(logger.get_sink("errors").get_name() == "errors");
+        REQUIRE(!logger.get_sink("audit").is_valid());
+
+        logger.write_log("debug", con::LOG_LEVEL::EAL_DEBUG);
+        logger.write_log("error", con::LOG_LEVEL::EAL_ERROR);
+        error_sink.set_min_lvl(con::LOG_LEVEL::EAL_WARNING);
+        logger.write_log("warning", con::LOG_LEVEL::EAL_WARNING);
+
+        REQUIRE(logger.remove_sink("all"));
+        REQUIRE(!logger.remove_sink("all"));
+        logger.write_log("removed", con::LOG_LEVEL::EAL_ERROR);
+        REQUIRE(all_sink.is_valid());
+    }
+    std::ifstream all_file(all);
+    std::string content((std::istreambuf_iterator<char>(all_file)),
+                        std::istreambuf_iterator<char>());
+    REQUIRE(content == "debug\nerror\nwarning\n");
+    std::ifstream error_file(errors);
+    content.assign(std::istreambuf_iterator<char>(error_file),
+                   std::istreambuf_iterator<char>());
+    REQUIRE(content == "ERROR: error\nWARNING: warning\nERROR: removed\n");
+    std::remove(all.c_str());
+    std::remove(errors.c_str());
+}
+
+TEST_CASE("Removed sinks are flushed and not called again", "[logger]")
+{
+    std::shared_ptr<SinkHeld> sink = std::make_shared<SinkHeld>();
+    {
+        eal::Logger logger(true);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        REQUIRE(logger.add_sink("held", sink).is_valid());
+        std::atomic<bool> stop(false);
+        std::thread writer([&logger, &stop]() {
+            while (!stop.load())
+                logger.write_log("message", con::LOG_LEVEL::EAL_INFO);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE(logger.remove_sink("held"));
+        int calls = sink->calls.load();
+        REQUIRE(sink->held.empty());
+        REQUIRE(!sink->written.empty());
+        // the background thread keeps dispatching to the remaining sinks
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stop.store(true);
+        writer.join();
+        REQUIRE(sink->calls.load() == calls);
+    }
+    REQUIRE(sink->held.empty());
+}
+
+TEST_CASE("User defined sinks get lines or LogMessage objects", "[logger]")
+{
+    std::shared_ptr<SinkCollect> lines = std::make_shared<SinkCollect>();
+    std::shared_ptr<SinkCollect> raw = std::make_shared<SinkCollect>();
+    raw->raw = true;
+    {
+        eal::Logger logger(true);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        REQUIRE(logger.add_sink("lines", lines).is_valid());
+        REQUIRE(logger.add_sink("raw", raw).is_valid());
+        REQUIRE(!logger.add_sink("empty", nullptr).is_valid());
+
+        logger.write_log("debug", con::LOG_LEVEL::EAL_DEBUG);
+        for (int i = 0; i < 100; i++)
+            logger.write_log("info " + std::to_string(i),
+                             con::LOG_LEVEL::EAL_INFO);
+        logger.write_log("error", con::LOG_LEVEL::EAL_ERROR);
+    }
+    REQUIRE(lines->lines.size() == 101);
+    REQUIRE(lines->lines.front() == "info 0");
+    REQUIRE(lines->lines.back() == "error");
+    REQUIRE(lines->messages.empty());
+    REQUIRE(raw->lines.empty());
+    REQUIRE(raw->messages.size() == 101);
+    REQUIRE(raw->messages.front() == "info 0");
+    REQUIRE(raw->messages.back() == "error");
+    REQUIRE(raw->batches <= raw->messages.size());
+}
+
+TEST_CASE("Log levels can be sampled", "[logger]")
+{
+    std::shared_ptr<SinkCollect> sink = std::make_shared<SinkCollect>();
+    eal::Logger logger(false);
+    logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+    logger.add_sink("lines", sink);
+    logger.set_sampling(con::LOG_LEVEL::EAL_INFO,
+                        eal::Sampler::SAMPLE_TYPE::ONE_IN_N, 10);
+    for (int i = 0; i < 10000; i++) {
+        logger.eal_info("info");
+        logger.eal_error("error");
+    }
+    eal::SampleStats stats = logger.get_sample_stats(con::LOG_LEVEL::EAL_INFO);
+    REQUIRE(stats.seen == 10000);
+    REQUIRE(stats.emitted > 800);
+    REQUIRE(stats.emitted < 1200);
+    // other levels are not sampled
+    REQUIRE(sink->lines.size() == stats.emitted + 10000);
+    REQUIRE(logger.get_sample_stats(con::LOG_LEVEL::EAL_ERROR).seen == 0);
+
+    logger.set_sampling(con::LOG_LEVEL::EAL_INFO,
+                        eal::Sampler::SAMPLE_TYPE::NONE, 0);
+    sink->lines.clear();
+    for (int i = 0; i < 100; i++)
+        logger.eal_info("info");
+    REQUIRE(sink->lines.size() == 100);
+    REQUIRE(logger.get_sample_stats(con::LOG_LEVEL::EAL_INFO).seen == 10000);
+}
+
+TEST_CASE("Rate limited call sites report suppressed messages", "[logger]")
+{
+    std::shared_ptr<SinkCollect> sink = std::make_shared<SinkCollect>();
+
+    SECTION("A synchronous Logger reports on destruction")
+    {
+        {
+            eal::Logger logger(false);
+            logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+            logger.add_sink("lines", sink);
+            for (int i = 0; i < 10; i++)
+                logger.eal_warn_first_n(2, "first " + std::to_string(i));
+            REQUIRE(sink->lines.size() == 2);
+        }
+        REQUIRE(sink->lines.size() == 3);
+        REQUIRE(sink->lines.back() == "Rate limit suppressed 8 messages");
+    }
+
+    SECTION("The background thread reports call sites that went quiet")
+    {
+        eal::Logger logger(true);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        logger.add_sink("lines", sink);
+        for (int i = 0; i < 10; i++)
+            logger.eal_error_first_n(1, "first " + std::to_string(i));
+        std::vector<std::string> lines;
+        for (int i = 0; i < 100 && lines.size() < 2; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            lines = sink->get_lines();
+        }
+        REQUIRE(lines.size() == 2);
+        REQUIRE(lines[0] == "first 0");
+        REQUIRE(lines[1] == "Rate limit suppressed 9 messages");
+    }
+
+    SECTION("A synchronous Logger reports while it writes other messages")
+    {
+        eal::Logger logger(false);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        logger.add_sink("lines", sink);
+        for (int i = 0; i < 10; i++)
+            logger.eal_error_first_n(1, "first " + std::to_string(i));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        logger.write_log("other", con::LOG_LEVEL::EAL_INFO);
+        REQUIRE(sink->lines.size() == 3);
+        REQUIRE(sink->lines[2] == "Rate limit suppressed 9 messages");
+    }
+
+    SECTION("Every Logger registers the call sites it suppresses")
+    {
+        std::shared_ptr<SinkCollect> other = std::make_shared<SinkCollect>();
+        eal::Logger first(false);
+        first.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        first.add_sink("lines", sink);
+        for (int i = 0; i < 3; i++)
+            warn_first_two(first, i);
+        {
+            eal::Logger second(false);
+            second.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+            second.add_sink("lines", other);
+            for (int i = 3; i < 5; i++)
+                warn_first_two(second, i);
+        }
+        // the call site does not pass again, only the reports of the second
+        // Logger tell about its messages. They include the one suppressed
+        // message of the first Logger that was not reported yet.
+        REQUIRE(!other->lines.empty());
+        std::uint64_t reported = 0;
+        const std::string prefix = "Rate limit suppressed ";
+        for (const auto &line : other->lines) {
+            REQUIRE(line.compare(0, prefix.size(), prefix) == 0);
+            reported += std::stoull(line.substr(prefix.size()));
+        }
+        REQUIRE(reported == 3);
+    }
+}
+
+#ifdef __linux__
+TEST_CASE("SIGUSR1 reopens file sinks", "[logger]")
+{
+    const std::string path = "ealogger_test_logger_reopen.log";
+    const std::string rotated = path + ".1";
+    std::remove(path.c_str());
+    std::remove(rotated.c_str());
+    {
+        eal::Logger logger(true);
+        logger.discard_sink(con::LOGGER_SINK::EAL_CONSOLE);
+        logger.init_file_sink(true, con::LOG_LEVEL::EAL_DEBUG, "%m", "%F %T",
+                              path, true);
+        logger.write_log("before rotation", con::LOG_LEVEL::EAL_INFO);
+        // flush_buffer is set, wait until the logger thread has written it
+        for (int i = 0; i < 200 && std::ifstream(path).peek() == EOF; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(std::rename(path.c_str(), rotated.c_str()) == 0);
+
+        std::raise(SIGUSR1);
+        for (int i = 0; i < 200 && !std::ifstream(path); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(std::ifstream(path));
+        logger.write_log("after rotation", con::LOG_LEVEL::EAL_INFO);
+    }
+    std::ifstream old_file(rotated);
+    std::string line;
+    REQUIRE(std::getline(old_file, line));
+    REQUIRE(line == "before rotation");
+    REQUIRE(!std::getline(old_file, line));
+    std::ifstream new_file(path);
+    REQUIRE(std::getline(new_file, line));
+    REQUIRE(line == "after rotation");
+    std::remove(path.c_str());
+    std::remove(rotated.c_str());
+}
+#endif
@@ -0,0 +1,75 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "catch.hpp"
+
+#include <ealogger/ratelimit.h>
+
+namespace eal = ealogger;
+
+typedef eal::RateLimiter::LIMIT_TYPE lt;
+
+TEST_CASE("Rate limiter strategies", "[ratelimit]")
+{
+    eal::RateLimiter limiter;
+    std::uint64_t suppressed = 0;
+    int passed = 0;
+
+    SECTION("Every n-th message passes")
+    {
+        for (int i = 0; i < 100; i++) {
+            if (limiter.allow(lt::EVERY_N, 10, suppressed))
+                passed++;
+        }
+        REQUIRE(passed == 10);
+        REQUIRE(limiter.get_suppressed(lt::EVERY_N, 10) == 90);
+    }
+
+    SECTION("Only the first n messages pass")
+    {
+        for (int i = 0; i < 100; i++) {
+            if (limiter.allow(lt::FIRST_N, 5, suppressed))
+                passed++;
+        }
+        REQUIRE(passed == 5);
+        REQUIRE(limiter.get_suppressed(lt::FIRST_N, 5) == 95);
+    }
+
+    SECTION("At most n messages per second pass")
+    {
+        for (int i = 0; i < 100; i++) {
+            if (limiter.allow(lt::PER_SECOND, 1000, suppressed))
+                passed++;
+        }
+        REQUIRE(passed == 100);
+        REQUIRE(limiter.get_suppressed(lt::PER_SECOND, 1000) == 0);
+    }
+}
+
+TEST_CASE("Rate limiter reports suppressed messages", "[ratelimit]")
+{
+    eal::RateLimiter limiter;
+    std::uint64_t suppressed = 0;
+    std::uint64_t reported = 0;
+    // the first message passes and there is nothing to report
+    REQUIRE(limiter.allow(lt::EVERY_N, 3, suppressed));
+    REQUIRE(suppressed == 0);
+    for (int i = 0; i < 5; i++) {
+        limiter.allow(lt::EVERY_N, 3, suppressed);
+        reported += suppressed;
+    }
+    // calls 1 and 2 are suppressed and reported when call 3 passes
+    REQUIRE(reported == 2);
+}
@@ -0,0 +1,117 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <chrono>
+#include <thread>
+
+#include "catch.hpp"
+
+#include <ealogger/sampler.h>
+
+namespace eal = ealogger;
+
+typedef eal::Sampler::SAMPLE_TYPE st;
+
+TEST_CASE("Sampler strategies", "[sampler]")
+{
+    eal::Sampler sampler;
+    std::uint32_t weight = 0;
+    std::uint64_t weight_sum = 0;
+
+    SECTION("Without sampling every message passes with weight 1")
+    {
+        for (int i = 0; i < 1000; i++) {
+            REQUIRE(sampler.sample(st::NONE, 0, weight));
+            REQUIRE(weight == 1);
+        }
+        // the shared counters are not touched
+        REQUIRE(sampler.get_stats().seen == 0);
+        REQUIRE(sampler.get_stats().emitted == 0);
+    }
+
+    SECTION("One in n messages passes on average")
+    {
+        for (int i = 0; i < 100000; i++) {
+            if (sampler.sample(st::ONE_IN_N, 10, weight)) {
+                REQUIRE(weight == 10);
+                weight_sum += weight;
+            }
+        }
+        eal::SampleStats stats = sampler.get_stats();
+        REQUIRE(stats.seen == 100000);
+        REQUIRE(stats.emitted > 9000);
+        REQUIRE(stats.emitted < 11000);
+        REQUIRE(weight_sum == stats.emitted * 10);
+    }
+
+    SECTION("Huge values of n are clamped")
+    {
+        int passed = 0;
+        for (int i = 0; i < 1000; i++) {
+            if (sampler.sample(st::ONE_IN_N, UINT64_C(1) << 40, weight)) {
+                REQUIRE(weight == UINT32_MAX);
+                passed++;
+            }
+        }
+        REQUIRE(passed < 2);
+        REQUIRE(sampler.get_stats().seen == 1000);
+    }
+
+    SECTION("Counting messages decided somewhere else")
+    {
+        sampler.record(true);
+        sampler.record(false);
+        REQUIRE(sampler.get_stats().seen == 2);
+        REQUIRE(sampler.get_stats().emitted == 1);
+    }
+}
+
+TEST_CASE("Sampler adapts to a target rate", "[sampler]")
+{
+    typedef std::chrono::steady_clock clock;
+    eal::Sampler sampler;
+    std::uint32_t weight = 0;
+    auto second = []() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   clock::now().time_since_epoch())
+            .count();
+    };
+    // the first full second measures the message rate, the one after that
+    // is sampled with the adapted probability
+    std::int64_t start = second();
+    std::uint64_t seen = 0;
+    std::uint64_t emitted = 0;
+    std::uint64_t weight_sum = 0;
+    while (second() < start + 3) {
+        bool measured = second() == start + 2;
+        for (int i = 0; i < 100; i++) {
+            bool pass = sampler.sample(st::RATE, 1000, weight);
+            if (measured) {
+                seen++;
+                if (pass) {
+                    emitted++;
+                    weight_sum += weight;
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    // a rate of more than 1000 messages per second is reduced to about 1000
+    REQUIRE(seen > 5000);
+    REQUIRE(emitted > 500);
+    REQUIRE(emitted < 1500);
+    REQUIRE(weight_sum > seen / 2);
+    REQUIRE(weight_sum < seen * 2);
+}
@@ -0,0 +1,178 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <unistd.h>
+
+#include <ealogger/shm_reader.h>
+#include <ealogger/sink_shm.h>
+#include "config.h"
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+#ifdef EALOGGER_SHM
+namespace
+{
+/**
+ * @brief A sink that stores rendered messages in a vector
+ */
+class SinkLines : public eal::Sink
+{
+public:
+    SinkLines(std::string msg_template)
+        : eal::Sink(std::move(msg_template), "%F %T", true,
+                    con::LOG_LEVEL::EAL_DEBUG)
+    {
+    }
+
+    std::vector<std::string> lines;
+
+private:
+    void write_message(const std::string &msg) { this->lines.push_back(msg); }
+    void config_changed() {}
+};
+
+std::shared_ptr<eal::LogMessage> make_msg(con::LOG_LEVEL lvl, std::string msg,
+                                          int line)
+{
+    return std::make_shared<eal::LogMessage>(
+        lvl, std::move(msg), eal::LogMessage::LOGTYPE::DEFAULT, "/src/file.cpp",
+        line, "func");
+}
+
+/**
+ * @brief Name of a ring that no other test run uses
+ */
+std::string ring_name(const std::string &test)
+{
+    return "/ealogger_test_" + test + "_" + std::to_string(getpid());
+}
+
+std::vector<std::string> collect(eal::ShmReader &reader,
+                                 const std::string &msg_template)
+{
+    SinkLines out(msg_template);
+    std::shared_ptr<eal::LogMessage> m;
+    while (reader.next(m))
+        out.prepare_log_message(m);
+    return out.lines;
+}
+}
+
+TEST_CASE("Shared memory sink passes messages to a collector", "[shm]")
+{
+    const std::string tmpl = "%d %s [%f:%l] %u %t %m";
+    std::vector<std::shared_ptr<eal::LogMessage>> batch;
+    for (int i = 0; i < 100; i++)
+        batch.push_back(make_msg(static_cast<con::LOG_LEVEL>(i % 5),
+                                 "message " + std::to_string(i), i % 7));
+    batch[42]->set_logger_name("child");
+    batch.push_back(std::make_shared<eal::LogMessage>(
+        con::LOG_LEVEL::EAL_STACK,
+        std::vector<std::string>{"frame 0", "frame 1"},
+        eal::LogMessage::LOGTYPE::STACK, "/src/file.cpp", 1, "func"));
+    SinkLines live(tmpl);
+    live.prepare_log_batch(batch);
+
+    SECTION("rendered lines")
+    {
+        const std::string name = ring_name("lines");
+        eal::ShmRing::remove(name);
+        eal::SinkShm sink(tmpl, "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                          name);
+        eal::ShmReader reader(name);
+        REQUIRE(reader.is_valid());
+        REQUIRE(reader.get_format() == eal::ShmRing::FORMAT::LINES);
+        sink.prepare_log_batch(batch);
+        REQUIRE(collect(reader, "%m") == live.lines);
+        REQUIRE(eal::ShmRing::remove(name));
+    }
+    SECTION("binary messages rendered by the collector")
+    {
+        const std::string name = ring_name("messages");
+        eal::ShmRing::remove(name);
+        eal::SinkShm sink(tmpl, "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                          name, 1024 * 1024, eal::ShmRing::FORMAT::MESSAGES);
+        sink.prepare_log_batch(batch);
+        // the collector attaches after the application has written
+        eal::ShmReader reader(name);
+        REQUIRE(reader.get_format() == eal::ShmRing::FORMAT::MESSAGES);
+        REQUIRE(collect(reader, tmpl) == live.lines);
+        REQUIRE(reader.get_skipped() == 0);
+        REQUIRE(eal::ShmRing::remove(name));
+    }
+}
+
+TEST_CASE("Shared memory ring wraps, drops and survives a restart", "[shm]")
+{
+    const std::string name = ring_name("ring");
+    eal::ShmRing::remove(name);
+    std::vector<std::string> expected;
+    eal::ShmReader reader(name);
+    REQUIRE_FALSE(reader.is_valid());
+    {
+        eal::SinkShm sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG, name,
+                          4096);
+        REQUIRE(reader.refresh());
+        // many times around the ring with records of different sizes
+        for (int i = 0; i < 2000; i++) {
+            std::string msg(static_cast<std::size_t>(i % 300), 'a' + i % 26);
+            sink.prepare_log_message(
+                make_msg(con::LOG_LEVEL::EAL_INFO, msg, i));
+            expected.push_back(msg);
+            if (i % 10 == 9) {
+                REQUIRE(collect(reader, "%m") == expected);
+                expected.clear();
+            }
+        }
+        REQUIRE(sink.get_stats().messages_dropped == 0);
+
+        // a full ring drops messages
+        for (int i = 0; i < 500; i++) {
+            // all of the same size, only the newest ones are dropped
+            std::string msg = "message " + std::to_string(100 + i);
+            sink.prepare_log_message(
+                make_msg(con::LOG_LEVEL::EAL_INFO, msg, i));
+            expected.push_back(msg);
+        }
+        std::uint64_t dropped = sink.get_stats().messages_dropped;
+        REQUIRE(dropped > 0);
+        REQUIRE(reader.get_dropped() == dropped);
+        expected.resize(expected.size() - dropped);
+    }
+    // the application is restarted, unread messages are kept
+    eal::SinkShm sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG, name,
+                      4096);
+    REQUIRE_FALSE(reader.refresh());
+    REQUIRE(collect(reader, "%m") == expected);
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "again", 1));
+    REQUIRE(collect(reader, "%m") == std::vector<std::string>{"again"});
+
+    // other settings replace the ring
+    eal::SinkShm bigger("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG, name,
+                        65536);
+    bigger.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "new", 1));
+    REQUIRE(reader.refresh());
+    REQUIRE(reader.get_dropped() == 0);
+    REQUIRE(collect(reader, "%m") == std::vector<std::string>{"new"});
+    REQUIRE(eal::ShmRing::remove(name));
+}
+#endif
@@ -0,0 +1,760 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <ealogger/sink.h>
+#include <ealogger/sink_file.h>
+#include <ealogger/sink_file_binary.h>
+#include <ealogger/sink_file_direct.h>
+#include <ealogger/sink_file_gzip.h>
+#include <ealogger/sink_file_mmap.h>
+#include <ealogger/sink_file_rotating.h>
+#include "config.h"
+
+#ifdef EALOGGER_ZLIB
+#include <zlib.h>
+#endif
+
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+namespace
+{
+/**
+ * @brief A sink that stores all messages in a vector
+ */
+class SinkMemory : public eal::Sink
+{
+public:
+    SinkMemory(std::string msg_template, con::LOG_LEVEL min_lvl)
+        : eal::Sink(std::move(msg_template), "%F %T", true, min_lvl)
+    {
+    }
+
+    std::vector<std::string> lines;
+
+private:
+    void write_message(const std::string &msg) { this->lines.push_back(msg); }
+    void config_changed() {}
+};
+
+std::shared_ptr<eal::LogMessage> make_msg(con::LOG_LEVEL lvl, std::string msg,
+                                          int line = 1)
+{
+    return std::make_shared<eal::LogMessage>(
+        lvl, std::move(msg), eal::LogMessage::LOGTYPE::DEFAULT, "file.cpp",
+        line, "func");
+}
+
+/**
+ * @brief Limit the size of files this process may write, see setrlimit(2)
+ *
+ * @details
+ * SIGXFSZ is ignored so writes beyond the limit fail with EFBIG. The old
+ * limit is restored by the destructor.
+ */
+class FileSizeLimit
+{
+public:
+    explicit FileSizeLimit(rlim_t size)
+    {
+        getrlimit(RLIMIT_FSIZE, &this->old_limit);
+        this->old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        this->set(size);
+    }
+    ~FileSizeLimit()
+    {
+        setrlimit(RLIMIT_FSIZE, &this->old_limit);
+        std::signal(SIGXFSZ, this->old_handler);
+    }
+
+    void set(rlim_t size)
+    {
+        struct rlimit limit = this->old_limit;
+        limit.rlim_cur = size;
+        setrlimit(RLIMIT_FSIZE, &limit);
+    }
+    void reset() { setrlimit(RLIMIT_FSIZE, &this->old_limit); }
+
+private:
+    struct rlimit old_limit;
+    void (*old_handler)(int);
+};
+
+/**
+ * @brief Options of a SinkFile that holds messages until its 4096 byte buffer
+ * is full or an error arrives
+ */
+eal::SinkFile::Options held_options()
+{
+    eal::SinkFile::Options options;
+    options.buffer_size = 4096;
+    options.flush_interval = std::chrono::milliseconds(60000);
+    return options;
+}
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Name of the file SinkFileGzip writes for \p path
+ *
+ * @details
+ * Without zlib the sink removes the ".gz" suffix.
+ */
+std::string gzip_path(std::string path)
+{
+#ifndef EALOGGER_ZLIB
+    path.erase(path.size() - 3);
+#endif
+    return path;
+}
+
+/**
+ * @brief Read a file with concatenated gzip members
+ */
+std::string read_gzip(const std::string &path)
+{
+#ifdef EALOGGER_ZLIB
+    std::string content;
+    gzFile gz = gzopen(path.c_str(), "rb");
+    if (gz == nullptr)
+        return content;
+    char buf[4096];
+    int n = 0;
+    while ((n = gzread(gz, buf, sizeof(buf))) > 0)
+        content.append(buf, static_cast<std::size_t>(n));
+    gzclose(gz);
+    return content;
+#else
+    return read_file(path);
+#endif
+}
+}
+
+TEST_CASE("Sink renders message templates", "[sink]")
+{
+    SinkMemory sink("%s [%f:%l %u] %m", con::LOG_LEVEL::EAL_INFO);
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_DEBUG, "hidden"));
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_WARNING, "shown", 42));
+    REQUIRE(sink.lines.size() == 1);
+    REQUIRE(sink.lines[0] == "WARNING [file.cpp:42 func] shown");
+}
+
+TEST_CASE("Sink collapses repeated messages", "[sink]")
+{
+    SinkMemory sink("%s: %m", con::LOG_LEVEL::EAL_DEBUG);
+    sink.set_collapse_repeated(true, std::chrono::milliseconds(60000));
+
+    SECTION("Repeat count is written when a different message arrives")
+    {
+        for (int i = 0; i < 100; i++)
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "storm"));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "calm"));
+        REQUIRE(sink.lines.size() == 3);
+        REQUIRE(sink.lines[0] == "ERROR: storm");
+        REQUIRE(sink.lines[1] == "ERROR: Last message repeated 99 times");
+        REQUIRE(sink.lines[2] == "INFO: calm");
+    }
+
+    SECTION("Messages from different call sites are not collapsed")
+    {
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "a", 1));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "a", 2));
+        REQUIRE(sink.lines.size() == 2);
+    }
+
+    SECTION("Flushing writes a pending repeat count")
+    {
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "storm"));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "storm"));
+        sink.tick();
+        REQUIRE(sink.lines.size() == 1);
+        sink.flush();
+        REQUIRE(sink.lines.size() == 2);
+        REQUIRE(sink.lines[1] == "ERROR: Last message repeated 1 times");
+    }
+}
+
+TEST_CASE("Sink writes a backtrace on errors", "[sink]")
+{
+    SinkMemory sink("%s: %m", con::LOG_LEVEL::EAL_WARNING);
+    sink.set_backtrace(3);
+
+    for (int i = 0; i < 5; i++) {
+        sink.prepare_log_message(
+            make_msg(con::LOG_LEVEL::EAL_DEBUG, "step " + std::to_string(i)));
+    }
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_WARNING, "slow"));
+    REQUIRE(sink.lines.size() == 1);
+
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "failed"));
+    REQUIRE(sink.lines.size() == 5);
+    REQUIRE(sink.lines[1] == "DEBUG: step 2");
+    REQUIRE(sink.lines[3] == "DEBUG: step 4");
+    REQUIRE(sink.lines[4] == "ERROR: failed");
+
+    // the ring has been cleared
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_FATAL, "again"));
+    REQUIRE(sink.lines.size() == 6);
+
+    sink.set_backtrace(0);
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "dropped"));
+    sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "failed"));
+    REQUIRE(sink.lines.size() == 7);
+}
+
+TEST_CASE("File sink buffers messages", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_file.log";
+    std::remove(path.c_str());
+    {
+        eal::SinkFile sink("%s: %m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                           path, held_options());
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "held"));
+        REQUIRE(read_file(path).empty());
+
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_ERROR, "now"));
+        REQUIRE(read_file(path) == "INFO: held\nERROR: now\n");
+
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_DEBUG, "last"));
+        sink.flush();
+        REQUIRE(read_file(path) == "INFO: held\nERROR: now\nDEBUG: last\n");
+
+        // a message larger than the buffer is written right away
+        sink.prepare_log_message(
+            make_msg(con::LOG_LEVEL::EAL_DEBUG, std::string(5000, 'x')));
+        REQUIRE(read_file(path).size() == 34 + 5008);
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_DEBUG, "closed"));
+    }
+    REQUIRE(read_file(path).size() == 34 + 5008 + 14);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Sinks write batches in order", "[sink]")
+{
+    std::vector<std::shared_ptr<eal::LogMessage>> batch;
+    batch.push_back(make_msg(con::LOG_LEVEL::EAL_DEBUG, "dropped"));
+    batch.push_back(make_msg(con::LOG_LEVEL::EAL_INFO, "one"));
+    batch.push_back(make_msg(con::LOG_LEVEL::EAL_WARNING, "two"));
+
+    SECTION("Default implementation writes line by line")
+    {
+        SinkMemory sink("%s: %m", con::LOG_LEVEL::EAL_INFO);
+        sink.prepare_log_batch(batch);
+        REQUIRE(sink.lines.size() == 2);
+        REQUIRE(sink.lines[1] == "WARNING: two");
+    }
+
+    SECTION("File sink writes a batch with one vectored write")
+    {
+        const std::string path = "ealogger_test_sink_batch.log";
+        std::remove(path.c_str());
+        eal::SinkFile sink("%s: %m", "%F %T", true, con::LOG_LEVEL::EAL_INFO,
+                           path, held_options());
+        sink.prepare_log_batch(batch);
+        REQUIRE(read_file(path).empty());
+
+        batch.push_back(make_msg(con::LOG_LEVEL::EAL_ERROR, "three"));
+        sink.prepare_log_batch(batch);
+        REQUIRE(read_file(path) == "INFO: one\nWARNING: two\nINFO: one\n"
+                                   "WARNING: two\nERROR: three\n");
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("File sink with io_uring keeps messages in order", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_uring.log";
+    std::remove(path.c_str());
+    std::string expected;
+    eal::SinkStats stats;
+    {
+        // small buffers so there are many writes in flight
+        eal::SinkFile::Options options = held_options();
+        options.io_uring_depth = 4;
+        eal::SinkFile sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                           path, options);
+        for (int i = 0; i < 5000; i++) {
+            std::string msg = "message number " + std::to_string(i);
+            expected += msg + "\n";
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+        }
+        sink.flush();
+        stats = sink.get_stats();
+    }
+    REQUIRE(read_file(path) == expected);
+    // io_uring may not be available, then blocking writes are used
+    if (stats.io_uring) {
+        REQUIRE(stats.writes_submitted > 4);
+        REQUIRE(stats.max_in_flight <= 4);
+        REQUIRE(stats.writes_completed + stats.in_flight ==
+                stats.writes_submitted);
+    }
+    std::remove(path.c_str());
+}
+
+#ifdef __linux__
+TEST_CASE("File sink drops messages while writes fail", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_full.log";
+    std::remove(path.c_str());
+    {
+        // every write to /dev/full fails with ENOSPC
+        eal::SinkFile sink("%s: %m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                           "/dev/full", true);
+        for (int i = 0; i < 3; i++)
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "lost"));
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.write_errors == 1);
+        REQUIRE(stats.messages_dropped == 3);
+        REQUIRE(stats.last_error == ENOSPC);
+
+        sink.set_log_file(path);
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "back"));
+        stats = sink.get_stats();
+        REQUIRE(!stats.degraded);
+        REQUIRE(stats.messages_dropped == 3);
+    }
+    REQUIRE(read_file(path) ==
+            "ealogger: 3 messages dropped after write error: " +
+                std::string(std::strerror(ENOSPC)) + "\nINFO: back\n");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("File sink removes a partially written buffer", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_partial.log";
+    std::remove(path.c_str());
+    {
+        eal::SinkFile sink("%s: %m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                           path, held_options());
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "first"));
+        sink.flush();
+        std::size_t size = read_file(path).size();
+        {
+            // only 10 bytes of the buffer can be written
+            FileSizeLimit limit(static_cast<rlim_t>(size + 10));
+            for (int i = 0; i < 5; i++)
+                sink.prepare_log_message(
+                    make_msg(con::LOG_LEVEL::EAL_INFO,
+                             "lost message " + std::to_string(i)));
+            sink.flush();
+        }
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.write_errors == 1);
+        REQUIRE(stats.messages_dropped == 5);
+        REQUIRE(stats.last_error == EFBIG);
+        // no torn message is left in the file
+        REQUIRE(read_file(path).size() == size);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "back"));
+        sink.flush();
+        REQUIRE(!sink.get_stats().degraded);
+    }
+    REQUIRE(read_file(path) ==
+            "INFO: first\nealogger: 5 messages dropped after write error: " +
+                std::string(std::strerror(EFBIG)) + "\nINFO: back\n");
+    std::remove(path.c_str());
+}
+#endif
+
+TEST_CASE("Binary file sink writes each call site once", "[sink]")
+{
+    namespace bl = eal::binlog;
+    const std::string path = "ealogger_test_sink_binary.eal";
+    std::remove(path.c_str());
+    {
+        eal::SinkFileBinary sink("%s %m", "%T", true, con::LOG_LEVEL::EAL_INFO,
+                                 path);
+        std::vector<std::shared_ptr<eal::LogMessage>> batch;
+        batch.push_back(make_msg(con::LOG_LEVEL::EAL_INFO, "first"));
+        batch.push_back(make_msg(con::LOG_LEVEL::EAL_DEBUG, "filtered"));
+        batch.push_back(make_msg(con::LOG_LEVEL::EAL_ERROR, "second"));
+        batch.push_back(make_msg(con::LOG_LEVEL::EAL_WARNING, "third", 2));
+        sink.prepare_log_batch(batch);
+    }
+    std::string data = read_file(path);
+    REQUIRE(bl::is_file_header(data.data(), data.size()));
+
+    std::vector<bl::RECORD> types;
+    std::vector<std::string> messages;
+    std::uint64_t sequence = 0;
+    std::size_t pos = bl::file_header_size;
+    while (pos + bl::record_prefix_size <= data.size()) {
+        std::uint32_t size = bl::get<std::uint32_t>(&data[pos]);
+        REQUIRE(pos + 4 + size <= data.size());
+        const char *body = &data[pos + bl::record_prefix_size];
+        std::size_t body_len = size - 1;
+        types.push_back(static_cast<bl::RECORD>(data[pos + 4]));
+        if (types.back() == bl::RECORD::FORMAT) {
+            std::uint32_t len = bl::get<std::uint32_t>(body);
+            REQUIRE(std::string(body + 4, len) == "%s %m");
+            REQUIRE(std::string(body + 4 + len, body_len - 4 - len) == "%T");
+        } else if (types.back() == bl::RECORD::MESSAGE) {
+            REQUIRE(bl::get<std::uint64_t>(body + 8) == sequence++);
+            REQUIRE(bl::get<std::uint64_t>(body + 16) ==
+                    eal::utility::get_thread_id());
+            messages.emplace_back(body + bl::message_header_size,
+                                  body_len - bl::message_header_size);
+        }
+        pos += 4 + size;
+    }
+    REQUIRE(pos == data.size());
+    REQUIRE(types == std::vector<bl::RECORD>(
+                         {bl::RECORD::FORMAT, bl::RECORD::CALL_SITE,
+                          bl::RECORD::MESSAGE, bl::RECORD::MESSAGE,
+                          bl::RECORD::CALL_SITE, bl::RECORD::MESSAGE}));
+    REQUIRE(messages ==
+            std::vector<std::string>({"first", "second", "third"}));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Memory mapped sink rolls over segments", "[sink]")
+{
+    const std::string base = "ealogger_test_sink_mmap.log";
+    std::string expected;
+    {
+        // segments are rounded up to the page size
+        eal::SinkFileMmap sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                               base, 1);
+        for (int i = 0; i < 1000; i++) {
+            std::string msg = "mapped message " + std::to_string(i);
+            expected += msg + "\n";
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+        }
+        // a line longer than a segment fills one on its own
+        std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        sink.prepare_log_message(
+            make_msg(con::LOG_LEVEL::EAL_INFO, std::string(page * 2, 'x')));
+        expected += std::string(page - 1, 'x') + "\n";
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "after"));
+        expected += "after\n";
+    }
+    std::string written;
+    int segments = 0;
+    while (true) {
+        std::string path = base + "." + std::to_string(segments);
+        std::ifstream in(path);
+        if (!in)
+            break;
+        std::string segment = read_file(path);
+        // no line is split between two segments
+        REQUIRE(segment.back() == '\n');
+        written += segment;
+        std::remove(path.c_str());
+        segments++;
+    }
+    REQUIRE(segments > 1);
+    REQUIRE(written == expected);
+}
+
+#ifdef __linux__
+TEST_CASE("Memory mapped sink skips segments it can not preallocate",
+          "[sink]")
+{
+    const std::string base = "ealogger_test_sink_mmap_full.log";
+    {
+        // preallocating the segment fails like on a full disk
+        FileSizeLimit limit(4096);
+        eal::SinkFileMmap sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                               base, 1024 * 1024);
+        for (int i = 0; i < 3; i++)
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "lost"));
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.write_errors >= 1);
+        REQUIRE(stats.last_error == EFBIG);
+        REQUIRE(stats.messages_dropped == 3);
+        std::ifstream in(base + ".0");
+        REQUIRE(!in);
+
+        limit.reset();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "back"));
+        stats = sink.get_stats();
+        REQUIRE(!stats.degraded);
+        REQUIRE(stats.messages_dropped == 3);
+    }
+    bool found = false;
+    for (int i = 0; i < 16; i++) {
+        std::string path = base + "." + std::to_string(i);
+        std::ifstream in(path);
+        if (!in)
+            continue;
+        REQUIRE(read_file(path) == "back\n");
+        found = true;
+        std::remove(path.c_str());
+    }
+    REQUIRE(found);
+}
+#endif
+
+TEST_CASE("Rotating file sink keeps every message once", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_rotating.log";
+    std::string expected;
+
+    SECTION("Index naming shifts files and keeps the newest ones")
+    {
+        {
+            eal::SinkFileRotating sink(
+                "%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG, path, 1000,
+                std::chrono::seconds(0), 3,
+                eal::SinkFileRotating::NAMING::INDEX);
+            for (int i = 0; i < 1000; i++) {
+                std::string msg = "rotating message " + std::to_string(i);
+                expected += msg + "\n";
+                sink.prepare_log_message(
+                    make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+            }
+            REQUIRE(sink.get_rotations() > 3);
+        }
+        std::string written;
+        for (int i = 3; i > 0; i--) {
+            std::string rotated = path + "." + std::to_string(i);
+            std::string content = read_file(rotated);
+            REQUIRE(content.size() <= 1000);
+            REQUIRE(content.size() > 900);
+            written += content;
+            std::remove(rotated.c_str());
+        }
+        REQUIRE(read_file(path + ".4").empty());
+        written += read_file(path);
+        REQUIRE(expected.size() > written.size());
+        REQUIRE(expected.substr(expected.size() - written.size()) == written);
+    }
+
+    SECTION("Datetime naming removes expired files")
+    {
+        {
+            eal::SinkFileRotating sink(
+                "%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG, path, 100,
+                std::chrono::seconds(0), 2,
+                eal::SinkFileRotating::NAMING::DATETIME);
+            for (int i = 0; i < 20; i++) {
+                sink.prepare_log_message(make_msg(
+                    con::LOG_LEVEL::EAL_INFO, "datetime message " +
+                                                  std::to_string(i)));
+            }
+            REQUIRE(sink.get_rotations() > 2);
+        }
+        std::vector<std::string> rotated;
+        DIR *d = opendir(".");
+        while (struct dirent *entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, path.size() + 1, path + ".") == 0)
+                rotated.push_back(name);
+        }
+        closedir(d);
+        REQUIRE(rotated.size() == 2);
+        for (const auto &name : rotated)
+            std::remove(name.c_str());
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Compressed file sink writes complete gzip frames", "[sink]")
+{
+    const std::string name = "ealogger_test_sink_gzip.log.gz";
+    const std::string path = gzip_path(name);
+    std::remove(path.c_str());
+    std::string expected;
+    {
+        eal::SinkFileGzip sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                               name, held_options());
+        for (int i = 0; i < 2000; i++) {
+            std::string msg = "compressed message " + std::to_string(i);
+            expected += msg + "\n";
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+        }
+        sink.flush();
+        // every complete frame can be read while the sink is still open
+        REQUIRE(read_gzip(path) == expected);
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "last"));
+    }
+    std::string written = read_gzip(path);
+#ifdef EALOGGER_ZLIB
+    REQUIRE(read_file(path).size() < expected.size() / 4);
+#endif
+    REQUIRE(written == expected + "last\n");
+    std::remove(path.c_str());
+}
+
+#ifdef __linux__
+TEST_CASE("Compressed file sink drops frames it can not write", "[sink]")
+{
+    const std::string name = "ealogger_test_sink_gzip_full.log.gz";
+    const std::string path = gzip_path(name);
+    std::remove(path.c_str());
+    {
+        eal::SinkFileGzip sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                               name, held_options());
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "first"));
+        sink.flush();
+        std::size_t size = read_file(path).size();
+        {
+            // the next frame is written partially, then the write fails
+            FileSizeLimit limit(static_cast<rlim_t>(size + 10));
+            for (int i = 0; i < 5; i++)
+                sink.prepare_log_message(
+                    make_msg(con::LOG_LEVEL::EAL_INFO,
+                             "lost message " + std::to_string(i)));
+            sink.flush();
+        }
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.write_errors == 1);
+        REQUIRE(stats.messages_dropped == 5);
+        REQUIRE(stats.last_error == EFBIG);
+        // the torn frame was cut off, the file is still readable
+        REQUIRE(read_file(path).size() == size);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "back"));
+        sink.flush();
+        REQUIRE(!sink.get_stats().degraded);
+    }
+    REQUIRE(read_gzip(path) ==
+            "first\nealogger: 5 messages dropped after write error: " +
+                std::string(std::strerror(EFBIG)) + "\nback\n");
+    std::remove(path.c_str());
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("Direct file sink rewrites the incomplete block", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_direct.log";
+    std::remove(path.c_str());
+    {
+        std::ofstream out(path);
+        out << "from an earlier run\n";
+    }
+    std::string expected = "from an earlier run\n";
+    {
+        eal::SinkFile::Options options = held_options();
+        options.buffer_size = 8192;
+        eal::SinkFileDirect sink("%m", "%F %T", true,
+                                 con::LOG_LEVEL::EAL_DEBUG, path, options,
+                                 4096);
+        for (int i = 0; i < 1000; i++) {
+            std::string msg = "direct message " + std::to_string(i);
+            expected += msg + "\n";
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+            if (i % 100 == 0)
+                sink.flush();
+        }
+        // cut off to the buffer without one block
+        sink.prepare_log_message(
+            make_msg(con::LOG_LEVEL::EAL_INFO, std::string(20000, 'y')));
+        expected += std::string(4096, 'y') + "\n";
+        sink.flush();
+        // the padded last block is written, the messages are complete
+        std::string padded = read_file(path);
+        REQUIRE(padded.size() % 4096 == 0);
+        REQUIRE(padded.substr(0, expected.size()) == expected);
+        REQUIRE(padded.find_first_not_of('\0', expected.size()) ==
+                std::string::npos);
+    }
+    REQUIRE(read_file(path) == expected);
+    std::remove(path.c_str());
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("Direct file sink keeps the buffer while writes fail", "[sink]")
+{
+    const std::string path = "ealogger_test_sink_direct_full.log";
+    std::remove(path.c_str());
+    std::string expected;
+    {
+        FileSizeLimit limit(8192);
+        eal::SinkFile::Options options = held_options();
+        options.buffer_size = 8192;
+        eal::SinkFileDirect sink("%m", "%F %T", true,
+                                 con::LOG_LEVEL::EAL_DEBUG, path, options,
+                                 4096);
+        // 100 lines of 100 bytes, the second block can not be written
+        for (int i = 0; i < 100; i++) {
+            std::string msg = std::to_string(i);
+            msg.resize(99, '.');
+            expected += msg + "\n";
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, msg));
+        }
+        sink.flush();
+        eal::SinkStats stats = sink.get_stats();
+        REQUIRE(stats.degraded);
+        REQUIRE(stats.write_errors == 1);
+        REQUIRE(stats.messages_dropped == 0);
+        REQUIRE(stats.last_error == EFBIG);
+
+        for (int i = 0; i < 5; i++)
+            sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "lost"));
+        REQUIRE(sink.get_stats().messages_dropped == 5);
+
+        limit.reset();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "back"));
+        sink.flush();
+        stats = sink.get_stats();
+        REQUIRE(!stats.degraded);
+        REQUIRE(stats.write_errors == 1);
+        REQUIRE(stats.messages_dropped == 5);
+    }
+    // the buffered lines were written after the error, nothing is padded
+    REQUIRE(read_file(path) ==
+            expected + "ealogger: 5 messages dropped after write error: " +
+                std::strerror(EFBIG) + "\nback\n");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Direct file sink counts messages it can not open a file for",
+          "[sink]")
+{
+    eal::SinkFileDirect sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG,
+                             "ealogger_no_such_dir/direct.log");
+    for (int i = 0; i < 3; i++)
+        sink.prepare_log_message(make_msg(con::LOG_LEVEL::EAL_INFO, "lost"));
+    eal::SinkStats stats = sink.get_stats();
+    REQUIRE(stats.degraded);
+    REQUIRE(stats.write_errors == 1);
+    REQUIRE(stats.messages_dropped == 3);
+    REQUIRE(stats.last_error == ENOENT);
+}
+#endif
@@ -0,0 +1,350 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <ealogger/uring_writer.h>
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef EALOGGER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace eal = ealogger;
+
+eal::UringWriter::UringWriter(std::size_t depth, std::size_t buffer_size)
+    : ring_fd(-1),
+      file_fd(-1),
+      offset(0),
+      buffer_size(buffer_size),
+      fixed_buffers(false),
+      sq_ptr(nullptr),
+      sq_size(0),
+      cq_ptr(nullptr),
+      cq_size(0),
+      sqe_ptr(nullptr),
+      sqe_size(0),
+      sq_tail(nullptr),
+      sq_mask(nullptr),
+      sq_array(nullptr),
+      cq_head(nullptr),
+      cq_tail(nullptr),
+      cq_mask(nullptr),
+      cqes(nullptr),
+      submitted(0),
+      completed(0),
+      in_flight(0),
+      max_in_flight(0),
+      latency_total_us(0),
+      latency_max_us(0),
+      error(0),
+      lines_lost(0)
+{
+    if (depth == 0 || buffer_size == 0)
+        return;
+    if (!this->setup(static_cast<unsigned>(depth)))
+        this->teardown();
+}
+
+eal::UringWriter::~UringWriter()
+{
+    this->wait_all();
+    this->teardown();
+}
+
+bool eal::UringWriter::is_active() const { return this->ring_fd >= 0; }
+void eal::UringWriter::set_file(int fd, std::int64_t offset)
+{
+    this->file_fd = fd;
+    this->offset = offset;
+}
+
+void eal::UringWriter::write(const char *data, std::size_t len)
+{
+    this->reap();
+    while (len > 0) {
+        Slot &s = this->free_slot();
+        std::size_t n = std::min(len, this->buffer_size);
+        std::memcpy(s.buf, data, n);
+        s.len = n;
+        s.offset = this->offset;
+        this->offset += static_cast<std::int64_t>(n);
+        this->submit(static_cast<std::size_t>(&s - &this->slots[0]));
+        data += n;
+        len -= n;
+    }
+}
+
+void eal::UringWriter::fill_stats(SinkStats &stats) const
+{
+    stats.io_uring = this->is_active();
+    stats.writes_submitted = this->submitted;
+    stats.writes_completed = this->completed;
+    stats.in_flight = this->in_flight;
+    stats.max_in_flight = this->max_in_flight;
+    stats.latency_avg_us =
+        this->completed > 0 ? this->latency_total_us / this->completed : 0;
+    stats.latency_max_us = this->latency_max_us;
+}
+
+int eal::UringWriter::take_error(std::uint64_t &lines)
+{
+    int err = this->error;
+    lines = this->lines_lost;
+    this->error = 0;
+    this->lines_lost = 0;
+    return err;
+}
+
+void eal::UringWriter::complete(std::size_t slot, int res)
+{
+    Slot &s = this->slots[slot];
+    std::uint64_t latency =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - s.submitted)
+            .count();
+    this->latency_total_us += latency;
+    this->latency_max_us = std::max(this->latency_max_us, latency);
+    this->completed++;
+    this->in_flight--;
+
+#ifdef EALOGGER_IO_URING
+    // finish short or failed writes synchronously, the data is still in the
+    // buffer
+    std::size_t done = res > 0 ? static_cast<std::size_t>(res) : 0;
+    while (done < s.len) {
+        ssize_t n = pwrite(this->file_fd, s.buf + done, s.len - done,
+                           s.offset + static_cast<std::int64_t>(done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            this->error = n < 0 ? errno : ENOSPC;
+            this->lines_lost += static_cast<std::uint64_t>(
+                std::count(s.buf + done, s.buf + s.len, '\n'));
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+#else
+    (void)res;
+#endif
+    s.len = 0;
+}
+
+#ifdef EALOGGER_IO_URING
+
+namespace
+{
+int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return static_cast<int>(
+        syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+}
+
+bool eal::UringWriter::setup(unsigned depth)
+{
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    this->ring_fd = uring_setup(depth, &p);
+    if (this->ring_fd < 0)
+        return false;
+
+    this->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    this->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+        this->sq_size = this->cq_size = std::max(this->sq_size, this->cq_size);
+
+    void *ptr = mmap(nullptr, this->sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                     IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED)
+        return false;
+    this->sq_ptr = ptr;
+    if (single_mmap) {
+        this->cq_ptr = this->sq_ptr;
+    } else {
+        ptr = mmap(nullptr, this->cq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                   IORING_OFF_CQ_RING);
+        if (ptr == MAP_FAILED)
+            return false;
+        this->cq_ptr = ptr;
+    }
+    this->sqe_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ptr = mmap(nullptr, this->sqe_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED)
+        return false;
+    this->sqe_ptr = ptr;
+
+    char *sq = static_cast<char *>(this->sq_ptr);
+    char *cq = static_cast<char *>(this->cq_ptr);
+    this->sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    this->sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    this->sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    this->cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    this->cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    this->cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    this->cqes = cq + p.cq_off.cqes;
+
+    // page aligned buffers, one per ring entry
+    std::vector<struct iovec> iov;
+    for (unsigned i = 0; i < depth; i++) {
+        void *buf = nullptr;
+        if (posix_memalign(&buf, 4096, this->buffer_size) != 0)
+            return false;
+        this->slots.push_back({static_cast<char *>(buf), 0, 0,
+                               std::chrono::steady_clock::time_point()});
+        iov.push_back({buf, this->buffer_size});
+    }
+    // registration may fail because of RLIMIT_MEMLOCK, normal writes still
+    // work in that case
+    this->fixed_buffers =
+        uring_register(this->ring_fd, IORING_REGISTER_BUFFERS, iov.data(),
+                       static_cast<unsigned>(iov.size())) == 0;
+    return true;
+}
+
+void eal::UringWriter::teardown()
+{
+    if (this->sqe_ptr)
+        munmap(this->sqe_ptr, this->sqe_size);
+    if (this->cq_ptr && this->cq_ptr != this->sq_ptr)
+        munmap(this->cq_ptr, this->cq_size);
+    if (this->sq_ptr)
+        munmap(this->sq_ptr, this->sq_size);
+    this->sqe_ptr = this->cq_ptr = this->sq_ptr = nullptr;
+    for (auto &s : this->slots)
+        std::free(s.buf);
+    this->slots.clear();
+    if (this->ring_fd >= 0)
+        close(this->ring_fd);
+    this->ring_fd = -1;
+}
+
+eal::UringWriter::Slot &eal::UringWriter::free_slot()
+{
+    while (true) {
+        for (auto &s : this->slots) {
+            if (s.len == 0)
+                return s;
+        }
+        // all buffers are in flight, wait for the kernel
+        if (uring_enter(this->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR) {
+            // the submitted writes still complete, do not spin on the ring
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        this->reap();
+    }
+}
+
+void eal::UringWriter::submit(std::size_t slot)
+{
+    Slot &s = this->slots[slot];
+    unsigned tail = *this->sq_tail;
+    unsigned index = tail & *this->sq_mask;
+    struct io_uring_sqe *sqe =
+        static_cast<struct io_uring_sqe *>(this->sqe_ptr) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = this->fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = this->file_fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(s.buf);
+    sqe->len = static_cast<std::uint32_t>(s.len);
+    sqe->off = static_cast<std::uint64_t>(s.offset);
+    sqe->buf_index = static_cast<std::uint16_t>(slot);
+    sqe->user_data = slot;
+    this->sq_array[index] = index;
+    // the kernel must see the entry before the new tail
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    s.submitted = std::chrono::steady_clock::now();
+    this->submitted++;
+    this->in_flight++;
+    this->max_in_flight = std::max(this->max_in_flight, this->in_flight);
+    while (uring_enter(this->ring_fd, 1, 0, 0) < 0) {
+        if (errno == EINTR)
+            continue;
+        // the entry was not consumed, write it synchronously
+        __atomic_store_n(this->sq_tail, tail, __ATOMIC_RELEASE);
+        this->complete(slot, -errno);
+        break;
+    }
+}
+
+void eal::UringWriter::reap()
+{
+    if (this->ring_fd < 0)
+        return;
+    unsigned head = *this->cq_head;
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = static_cast<struct io_uring_cqe *>(
+                                       this->cqes) +
+                                   (head & *this->cq_mask);
+        this->complete(static_cast<std::size_t>(cqe->user_data), cqe->res);
+        head++;
+    }
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+}
+
+void eal::UringWriter::wait_all()
+{
+    while (this->in_flight > 0) {
+        if (uring_enter(this->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR)
+            break;
+        this->reap();
+    }
+}
+
+#else
+
+bool eal::UringWriter::setup(unsigned) { return false; }
+void eal::UringWriter::teardown() {}
+eal::UringWriter::Slot &eal::UringWriter::free_slot()
+{
+    throw std::runtime_error("io_uring is not available");
+}
+void eal::UringWriter::submit(std::size_t) {}
+void eal::UringWriter::reap() {}
+void eal::UringWriter::wait_all() {}
+
+#endif
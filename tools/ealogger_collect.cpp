@@ -0,0 +1,164 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ealogger/shm_reader.h>
+
+#include "tool_util.h"
+
+namespace
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+volatile std::sig_atomic_t stop = 0;
+
+void handle_signal(int) { stop = 1; }
+void usage()
+{
+    std::cerr
+        << "Usage: ealogger_collect [options] NAME\n"
+           "Write the messages of the shared memory sink NAME to stdout.\n\n"
+           "  -o, --output FILE        Append the messages to FILE\n"
+           "  -t, --template TEMPLATE  Message template for binary messages, "
+           "default is\n"
+           "                           \"%d %s [%f:%l] %m\"\n"
+           "  -d, --datetime PATTERN   Datetime pattern, default is \"%F %T\"\n"
+           "  -l, --level LEVEL        Minimum severity (DEBUG, INFO, WARNING, "
+           "ERROR, FATAL)\n"
+           "      --once               Exit when the ring is empty\n"
+           "      --remove             Remove the ring when exiting\n\n"
+           "NAME is the name of the shared memory object like /ealogger.\n";
+}
+
+/**
+ * @brief Lines are rendered by the application, messages by the collector
+ */
+void set_format(tool::SinkStdout &sink, eal::ShmRing::FORMAT format,
+                const std::string &msg_template)
+{
+    sink.set_msg_template(format == eal::ShmRing::FORMAT::LINES
+                              ? "%m"
+                              : msg_template);
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::string name;
+    std::string output;
+    std::string msg_template = "%d %s [%f:%l] %m";
+    std::string datetime_pattern = "%F %T";
+    con::LOG_LEVEL min_lvl = con::LOG_LEVEL::EAL_DEBUG;
+    bool once = false;
+    bool remove = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-o" || arg == "--output") && has_value) {
+            output = argv[++i];
+        } else if ((arg == "-t" || arg == "--template") && has_value) {
+            msg_template = argv[++i];
+        } else if ((arg == "-d" || arg == "--datetime") && has_value) {
+            datetime_pattern = argv[++i];
+        } else if ((arg == "-l" || arg == "--level") && has_value) {
+            if (!tool::parse_level(argv[++i], min_lvl)) {
+                std::cerr << "ealogger_collect: unknown level " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if (arg == "--once") {
+            once = true;
+        } else if (arg == "--remove") {
+            remove = true;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (name.empty() && (arg[0] != '-' || arg.size() == 1)) {
+            name = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (name.empty()) {
+        usage();
+        return 2;
+    }
+    if (!output.empty() && !std::freopen(output.c_str(), "a", stdout)) {
+        std::cerr << "ealogger_collect: can not open " << output << std::endl;
+        return 1;
+    }
+
+    eal::ShmReader reader(name);
+    if (once && !reader.is_valid()) {
+        std::cerr << "ealogger_collect: can not attach to " << name
+                  << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    static char out_buffer[1 << 20];
+    std::setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    tool::SinkStdout sink;
+    sink.set_min_lvl(min_lvl);
+    sink.set_datetime_pattern(datetime_pattern);
+    set_format(sink, reader.get_format(), msg_template);
+
+    std::uint64_t dropped = reader.get_dropped();
+    std::shared_ptr<eal::LogMessage> m;
+    while (!stop) {
+        bool read = false;
+        while (!stop && reader.next(m)) {
+            sink.prepare_log_message(m);
+            read = true;
+        }
+        if (reader.get_dropped() > dropped) {
+            std::fflush(stdout);
+            std::cerr << "ealogger_collect: the application dropped "
+                      << reader.get_dropped() - dropped
+                      << " messages because the ring was full" << std::endl;
+            dropped = reader.get_dropped();
+        }
+        if (read)
+            continue;
+        if (once)
+            break;
+        std::fflush(stdout);
+        if (reader.refresh()) {
+            set_format(sink, reader.get_format(), msg_template);
+            dropped = reader.get_dropped();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    std::fflush(stdout);
+    if (reader.get_skipped() > 0) {
+        std::cerr << "ealogger_collect: skipped " << reader.get_skipped()
+                  << " damaged records" << std::endl;
+    }
+    if (remove)
+        eal::ShmRing::remove(name);
+    return 0;
+}
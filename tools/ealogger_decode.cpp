@@ -0,0 +1,149 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ealogger/binlog_reader.h>
+
+#include "tool_util.h"
+
+namespace
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+void usage()
+{
+    std::cerr
+        << "Usage: ealogger_decode [options] FILE\n"
+           "Render a binary log file written by the binary file sink.\n\n"
+           "  -t, --template TEMPLATE  Message template, default is the one "
+           "stored in FILE\n"
+           "  -d, --datetime PATTERN   Datetime pattern, default is the one "
+           "stored in FILE\n"
+           "  -l, --level LEVEL        Minimum severity (DEBUG, INFO, WARNING, "
+           "ERROR, FATAL)\n"
+           "      --from TIME          Skip messages before TIME\n"
+           "      --to TIME            Skip messages at or after TIME\n"
+           "  -f, --follow             Wait for new messages at the end of "
+           "FILE\n\n"
+           "TIME is \"YYYY-MM-DD HH:MM:SS\" in local time or seconds since "
+           "the epoch.\n";
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::string file;
+    std::string msg_template;
+    std::string datetime_pattern;
+    con::LOG_LEVEL min_lvl = con::LOG_LEVEL::EAL_DEBUG;
+    std::chrono::system_clock::time_point from =
+        std::chrono::system_clock::time_point::min();
+    std::chrono::system_clock::time_point to =
+        std::chrono::system_clock::time_point::max();
+    bool follow = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-t" || arg == "--template") && has_value) {
+            msg_template = argv[++i];
+        } else if ((arg == "-d" || arg == "--datetime") && has_value) {
+            datetime_pattern = argv[++i];
+        } else if ((arg == "-l" || arg == "--level") && has_value) {
+            if (!tool::parse_level(argv[++i], min_lvl)) {
+                std::cerr << "ealogger_decode: unknown level " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if ((arg == "--from" || arg == "--to") && has_value) {
+            if (!tool::parse_time(argv[++i], arg == "--from" ? from : to)) {
+                std::cerr << "ealogger_decode: invalid time " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if (arg == "-f" || arg == "--follow") {
+            follow = true;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (file.empty() && arg[0] != '-') {
+            file = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (file.empty()) {
+        usage();
+        return 2;
+    }
+
+    eal::BinlogReader reader(file);
+    if (!reader.is_valid()) {
+        std::cerr << "ealogger_decode: can not open " << file << std::endl;
+        return 1;
+    }
+    static char out_buffer[1 << 20];
+    std::setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    tool::SinkStdout sink;
+    sink.set_min_lvl(min_lvl);
+    if (!msg_template.empty())
+        sink.set_msg_template(msg_template);
+    if (!datetime_pattern.empty())
+        sink.set_datetime_pattern(datetime_pattern);
+
+    std::size_t formats = 0;
+    std::shared_ptr<eal::LogMessage> m;
+    for (;;) {
+        while (reader.next(m)) {
+            if (reader.get_format_count() != formats) {
+                formats = reader.get_format_count();
+                if (msg_template.empty())
+                    sink.set_msg_template(reader.get_msg_template());
+                if (datetime_pattern.empty())
+                    sink.set_datetime_pattern(reader.get_datetime_pattern());
+            }
+            if (m->get_time() < from || m->get_time() >= to)
+                continue;
+            sink.prepare_log_message(m);
+        }
+        if (!follow || !reader.is_valid())
+            break;
+        std::fflush(stdout);
+        if (!reader.refresh())
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::fflush(stdout);
+    if (reader.get_skipped() > 0) {
+        std::cerr << "ealogger_decode: skipped " << reader.get_skipped()
+                  << " bytes of damaged records" << std::endl;
+    }
+    if (!reader.is_valid()) {
+        std::cerr << "ealogger_decode: " << file
+                  << " is no binary log file or corrupt at offset "
+                  << reader.get_offset() << std::endl;
+        return 1;
+    }
+    return 0;
+}
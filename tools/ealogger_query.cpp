@@ -0,0 +1,222 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ealogger/binlog_reader.h>
+#include <ealogger/log_index.h>
+
+#include "tool_util.h"
+
+namespace
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+void usage()
+{
+    std::cerr
+        << "Usage: ealogger_query [options] FILE\n"
+           "Find messages in a log file with the help of its index FILE.idx.\n"
+           "Only the blocks of FILE that can contain matching messages are "
+           "read.\n\n"
+           "  -l, --level LEVEL        Minimum severity (DEBUG, INFO, WARNING, "
+           "ERROR, FATAL)\n"
+           "      --from TIME          Skip messages before TIME\n"
+           "      --to TIME            Skip messages at or after TIME\n"
+           "  -t, --template TEMPLATE  Message template for binary files\n"
+           "  -d, --datetime PATTERN   Datetime pattern for binary files\n"
+           "  -b, --blocks             Print the matching byte ranges instead "
+           "of messages\n\n"
+           "TIME is \"YYYY-MM-DD HH:MM:SS\" in local time or seconds since "
+           "the epoch.\n"
+           "Binary files are filtered message by message, text files are "
+           "printed in\nwhole blocks.\n";
+}
+
+/**
+ * @brief Copy the byte ranges of a text log file to stdout
+ */
+void print_text(const std::string &file,
+                const std::vector<eal::LogIndex::Range> &ranges)
+{
+    std::ifstream in(file, std::ios::binary);
+    std::vector<char> buf(1 << 20);
+    for (const auto &r : ranges) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(r.begin));
+        std::uint64_t left = r.end - r.begin;
+        while (left > 0 && in) {
+            in.read(buf.data(), static_cast<std::streamsize>(std::min<
+                                    std::uint64_t>(left, buf.size())));
+            std::size_t n = static_cast<std::size_t>(in.gcount());
+            std::fwrite(buf.data(), 1, n, stdout);
+            left -= n;
+        }
+    }
+}
+
+/**
+ * @brief Render the matching messages in the byte ranges of a binary log
+ * file
+ */
+bool print_binary(eal::BinlogReader &reader,
+                  const std::vector<eal::LogIndex::Range> &ranges,
+                  tool::SinkStdout &sink, bool own_template,
+                  bool own_datetime,
+                  std::chrono::system_clock::time_point from,
+                  std::chrono::system_clock::time_point to)
+{
+    std::size_t formats = 0;
+    std::shared_ptr<eal::LogMessage> m;
+    for (const auto &r : ranges) {
+        reader.seek(r.begin);
+        while (reader.get_offset() < r.end && reader.next(m)) {
+            if (reader.get_format_count() != formats) {
+                formats = reader.get_format_count();
+                if (!own_template)
+                    sink.set_msg_template(reader.get_msg_template());
+                if (!own_datetime)
+                    sink.set_datetime_pattern(reader.get_datetime_pattern());
+            }
+            if (m->get_time() < from || m->get_time() >= to)
+                continue;
+            sink.prepare_log_message(m);
+        }
+        if (!reader.is_valid())
+            return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::string file;
+    std::string msg_template;
+    std::string datetime_pattern;
+    con::LOG_LEVEL min_lvl = con::LOG_LEVEL::EAL_DEBUG;
+    std::chrono::system_clock::time_point from =
+        std::chrono::system_clock::time_point::min();
+    std::chrono::system_clock::time_point to =
+        std::chrono::system_clock::time_point::max();
+    bool blocks = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-t" || arg == "--template") && has_value) {
+            msg_template = argv[++i];
+        } else if ((arg == "-d" || arg == "--datetime") && has_value) {
+            datetime_pattern = argv[++i];
+        } else if ((arg == "-l" || arg == "--level") && has_value) {
+            if (!tool::parse_level(argv[++i], min_lvl)) {
+                std::cerr << "ealogger_query: unknown level " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if ((arg == "--from" || arg == "--to") && has_value) {
+            if (!tool::parse_time(argv[++i], arg == "--from" ? from : to)) {
+                std::cerr << "ealogger_query: invalid time " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if (arg == "-b" || arg == "--blocks") {
+            blocks = true;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (file.empty() && arg[0] != '-') {
+            file = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (file.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        std::cerr << "ealogger_query: can not open " << file << std::endl;
+        return 1;
+    }
+    char header[eal::binlog::file_header_size];
+    in.read(header, sizeof(header));
+    bool binary = eal::binlog::is_file_header(
+        header, static_cast<std::size_t>(in.gcount()));
+    in.close();
+
+    eal::LogIndex index(file);
+    if (!index.is_valid())
+        std::cerr << "ealogger_query: no index for " << file
+                  << ", reading the whole file" << std::endl;
+    std::vector<eal::LogIndex::Range> ranges =
+        index.query(from, to, min_lvl);
+
+    static char out_buffer[1 << 20];
+    std::setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+    if (blocks) {
+        for (const auto &r : ranges) {
+            if (r.end == UINT64_MAX) {
+                std::printf("%llu -\n",
+                            static_cast<unsigned long long>(r.begin));
+            } else {
+                std::printf("%llu %llu\n",
+                            static_cast<unsigned long long>(r.begin),
+                            static_cast<unsigned long long>(r.end));
+            }
+        }
+        return 0;
+    }
+    if (!binary) {
+        print_text(file, ranges);
+        std::fflush(stdout);
+        return 0;
+    }
+
+    eal::BinlogReader reader(file);
+    tool::SinkStdout sink;
+    sink.set_min_lvl(min_lvl);
+    if (!msg_template.empty())
+        sink.set_msg_template(msg_template);
+    if (!datetime_pattern.empty())
+        sink.set_datetime_pattern(datetime_pattern);
+    bool ok = print_binary(reader, ranges, sink, !msg_template.empty(),
+                           !datetime_pattern.empty(), from, to);
+    std::fflush(stdout);
+    if (reader.get_skipped() > 0) {
+        std::cerr << "ealogger_query: skipped " << reader.get_skipped()
+                  << " bytes of damaged records" << std::endl;
+    }
+    if (!ok) {
+        std::cerr << "ealogger_query: " << file
+                  << " is no binary log file or corrupt at offset "
+                  << reader.get_offset() << std::endl;
+        return 1;
+    }
+    return 0;
+}
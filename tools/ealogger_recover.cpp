@@ -0,0 +1,114 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ealogger/flight_recorder.h>
+
+#include "tool_util.h"
+
+namespace
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+void usage()
+{
+    std::cerr
+        << "Usage: ealogger_recover [options] FILE\n"
+           "Render the messages of a flight recorder file.\n\n"
+           "  -s, --size MB            Only read the last MB megabytes of "
+           "the ring\n"
+           "  -t, --template TEMPLATE  Message template, default is\n"
+           "                           \"%d %s [%f:%l] %m\"\n"
+           "  -d, --datetime PATTERN   Datetime pattern, default is \"%F %T\"\n"
+           "  -l, --level LEVEL        Minimum severity (DEBUG, INFO, WARNING, "
+           "ERROR, FATAL)\n\n"
+           "The recorder of the previous process is FILE.prev.\n";
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::string file;
+    std::string msg_template = "%d %s [%f:%l] %m";
+    std::string datetime_pattern = "%F %T";
+    con::LOG_LEVEL min_lvl = con::LOG_LEVEL::EAL_DEBUG;
+    std::uint64_t max_bytes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-s" || arg == "--size") && has_value) {
+            try {
+                max_bytes = std::stoull(argv[++i]) * 1024 * 1024;
+            } catch (const std::exception &) {
+                std::cerr << "ealogger_recover: invalid size " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if ((arg == "-t" || arg == "--template") && has_value) {
+            msg_template = argv[++i];
+        } else if ((arg == "-d" || arg == "--datetime") && has_value) {
+            datetime_pattern = argv[++i];
+        } else if ((arg == "-l" || arg == "--level") && has_value) {
+            if (!tool::parse_level(argv[++i], min_lvl)) {
+                std::cerr << "ealogger_recover: unknown level " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (file.empty() && arg[0] != '-') {
+            file = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (file.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::shared_ptr<eal::LogMessage>> messages;
+    std::uint64_t skipped = 0;
+    if (!eal::FlightRecorder::recover(file, messages, skipped, max_bytes)) {
+        std::cerr << "ealogger_recover: " << file
+                  << " can not be read or is no flight recorder file"
+                  << std::endl;
+        return 1;
+    }
+    static char out_buffer[1 << 20];
+    std::setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    tool::SinkStdout sink;
+    sink.set_min_lvl(min_lvl);
+    sink.set_msg_template(msg_template);
+    sink.set_datetime_pattern(datetime_pattern);
+    for (const auto &m : messages)
+        sink.prepare_log_message(m);
+    std::fflush(stdout);
+    if (skipped > 0) {
+        std::cerr << "ealogger_recover: skipped " << skipped
+                  << " bytes of torn records" << std::endl;
+    }
+    return 0;
+}
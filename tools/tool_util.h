@@ -0,0 +1,112 @@
+//   ealogger is a simple, asynchronous and powerful logger library for c++
+//   Copyright 2013 - 2016 Christian Rapp
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef TOOL_UTIL_H
+#define TOOL_UTIL_H
+
+/**
+ * @file tool_util.h
+ * @brief Helpers shared by the command line tools
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <ealogger/sink.h>
+
+#include "config.h"
+
+namespace tool
+{
+namespace eal = ealogger;
+namespace con = ealogger::constants;
+
+/**
+ * @brief A sink that writes rendered messages to stdout
+ */
+class SinkStdout : public eal::Sink
+{
+public:
+    SinkStdout() : eal::Sink("%m", "%F %T", true, con::LOG_LEVEL::EAL_DEBUG)
+    {
+    }
+
+private:
+    void write_message(const std::string &msg)
+    {
+        std::fwrite(msg.data(), 1, msg.size(), stdout);
+        std::fputc('\n', stdout);
+    }
+    void config_changed() {}
+};
+
+/**
+ * @brief Parse a severity name like ERROR, case does not matter
+ */
+inline bool parse_level(std::string name, con::LOG_LEVEL &lvl)
+{
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    const char *names[] = {"DEBUG", "INFO", "WARNING", "ERROR", "FATAL"};
+    for (int i = 0; i < 5; i++) {
+        if (name == names[i]) {
+            lvl = static_cast<con::LOG_LEVEL>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parse "YYYY-MM-DD HH:MM:SS" in local time or seconds since the epoch
+ */
+inline bool parse_time(const std::string &str,
+                       std::chrono::system_clock::time_point &tp)
+{
+    if (!str.empty() &&
+        std::all_of(str.begin(), str.end(),
+                    [](unsigned char c) { return std::isdigit(c); })) {
+        tp = std::chrono::system_clock::from_time_t(
+            static_cast<std::time_t>(std::stoll(str)));
+        return true;
+    }
+#ifdef EALOGGER_CAN_PARSE_TIME
+    std::tm t = {};
+    t.tm_isdst = -1;
+#ifdef EALOGGER_HAVE_DECL_GETTIME
+    std::istringstream ss(str);
+    ss >> std::get_time(&t, "%Y-%m-%d %H:%M:%S");
+    if (ss.fail())
+        return false;
+#else
+    if (strptime(str.c_str(), "%Y-%m-%d %H:%M:%S", &t) == nullptr)
+        return false;
+#endif
+    tp = std::chrono::system_clock::from_time_t(std::mktime(&t));
+    return true;
+#else
+    return false;
+#endif
+}
+}
+
+#endif /* TOOL_UTIL_H */